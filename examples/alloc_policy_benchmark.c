@@ -0,0 +1,230 @@
+/*
+ * Сравнение политик выделения кластеров.
+ *
+ * Том в памяти «состаривается» (создаются и через один удаляются мелкие файлы),
+ * затем четыре файла в двух каталогах пишутся попеременно, как у регистратора
+ * с видео и журналами. Для каждой политики выводятся количество фрагментов
+ * (непрерывных участков данных) и время последовательного чтения: измеренное
+ * на RAM-устройстве и оценка для SD-карты по простой модели — последовательное
+ * чтение BENCH_SD_MBPS МБ/с плюс BENCH_SD_SEEK_US мкс на каждый разрыв.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fat32/FAT32.h"
+#include "fat32/fat32_alloc.h"
+
+#define BENCH_CAPACITY (2048ULL * 1024 * 1024)
+#define BENCH_CHUNK (64 * 1024)
+#define BENCH_SECTOR 512
+#define BENCH_SD_MBPS 20.0
+#define BENCH_SD_SEEK_US 1000.0
+
+#define BENCH_AGING_FILES 400
+#define BENCH_WRITERS 4
+#define BENCH_ROUNDS 1024
+
+static uint8_t *chunks[BENCH_CAPACITY / BENCH_CHUNK];
+
+// Статистика чтения области данных: разрывы считаются только за границей data_start
+static uint32_t data_start = 0;
+static uint32_t next_data_sector = 0;
+static uint32_t data_seeks = 0;
+static uint64_t data_sectors = 0;
+
+static uint8_t *chunk_at(uint64_t offset, int create)
+{
+    uint64_t idx = offset / BENCH_CHUNK;
+    if (chunks[idx] == NULL)
+    {
+        if (!create)
+            return NULL;
+        chunks[idx] = calloc(1, BENCH_CHUNK);
+    }
+    return chunks[idx] + offset % BENCH_CHUNK;
+}
+
+static int ram_read(uint8_t *buffer, uint32_t count, uint32_t sector, uint32_t sector_size)
+{
+    if (data_start != 0 && sector >= data_start)
+    {
+        if (sector != next_data_sector)
+            data_seeks++;
+        next_data_sector = sector + count;
+        data_sectors += count;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t *p = chunk_at((uint64_t)(sector + i) * sector_size, 0);
+        if (p != NULL)
+            memcpy(buffer + i * sector_size, p, sector_size);
+        else
+            memset(buffer + i * sector_size, 0, sector_size);
+    }
+    return 0;
+}
+
+static int ram_write(const uint8_t *buffer, uint32_t count, uint32_t sector, uint32_t sector_size)
+{
+    for (uint32_t i = 0; i < count; i++)
+        memcpy(chunk_at((uint64_t)(sector + i) * sector_size, 1), buffer + i * sector_size, sector_size);
+    return 0;
+}
+
+static int ram_clear(uint32_t sector, uint32_t count, uint32_t sector_size)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t *p = chunk_at((uint64_t)(sector + i) * sector_size, 0);
+        if (p != NULL)
+            memset(p, 0, sector_size);
+    }
+    return 0;
+}
+
+static void ram_reset(void)
+{
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+    {
+        free(chunks[i]);
+        chunks[i] = NULL;
+    }
+}
+
+static BlockDevice device = {
+    .read = ram_read,
+    .write = ram_write,
+    .clear = ram_clear,
+    .block_size = BENCH_SECTOR};
+
+static const char *writer_paths[BENCH_WRITERS] = {"/cam/video_0.bin", "/cam/video_1.bin", "/log/events.txt", "/log/sensors.txt"};
+static const uint32_t writer_chunks[BENCH_WRITERS] = {8192, 8192, 1024, 2048};
+
+static int age_volume(void)
+{
+    char path[32];
+    uint8_t data[20 * 1024];
+    memset(data, 0xA5, sizeof(data));
+    int status = mkdir_fat32("/old");
+    for (int i = 0; status == 0 && i < BENCH_AGING_FILES; i++)
+    {
+        FAT32_File *file = NULL;
+        sprintf(path, "/old/f%03d.dat", i);
+        status = open_file_fat32(path, &file, F_WRITE);
+        if (status == 0)
+        {
+            uint32_t size = 2048 + (uint32_t)(i * 7919) % (sizeof(data) - 2048);
+            status = (write_file_fat32(file, data, size) == (int)size) ? 0 : -1;
+            close_file_fat32(&file);
+        }
+    }
+    for (int i = 0; status == 0 && i < BENCH_AGING_FILES; i += 2)
+    {
+        sprintf(path, "/old/f%03d.dat", i);
+        status = delete_file_fat32(path);
+    }
+    return status;
+}
+
+static int write_interleaved(void)
+{
+    FAT32_File *files[BENCH_WRITERS] = {0};
+    static uint8_t data[8192];
+    memset(data, 0x5A, sizeof(data));
+
+    int status = mkdir_fat32("/cam");
+    if (status == 0)
+        status = mkdir_fat32("/log");
+    for (int w = 0; status == 0 && w < BENCH_WRITERS; w++)
+        status = open_file_fat32((char *)writer_paths[w], &files[w], F_WRITE);
+    for (int round = 0; status == 0 && round < BENCH_ROUNDS; round++)
+    {
+        for (int w = 0; status == 0 && w < BENCH_WRITERS; w++)
+        {
+            int written = write_file_fat32(files[w], data, writer_chunks[w]);
+            status = (written == (int)writer_chunks[w]) ? 0 : written;
+        }
+    }
+    for (int w = 0; w < BENCH_WRITERS; w++)
+    {
+        if (files[w] != NULL)
+            close_file_fat32(&files[w]);
+    }
+    return status;
+}
+
+static int read_back(uint32_t *fragments, double *ram_ms, double *model_ms)
+{
+    static uint8_t buffer[BENCH_CHUNK];
+    *fragments = 0;
+    *ram_ms = 0;
+    *model_ms = 0;
+    for (int w = 0; w < BENCH_WRITERS; w++)
+    {
+        FAT32_File *file = NULL;
+        int status = open_file_fat32((char *)writer_paths[w], &file, F_READ);
+        if (status != 0)
+            return status;
+        data_seeks = 0;
+        data_sectors = 0;
+        next_data_sector = 0;
+        clock_t start = clock();
+        uint32_t remaining = file->size_bytes;
+        while (remaining > 0)
+        {
+            uint32_t size = remaining < sizeof(buffer) ? remaining : sizeof(buffer);
+            int count = read_file_fat32(file, buffer, size);
+            if (count <= 0)
+                break;
+            remaining -= count;
+        }
+        *ram_ms += 1000.0 * (double)(clock() - start) / CLOCKS_PER_SEC;
+        *fragments += data_seeks;
+        *model_ms += data_sectors * BENCH_SECTOR / (BENCH_SD_MBPS * 1000.0) + data_seeks * BENCH_SD_SEEK_US / 1000.0;
+        close_file_fat32(&file);
+    }
+    return 0;
+}
+
+int main(void)
+{
+    const Fat32AllocPolicy *policies[] = {&fat32_policy_first_fit, &fat32_policy_next_fit,
+                                          &fat32_policy_best_fit, &fat32_policy_locality};
+
+    fat32_allocator_init(NULL);
+    printf("%-10s %10s %12s %12s %14s\n", "policy", "fragments", "write, ms", "read RAM, ms", "read SD*, ms");
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++)
+    {
+        ram_reset();
+        data_start = 0;
+        int status = formatted_fat32(&device, BENCH_CAPACITY);
+        if (status == 0)
+            status = mount_fat32_ex(&device, policies[i]);
+        if (status == 0)
+            status = age_volume();
+
+        clock_t start = clock();
+        if (status == 0)
+            status = write_interleaved();
+        double write_ms = 1000.0 * (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        uint32_t fragments = 0;
+        double ram_ms = 0, model_ms = 0;
+        FatLayoutInfo layout;
+        if (status == 0)
+            status = fat32_get_layout(&layout);
+        data_start = (status == 0) ? layout.address_region : 0;
+        if (status == 0)
+            status = read_back(&fragments, &ram_ms, &model_ms);
+        if (status != 0)
+        {
+            printf("%-10s error %d\n", policies[i]->name, status);
+            continue;
+        }
+        printf("%-10s %10u %12.1f %12.1f %14.1f\n", policies[i]->name, fragments, write_ms, ram_ms, model_ms);
+    }
+    printf("* %.0f MB/s sequential, %.0f us per discontinuity\n", BENCH_SD_MBPS, BENCH_SD_SEEK_US);
+    ram_reset();
+    return 0;
+}
@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include "block_device.h"
+#include "fat32_alloc_policy.h"
 
 
 typedef struct
@@ -15,19 +16,43 @@ typedef struct
     uint32_t fat_ents_sec;
     uint32_t bytesPerSec;
     uint32_t sizeFAT;
+    uint32_t cluster_count; // количество записей FAT, соответствующих кластерам тома (включая 0 и 1)
+    uint32_t free_count;    // число свободных кластеров или FAT32_FREE_COUNT_UNKNOWN
     BlockDevice *device;
+    const Fat32AllocPolicy *alloc_policy; // политика выделения кластеров тома
 } FatLayoutInfo;
 
+#define FAT32_FREE_COUNT_UNKNOWN 0xFFFFFFFF
+
 
 /**
  * Монтирует файловую систему FAT32.
  *
  * Инициализирует и подготавливает к работе FAT32.
  *
+ * Кластеры выделяются политикой first-fit.
+ *
  * @return 0 при успешном монтировании, отрицательное значение при ошибке.
  */
 int mount_fat32(BlockDevice *device);
 
+/**
+ * Монтирует файловую систему FAT32 с заданной политикой выделения кластеров.
+ *
+ * @param device Блочное устройство.
+ * @param policy Политика выделения (fat32_policy_first_fit, fat32_policy_next_fit,
+ *               fat32_policy_best_fit, fat32_policy_locality или собственная);
+ *               NULL — first-fit. Состояние политики сбрасывается.
+ * Цепочки, ожидающие отложенного освобождения на ранее смонтированном томе, сначала
+ * освобождаются; если это не удалось, возвращается код ошибки fat32_free_step,
+ * прежний том остаётся смонтированным, а очередь — непустой.
+ *
+ * @return 0 при успешном монтировании,
+ *         FAT32_ERR_INVALID_ARGUMENT — нет устройства или у политики нет find_runs,
+ *         иначе код ошибки mount_fat32.
+ */
+int mount_fat32_ex(BlockDevice *device, const Fat32AllocPolicy *policy);
+
 /**
  * Форматирует накопитель под файловую систему FAT32.
  *
@@ -37,7 +62,9 @@ int mount_fat32(BlockDevice *device);
 int formatted_fat32(BlockDevice *device, uint64_t capacity);
 
 /**
- * Выводит содержимое директории по указанному пути.
+ * Выводит содержимое директории по указанному пути через журнал FAT32_LOG_INFO.
+ *
+ * Записи перебираются через fat32_readdir.
  *
  * @param path Путь к директории.
  * @return 0 при успешном выполнении, иначе код ошибки.
@@ -47,7 +74,8 @@ int list_directory_fat32(const char *path);
 /** 
 * @brief Сохраняет изменения в структуре файла на файловой системе FAT32.
  *
- * Обновляет метаданные файла, включая размер и время последней модификации,
+ * Записывает данные из буфера отложенного выделения (см. fat32_set_delayed_alloc),
+ * обновляет метаданные файла, включая размер и время последней модификации,
  * и записывает обновлённую запись каталога на носитель.
  * Используется для синхронизации состояния файлового дескриптора с физическим уровнем.
  *
@@ -147,6 +175,76 @@ int delete_file_fat32(char *path);
  */
 int delete_dir_fat32(char *path, DeleteDirMode mode);
 
+/**
+ * Переименовывает или переносит файл либо папку без копирования данных.
+ *
+ * Переписываются только записи каталога: новая группа (LFN-записи + SFN-запись с прежними
+ * атрибутами, датами, первым кластером и размером) создаётся в каталоге назначения, затем
+ * старая помечается удалённой; индекс имён каталогов поддерживается. У перенесённой
+ * папки обновляется запись "..". Файл не должен быть открыт.
+ *
+ * @param old_path Полный путь к существующему объекту.
+ * @param new_path Полный новый путь; каталог назначения должен существовать.
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_ARGUMENT, FAT32_ERR_INVALID_PATH — некорректные пути
+ *         (в том числе перенос папки внутрь самой себя),
+ *         FAT32_ERR_ENTRY_NOT_FOUND — объект не найден,
+ *         FAT32_ERR_DIR_NOT_FOUND — каталог назначения не найден,
+ *         FAT32_ERR_INVALID_CHAR — недопустимое новое имя,
+ *         FAT32_ERR_ENTRY_EXISTS — имя назначения занято другим объектом,
+ *         FAT32_ERR_NO_FREE_ENTRIES, FAT32_ERR_WRITE_FAIL — ошибка записи каталога.
+ */
+int fat32_rename(const char *old_path, const char *new_path);
+
+/**
+ * Дописывает содержимое файла src в конец файла dst и удаляет src (склейка сегментов журнала).
+ *
+ * Если размер dst кратен размеру кластера, цепочка кластеров src подвешивается к последнему
+ * кластеру dst одним обновлением FAT, данные не копируются; кластеры, зарезервированные за
+ * концом dst, освобождаются. Иначе данные src копируются посекторно (первая порция дополняет
+ * последний сектор dst), после чего цепочка src освобождается. Запись src удаляется последней.
+ * При ошибке копирования dst возвращается к исходному размеру. Файлы не должны быть открыты.
+ *
+ * @param dst_path Полный путь к файлу, в который дописываются данные.
+ * @param src_path Полный путь к дописываемому файлу.
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_ARGUMENT — некорректные аргументы, dst и src совпадают или
+ *         суммарный размер превышает 4 ГБ - 1,
+ *         FAT32_ERR_INVALID_PATH — некорректный путь,
+ *         FAT32_ERR_ENTRY_NOT_FOUND — файл не найден,
+ *         FAT32_ERR_IS_DIRECTORY — путь указывает на папку,
+ *         иначе код ошибки чтения, записи или выделения кластеров.
+ */
+int fat32_concat(const char *dst_path, const char *src_path);
+
+/** Размер буфера копирования fat32_copy_file, секторов (при нехватке памяти уменьшается) */
+#ifndef FAT32_COPY_BUFFER_SECTORS
+#define FAT32_COPY_BUFFER_SECTORS 32
+#endif
+
+/**
+ * Копирует файл внутри тома, не передавая данные через буферы вызывающего.
+ *
+ * Цепочка dst резервируется заранее (fat32_preallocate, обычно одним непрерывным участком).
+ * Цепочки src и dst разбираются на непрерывные участки чтением FAT посекторно, и общая часть
+ * участков копируется многосекторными чтениями и записями через внутренний буфер
+ * FAT32_COPY_BUFFER_SECTORS секторов, выделяемый один раз на вызов. Если устройство
+ * предоставляет обработчик copy, данные копируются им без буфера. Существующий dst
+ * перезаписывается; при ошибке dst остаётся пустым. Файлы не должны быть открыты.
+ *
+ * @param src_path Полный путь к исходному файлу.
+ * @param dst_path Полный путь к копии; каталог должен существовать.
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_ARGUMENT — некорректные аргументы или dst совпадает с src,
+ *         FAT32_ERR_INVALID_PATH — некорректный путь,
+ *         FAT32_ERR_ENTRY_NOT_FOUND — src не найден,
+ *         FAT32_ERR_IS_DIRECTORY — src является папкой,
+ *         FAT32_ERR_DISK_FULL — недостаточно места для копии,
+ *         FAT32_ERR_ALLOC_FAILED — не удалось выделить буферы,
+ *         иначе код ошибки открытия dst, чтения или записи.
+ */
+int fat32_copy_file(const char *src_path, const char *dst_path);
+
 /**
  * Проверяет существование указанного пути в файловой системе FAT32.
  *
@@ -173,11 +271,17 @@ int read_file_fat32(FAT32_File *file, uint8_t *buffer, const uint32_t size);
 /**
  * Записывает данные в файл FAT32.
  *
+ * При включённом отложенном выделении данные копируются в буфер файла и попадают
+ * на носитель при его заполнении, flush_fat32, seek_file_fat32 или закрытии.
+ * Если сброс буфера не удался, данные этого вызова в буфере не остаются: возвращается
+ * число байт, принятых до ошибки, а остаток можно записать повторно.
+ *
  * @param file    Указатель на структуру FAT32_File, описывающую открытый файл.
  * @param buffer  Буфер с данными, которые нужно записать.
  * @param length  Количество байт для записи.
  *
- * @return Количество успешно записанных байт, либо код ошибки (< 0).
+ * @return Количество принятых байт (может быть меньше length после ошибки),
+ *         либо код ошибки (< 0), если не принято ни одного байта.
  */
 int write_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t length);
 
@@ -194,6 +298,314 @@ int write_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t length);
  */
 int clear_table_fat32();
 
+/**
+ * Подсчитывает количество свободных кластеров тома.
+ *
+ * При первом вызове таблица FAT читается блоками по несколько секторов и сканируется
+ * векторным ядром, далее значение поддерживается при выделении и освобождении кластеров.
+ *
+ * @param free_count Указатель на переменную для количества свободных кластеров.
+ * @return 0 при успехе, иначе код ошибки (FAT32_ERR_FS_NOT_LOADED, FAT32_ERR_READ_FAIL, ...).
+ */
+int count_free_clusters_fat32(uint32_t *free_count);
+
+/**
+ * Возвращает разметку смонтированного тома.
+ *
+ * Копия содержит адреса таблиц FAT и начало области данных (в секторах), размер
+ * кластера и число записей FAT; изменение копии на том не влияет.
+ *
+ * @param layout Указатель на структуру, в которую копируется разметка.
+ * @return 0 при успехе, FAT32_ERR_INVALID_ARGUMENT или FAT32_ERR_FS_NOT_LOADED.
+ */
+int fat32_get_layout(FatLayoutInfo *layout);
+
+/**
+ * Выделяет до count кластеров одной цепочкой и присоединяет её к концу существующей.
+ *
+ * Свободные участки выбирает политика выделения тома (см. mount_fat32_ex), ориентир —
+ * last_cluster; first-fit просматривает FAT один раз блоками по несколько секторов. Ссылки новой цепочки записываются одним чтением-изменением-
+ * записью на каждый затронутый сектор в каждой копии FAT; конец существующей цепочки
+ * связывается с новой последним, поэтому сбой записи не повреждает файл. Если свободное
+ * место разбито более чем на FAT32_ALLOC_MAX_RUNS участков, выделяется меньше count.
+ *
+ * @param last_cluster Последний кластер цепочки, к которой присоединяются кластеры (0 — новая цепочка).
+ * @param count        Требуемое количество кластеров.
+ * @param alloc        [out] Выделенные участки в порядке цепочки (alloc->total от 1 до count).
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_ARGUMENT — некорректные аргументы,
+ *         FAT32_ERR_DISK_FULL — свободных кластеров нет,
+ *         FAT32_ERR_READ_FAIL — ошибка чтения FAT,
+ *         FAT32_ERR_UPDATE_FAILED — ошибка записи FAT (выделенные кластеры освобождаются).
+ */
+int fat32_allocate_clusters(uint32_t last_cluster, uint32_t count, Fat32ClusterAlloc *alloc);
+
+/**
+ * Резервирует кластеры под bytes байт файла, не меняя его размер (аналог fallocate).
+ *
+ * Недостающие кластеры берутся одним непрерывным участком — наименьшим из подходящих
+ * (один проход по FAT) — и присоединяются к цепочке одним пакетным обновлением FAT.
+ * Если такого участка нет, используются несколько участков, как в fat32_allocate_clusters.
+ * Участки запоминаются в дескрипторе, поэтому последующие write_file_fat32 в пределах
+ * резерва не обращаются к FAT; размер файла растёт только по мере записи данных.
+ * Неиспользованные кластеры остаются в цепочке файла после закрытия и освобождаются
+ * при его удалении или открытии в режиме F_WRITE.
+ *
+ * @param file  Дескриптор файла, открытого для записи или дозаписи.
+ * @param bytes Требуемая ёмкость цепочки от начала файла, байт.
+ * @return 0 при успехе (в том числе если цепочка уже достаточна),
+ *         FAT32_ERR_INVALID_ARGUMENT — некорректные аргументы,
+ *         FAT32_ERR_INVALID_FILE_MODE — файл открыт только для чтения,
+ *         FAT32_ERR_DISK_FULL — недостаточно свободных кластеров (цепочка не меняется),
+ *         FAT32_ERR_READ_FAIL, FAT32_ERR_UPDATE_FAILED — ошибка ввода-вывода.
+ */
+int fat32_preallocate(FAT32_File *file, uint32_t bytes);
+
+/**
+ * Включает или выключает отложенное выделение кластеров для файла.
+ *
+ * Записанные данные накапливаются в буфере файла размером buffer_size; кластеры
+ * выделяются только при его сбросе (заполнение буфера, flush_fat32, seek_file_fat32,
+ * закрытие) — одним непрерывным участком на весь пакет, первым подходящим. При
+ * попеременной записи нескольких файлов кластеры каждого файла идут подряд, а FAT
+ * обновляется один раз на пакет, а не на каждую запись. Размер буфера, кратный
+ * размеру кластера, даёт пакеты из целых кластеров. Запись не меньше буфера идёт
+ * на носитель напрямую.
+ *
+ * Буфер выделяется fat32_alloc и освобождается при закрытии файла или вызове с 0.
+ * Данные в буфере, как и размер файла, не видны на носителе до сброса.
+ *
+ * @param file        Дескриптор файла, открытого для записи или дозаписи.
+ * @param buffer_size Размер буфера в байтах (0 — записать накопленное и выключить).
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_ARGUMENT — некорректные аргументы,
+ *         FAT32_ERR_INVALID_FILE_MODE — файл открыт только для чтения,
+ *         FAT32_ERR_ALLOC_FAILED — не удалось выделить буфер (отложенное выделение выключено),
+ *         иначе код ошибки записи накопленных данных.
+ */
+int fat32_set_delayed_alloc(FAT32_File *file, uint32_t buffer_size);
+
+/**
+ * Уменьшает размер файла (аналог ftruncate).
+ *
+ * Цепочка обрезается после последнего кластера, нужного для new_size байт (файл
+ * сохраняет хотя бы первый кластер); поиск этого кластера использует известные
+ * участки дескриптора. Сначала новый размер записывается в запись каталога одной
+ * записью, затем цепочка обрезается, а хвост освобождается посекторно (или ставится
+ * в очередь при отложенном освобождении, см. fat32_set_deferred_free): при сбое между
+ * шагами остаются лишь потерянные кластеры. Кластеры, зарезервированные fat32_preallocate за
+ * концом файла, также освобождаются. Позиция за новым концом файла переносится на него.
+ *
+ * @param file     Дескриптор файла, открытого для записи или дозаписи.
+ * @param new_size Новый размер, байт (не больше текущего).
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_ARGUMENT — некорректные аргументы или new_size больше размера файла,
+ *         FAT32_ERR_INVALID_FILE_MODE — файл открыт только для чтения,
+ *         FAT32_ERR_READ_FAIL, FAT32_ERR_UPDATE_FAILED — ошибка обновления FAT,
+ *         иначе код ошибки записи записи каталога (flush_fat32).
+ */
+int fat32_truncate(FAT32_File *file, uint32_t new_size);
+
+/** Количество цепочек, которые могут одновременно ждать отложенного освобождения */
+#ifndef FAT32_DEFERRED_FREE_SLOTS
+#define FAT32_DEFERRED_FREE_SLOTS 8
+#endif
+
+/**
+ * Включает или выключает отложенное освобождение кластеров.
+ *
+ * При включённом режиме delete_file_fat32, delete_file_at_fat32 и открытие файла
+ * в режиме F_WRITE удаляют запись каталога (обрезают файл) сразу, а цепочку кластеров
+ * ставят в очередь; кластеры освобождаются пошагово fat32_free_step — из фоновой
+ * задачи или цикла опроса. До освобождения кластеры остаются занятыми и не
+ * выделяются повторно; счётчик свободных кластеров растёт по мере освобождения.
+ * Если очередь заполнена, цепочка освобождается сразу. Если свободного места
+ * не хватает для выделения, очередь освобождается полностью перед ошибкой
+ * FAT32_ERR_DISK_FULL.
+ *
+ * Очередь хранится в памяти: цепочки, не освобождённые до отключения питания,
+ * остаются потерянными кластерами (их находит проверка тома). Монтирование и
+ * форматирование очищают очередь.
+ *
+ * @param enable 1 — включить, 0 — выключить (ожидающие цепочки освобождаются сразу).
+ * @return 0 при успехе, иначе код ошибки fat32_free_step.
+ */
+int fat32_set_deferred_free(int enable);
+
+/**
+ * Выполняет шаг отложенного освобождения кластеров.
+ *
+ * Цепочки освобождаются в порядке постановки в очередь; за шаг записывается не более
+ * max_sectors секторов FAT (в каждую копию), что ограничивает время вызова.
+ *
+ * @param max_sectors Ограничение на количество секторов FAT за шаг (0 — освободить всё).
+ * @return количество цепочек, оставшихся в очереди (0 — очередь пуста),
+ *         FAT32_ERR_FS_NOT_LOADED — файловая система не смонтирована,
+ *         FAT32_ERR_READ_FAIL, FAT32_ERR_WRITE_FAIL — ошибка ввода-вывода
+ *         (цепочка остаётся в очереди, следующий шаг повторит попытку).
+ */
+int fat32_free_step(uint32_t max_sectors);
+
+/**
+ * Открывает каталог и возвращает его дескриптор.
+ *
+ * Путь разрешается один раз; последующие операции *_at ищут имена только
+ * в открытом каталоге, без прохода по пути от корня.
+ *
+ * @param path Абсолютный путь к каталогу (например, "/logs" или "/").
+ * @param dir  [out] Указатель, куда будет сохранён дескриптор каталога.
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_PATH — некорректный путь,
+ *         FAT32_ERR_DIR_NOT_FOUND — каталог не найден,
+ *         FAT32_ERR_NOT_A_DIRECTORY — путь указывает на файл,
+ *         FAT32_ERR_ALLOC_FAILED — не удалось выделить дескриптор.
+ */
+int fat32_opendir(const char *path, FAT32_Dir **dir);
+
+/**
+ * Закрывает дескриптор каталога и освобождает его память, включая буфер сектора fat32_readdir.
+ *
+ * @param dir Указатель на дескриптор; после закрытия обнуляется.
+ * @return 0 при успехе, FAT32_ERR_INVALID_ARGUMENT при некорректном аргументе.
+ */
+int fat32_closedir(FAT32_Dir **dir);
+
+/**
+ * Возвращает следующую запись открытого каталога.
+ *
+ * Курсор дескриптора хранит текущий кластер, сектор и индекс записи; каждый сектор
+ * каталога читается с носителя один раз, память на каждую запись не выделяется.
+ * После записи в каталоги между вызовами сектор перечитывается, поэтому созданные,
+ * удалённые и перемещённые сжатием записи не возвращаются из устаревшего буфера.
+ * Удалённые записи, метка тома и записи "." и ".." пропускаются.
+ *
+ * @param dir  Дескриптор каталога, полученный fat32_opendir.
+ * @param info [out] Имя, атрибуты, размер, первый кластер и временные метки записи.
+ * @return 1 — запись получена,
+ *         0 — записи закончились,
+ *         отрицательное значение — ошибка (FAT32_ERR_READ_FAIL, FAT32_ERR_ALLOC_FAILED, ...).
+ */
+int fat32_readdir(FAT32_Dir *dir, FAT32_DirInfo *info);
+
+/**
+ * Сохраняет текущую позицию курсора fat32_readdir.
+ *
+ * Позиция может быть сохранена вызывающей стороной (в том числе после закрытия
+ * дескриптора) и восстановлена fat32_seekdir, чтобы продолжить сканирование
+ * большого каталога без повторного чтения с первого кластера.
+ *
+ * @param dir Дескриптор каталога.
+ * @param pos [out] Позиция курсора.
+ * @return 0 при успехе, FAT32_ERR_INVALID_ARGUMENT при некорректных аргументах.
+ */
+int fat32_telldir(const FAT32_Dir *dir, FAT32_DirPos *pos);
+
+/**
+ * Восстанавливает позицию курсора, полученную fat32_telldir.
+ *
+ * Следующий вызов fat32_readdir вернёт запись, следующую за последней
+ * возвращённой на момент сохранения позиции.
+ *
+ * @param dir Дескриптор того же каталога (может быть открыт заново).
+ * @param pos Сохранённая позиция.
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_POSITION — позиция относится к другому каталогу или повреждена.
+ */
+int fat32_seekdir(FAT32_Dir *dir, const FAT32_DirPos *pos);
+
+/**
+ * Возвращает курсор fat32_readdir к началу каталога.
+ *
+ * @param dir Дескриптор каталога.
+ * @return 0 при успехе, FAT32_ERR_INVALID_ARGUMENT при некорректном аргументе.
+ */
+int fat32_rewinddir(FAT32_Dir *dir);
+
+/**
+ * Уплотняет каталог: переписывает живые записи подряд, без удалённых (0xE5).
+ *
+ * Группы LFN + SFN сохраняют свой порядок и остаются неразрывными, маркер конца
+ * каталога сдвигается вперёд, а освободившиеся кластеры в конце цепочки
+ * возвращаются в FAT. Курсор дескриптора сбрасывается к началу каталога.
+ *
+ * Позиции записей каталога меняются. Открытые файлы этого каталога остаются
+ * рабочими: их ссылки на записи переносятся вместе с записями. Сохранённые
+ * fat32_telldir позиции после уплотнения недействительны.
+ *
+ * @param dir Дескриптор каталога.
+ * @param released_clusters [out] Количество освобождённых кластеров (может быть NULL).
+ * @return 0 при успехе, отрицательное значение при ошибке.
+ */
+int fat32_compact_dir(FAT32_Dir *dir, uint32_t *released_clusters);
+
+/**
+ * Перечисляет каталог или всё его поддерево в массив записей за один проход.
+ *
+ * Каждый сектор каталогов читается один раз; для записей не выполняется повторный
+ * поиск по пути. При рекурсивном обходе подкаталоги раскрываются в ширину, а поле
+ * parent каждой записи указывает индекс её каталога в массиве.
+ *
+ * @param path      Абсолютный путь к каталогу.
+ * @param entries   Массив для записей.
+ * @param capacity  Размер массива entries.
+ * @param count     [out] Количество заполненных записей.
+ * @param recursive 0 — только сам каталог, иначе всё поддерево.
+ * @return 0 при успехе,
+ *         FAT32_ERR_BUFFER_TOO_SMALL — массив заполнен, но записи ещё остались,
+ *         другие отрицательные значения — ошибки fat32_opendir / fat32_readdir.
+ */
+int fat32_stat_dir(const char *path, FAT32_StatEntry *entries, uint32_t capacity, uint32_t *count, uint8_t recursive);
+
+/**
+ * Открывает файл по пути относительно открытого каталога.
+ *
+ * Аналог open_file_fat32: отсутствующий файл создаётся.
+ *
+ * @param dir  Дескриптор каталога.
+ * @param name Относительный путь без ведущего '/' (например, "file.txt" или "sub/file.txt").
+ * @param file [out] Указатель, куда будет сохранена структура открытого файла.
+ * @param mode Режим открытия.
+ * @return 0 при успешном открытии, отрицательное значение при ошибке.
+ */
+int open_file_at_fat32(FAT32_Dir *dir, const char *name, FAT32_File **file, uint8_t mode);
+
+/**
+ * Создаёт каталог по пути относительно открытого каталога.
+ *
+ * @param dir  Дескриптор каталога.
+ * @param name Относительный путь к создаваемому каталогу.
+ * @return 0 при успешном создании (или если каталог уже существует), отрицательное значение при ошибке.
+ */
+int mkdir_at_fat32(FAT32_Dir *dir, const char *name);
+
+/**
+ * Удаляет файл по пути относительно открытого каталога.
+ *
+ * @param dir  Дескриптор каталога.
+ * @param name Относительный путь к файлу.
+ * @return 0 при успешном удалении, отрицательное значение при ошибке.
+ */
+int delete_file_at_fat32(FAT32_Dir *dir, const char *name);
+
+/**
+ * Удаляет каталог по пути относительно открытого каталога.
+ *
+ * @param dir  Дескриптор каталога.
+ * @param name Относительный путь к удаляемому каталогу.
+ * @param mode DELETE_DIR_SAFE или DELETE_DIR_RECURSIVE.
+ * @return 0 при успешном удалении, отрицательное значение при ошибке.
+ */
+int delete_dir_at_fat32(FAT32_Dir *dir, const char *name, DeleteDirMode mode);
+
+/**
+ * Проверяет существование пути относительно открытого каталога.
+ *
+ * @param dir  Дескриптор каталога.
+ * @param name Относительный путь.
+ * @return 0 если путь существует, 1 если не существует.
+ */
+int path_exists_at_fat32(FAT32_Dir *dir, const char *name);
+
 // test
 
 int show_entry_fat32(uint32_t sector);
@@ -8,6 +8,8 @@ typedef int (*fs_read_t)(uint8_t *buffer, uint32_t size, uint32_t start_sector,
 typedef int (*fs_write_t)(const uint8_t *buffer, uint32_t size, uint32_t start_sector, uint32_t sector_size);
 typedef int (*fs_clear_t)(uint32_t sector_num, uint32_t count_sector, uint32_t sector_size);
 typedef int (*fs_get_datetime_t)(Fat32_DateTime *dt);
+// Копирование секторов внутри носителя без передачи данных через память (необязательно, NULL — не поддерживается)
+typedef int (*fs_copy_t)(uint32_t dst_sector, uint32_t src_sector, uint32_t count_sector, uint32_t sector_size);
 
 
 typedef struct
@@ -16,5 +18,6 @@ typedef struct
     fs_write_t write;
     fs_clear_t clear;
     fs_get_datetime_t datetime;
+    fs_copy_t copy;
     uint32_t block_size;
 } BlockDevice;
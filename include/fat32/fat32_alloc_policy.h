@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include "fat32_types.h"
+
+/*
+ * Политики выделения кластеров.
+ *
+ * Политика выбирает свободные участки FAT под запрос из count кластеров; запись
+ * цепочки в обе копии FAT и присоединение её к файлу выполняет ядро файловой системы.
+ * Политика задаётся при монтировании (mount_fat32_ex) и действует на все выделения
+ * тома: первый кластер файла или каталога, рост каталога и дозапись файла.
+ * fat32_preallocate и пакеты отложенного выделения ищут непрерывный участок сами.
+ *
+ * Ориентир goal — кластер, рядом с которым желательно разместить данные: последний
+ * кластер удлиняемой цепочки либо первый кластер каталога, в котором создаётся
+ * файл или подкаталог (0 — без предпочтения).
+ *
+ * Встроенные политики:
+ *   first-fit — первые свободные участки от начала тома (поведение по умолчанию);
+ *   next-fit  — поиск продолжается с места последнего выделения (вращающийся курсор),
+ *               освобождённое в начале тома используется только после оборота;
+ *   best-fit  — наименьший свободный участок, вмещающий запрос целиком; каждый запрос
+ *               требует полного прохода по FAT, при отсутствии участка — first-fit;
+ *   locality  — если кластер сразу за ориентиром свободен, цепочка продолжается
+ *               с него (дозапись файла без разрывов, первый кластер рядом с каталогом);
+ *               иначе участок открывается на границе занятой области, а граница
+ *               отодвигается на FAT32_ALLOC_LOCALITY_WINDOW кластеров за него — это
+ *               окно остаётся для роста того же файла, пока другие файлы пишутся дальше.
+ *
+ * Собственная политика строится на примитивах fat32_find_free_runs,
+ * fat32_find_contiguous_run и fat32_cluster_is_free.
+ */
+
+/** Окно, оставляемое политикой locality для роста файла после открытия нового участка, кластеров */
+#ifndef FAT32_ALLOC_LOCALITY_WINDOW
+#define FAT32_ALLOC_LOCALITY_WINDOW 64
+#endif
+
+typedef struct
+{
+    /** Имя политики (для журналов и отчётов) */
+    const char *name;
+
+    /** Сбрасывает состояние политики при монтировании тома (может быть NULL) */
+    void (*reset)(void);
+
+    /**
+     * Выбирает свободные участки под запрос.
+     * @param goal  - ориентир размещения (0 — без предпочтения)
+     * @param count - требуемое количество кластеров
+     * @param alloc - [out] участки в порядке будущей цепочки, от 1 до count кластеров
+     * @return 0 при успехе, FAT32_ERR_DISK_FULL, иначе код ошибки
+     */
+    int (*find_runs)(uint32_t goal, uint32_t count, Fat32ClusterAlloc *alloc);
+} Fat32AllocPolicy;
+
+extern const Fat32AllocPolicy fat32_policy_first_fit;
+extern const Fat32AllocPolicy fat32_policy_next_fit;
+extern const Fat32AllocPolicy fat32_policy_best_fit;
+extern const Fat32AllocPolicy fat32_policy_locality;
+
+/**
+ * @brief Находит свободные участки общей длиной до count кластеров, начиная с кластера start
+ *
+ * FAT просматривается блоками по несколько секторов от start до конца тома, затем
+ * с начала тома до start. Найденные участки не помечаются занятыми.
+ *
+ * @param start - кластер, с которого начинается поиск (вне тома — с начала)
+ * @param count - требуемое количество кластеров
+ * @param alloc - [out] участки в порядке обнаружения (не более FAT32_ALLOC_MAX_RUNS)
+ * @return 0 при успехе (найден хотя бы один кластер), FAT32_ERR_DISK_FULL, иначе код ошибки
+ */
+int fat32_find_free_runs(uint32_t start, uint32_t count, Fat32ClusterAlloc *alloc);
+
+/**
+ * @brief Ищет свободный участок длиной не меньше count кластеров
+ *
+ * Для наилучшего подходящего FAT просматривается целиком (участок ровно из count
+ * кластеров завершает поиск досрочно); для первого подходящего поиск завершается,
+ * как только найден участок нужной длины.
+ *
+ * @param count     - требуемая длина участка
+ * @param first_fit - 0 — наименьший подходящий участок, 1 — первый подходящий
+ * @param run       - [out] начало участка и его длина, усечённая до count
+ * @return 0 при успехе, FAT32_ERR_NOT_FOUND — непрерывного участка такой длины нет,
+ *         иначе код ошибки
+ */
+int fat32_find_contiguous_run(uint32_t count, int first_fit, Fat32ClusterRun *run);
+
+/**
+ * @brief Проверяет, свободен ли кластер
+ * @return 1 — свободен, 0 — занят или вне тома, иначе код ошибки чтения FAT
+ */
+int fat32_cluster_is_free(uint32_t cluster);
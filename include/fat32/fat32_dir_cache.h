@@ -0,0 +1,220 @@
+#pragma once
+
+#include <stdint.h>
+#include "fat32_types.h"
+
+/*
+ * Кэш каталогов тома.
+ *
+ * Для нескольких недавно использованных каталогов хранится хеш-индекс имён:
+ * хеш имени -> положение группы записей (LFN + SFN). Индекс строится при первом
+ * поиске в каталоге одним проходом по его кластерам и поддерживается при создании
+ * и удалении записей, поэтому поиск имени в большом каталоге не требует чтения
+ * всех секторов. Совпадение хеша всегда проверяется чтением самой группы записей.
+ *
+ * Суммарный объём индексов ограничен бюджетом памяти; при его превышении индексы
+ * каталогов вытесняются целиком в порядке давности использования (LRU).
+ * Бюджет 0 отключает индексы.
+ *
+ * Кроме индекса, для каталога запоминается свободное место: положение маркера
+ * конца каталога (хвост — свободные записи до конца цепочки кластеров) и
+ * несколько известных «дыр» от удалённых записей с их длиной. Эти сведения
+ * хранятся в самом слоте без выделения памяти и не зависят от бюджета, поэтому
+ * добавление записи в конец большого каталога не требует его сканирования.
+ * Там же хранится подсказка для коротких имён: последняя основа SFN, для которой
+ * генерировался хвост "~N", и номер, начиная с которого все хвосты свободны.
+ *
+ * Для отрицательных ответов в слоте хранится фильтр Блума по хешам имён каталога.
+ * Он заполняется тем же проходом, что и индекс, но не зависит от бюджета: поиск
+ * отсутствующего имени (создание нового файла) завершается без чтения носителя
+ * даже при отключённых индексах. Удаление имён фильтр не отслеживает — это даёт
+ * лишь ложные «возможно есть», которые проверяются обычным поиском. Для каталогов
+ * больше FAT32_DIR_CACHE_BLOOM_BITS / 8 имён фильтр ничего не отсекает: для них
+ * предназначен индекс.
+ */
+
+/** Количество каталогов, для которых одновременно хранится состояние кэша */
+#define FAT32_DIR_CACHE_SLOTS 8
+
+/** Количество запоминаемых «дыр» (последовательностей удалённых записей) на каталог */
+#define FAT32_DIR_CACHE_HOLES 8
+
+/** Размер фильтра Блума имён на каталог, бит (степень двойки) */
+#ifndef FAT32_DIR_CACHE_BLOOM_BITS
+#define FAT32_DIR_CACHE_BLOOM_BITS 4096
+#endif
+
+/** Бюджет памяти индексов по умолчанию, байт (0 — индексы отключены) */
+#ifndef FAT32_DIR_CACHE_DEFAULT_BUDGET
+#define FAT32_DIR_CACHE_DEFAULT_BUDGET 0
+#endif
+
+typedef struct
+{
+    uint32_t hash;    // хеш имени (0 — пустая ячейка, 1 — удалённая)
+    uint32_t cluster; // кластер первой записи группы
+    uint8_t sector;   // сектор внутри кластера
+    uint8_t offset;   // индекс записи внутри сектора
+    uint8_t count;    // количество записей группы
+    uint8_t reserved;
+} Fat32DirIndexEntry;
+
+typedef struct
+{
+    DirEntryPosition position; // первая свободная запись
+    uint32_t count;            // количество подряд идущих свободных записей
+} Fat32DirFreeRun;
+
+/**
+ * @brief Вычисляет хеш имени без учёта регистра ASCII-символов
+ * @param name - имя (не обязательно завершённое нулём)
+ * @param length - длина имени
+ * @return хеш, не равный 0 и 1
+ */
+uint32_t fat32_name_hash(const char *name, uint32_t length);
+
+/**
+ * @brief Устанавливает бюджет памяти индексов каталогов
+ *
+ * Индексы, не помещающиеся в новый бюджет, освобождаются.
+ *
+ * @param bytes - максимальный суммарный размер индексов в байтах (0 — отключить)
+ */
+void fat32_dir_cache_set_budget(uint32_t bytes);
+
+/**
+ * @brief Освобождает все индексы и сбрасывает состояние кэша (монтирование, форматирование)
+ */
+void fat32_dir_cache_reset(void);
+
+/**
+ * @brief Возвращает состояние индекса каталога
+ * @param dir_cluster - первый кластер каталога
+ * @return 1 — индекс построен,
+ *         0 — индекса нет, его можно построить,
+ *         -1 — индексы отключены или каталог не помещается в бюджет
+ */
+int fat32_dir_cache_ready(uint32_t dir_cluster);
+
+/**
+ * @brief Начинает построение индекса каталога
+ *
+ * После вызова записи каталога добавляются fat32_dir_cache_add, построение
+ * завершается fat32_dir_cache_build_end.
+ *
+ * @return 0 при успехе, FAT32_ERR_ALLOC_FAILED если индекс не помещается в бюджет
+ */
+int fat32_dir_cache_build_begin(uint32_t dir_cluster);
+
+/**
+ * @brief Завершает построение индекса
+ * @param status - 0, если каталог прочитан полностью; иначе индекс отбрасывается
+ */
+void fat32_dir_cache_build_end(uint32_t dir_cluster, int status);
+
+/**
+ * @brief Добавляет группу записей в индекс и фильтр имён каталога
+ *
+ * Если индекса или фильтра нет, соответствующая часть вызова ничего не делает.
+ * Если индекс не удаётся расширить в пределах бюджета, он отбрасывается,
+ * а каталог помечается как не помещающийся.
+ *
+ * @param dir_cluster - первый кластер каталога
+ * @param hash - хеш имени (fat32_name_hash)
+ * @param position - положение первой записи группы
+ * @param entry_count - количество записей группы
+ */
+void fat32_dir_cache_add(uint32_t dir_cluster, uint32_t hash, const DirEntryPosition *position, uint16_t entry_count);
+
+/**
+ * @brief Перебирает группы записей с заданным хешем имени
+ * @param dir_cluster - первый кластер каталога
+ * @param hash - хеш имени
+ * @param cursor - состояние перебора, перед первым вызовом должно быть 0
+ * @param position - [out] положение первой записи группы
+ * @param entry_count - [out] количество записей группы
+ * @return 1 — кандидат найден, 0 — кандидатов больше нет,
+ *         FAT32_ERR_NOT_FOUND — индекс каталога не построен
+ */
+int fat32_dir_cache_find(uint32_t dir_cluster, uint32_t hash, uint32_t *cursor, DirEntryPosition *position, uint16_t *entry_count);
+
+/**
+ * @brief Удаляет из индекса группу записей, начинающуюся в position
+ *
+ * Хеш удаляемого имени не требуется: индекс просматривается целиком в памяти,
+ * без обращений к носителю.
+ */
+void fat32_dir_cache_remove(uint32_t dir_cluster, const DirEntryPosition *position);
+
+/**
+ * @brief Начинает заполнение фильтра имён каталога
+ *
+ * Имена добавляются fat32_dir_cache_add, заполнение завершается fat32_dir_cache_filter_end.
+ */
+void fat32_dir_cache_filter_begin(uint32_t dir_cluster);
+
+/**
+ * @brief Завершает заполнение фильтра имён
+ * @param status - 0, если каталог прочитан полностью; иначе фильтр отбрасывается
+ */
+void fat32_dir_cache_filter_end(uint32_t dir_cluster, int status);
+
+/**
+ * @brief Проверяет, может ли имя с данным хешем присутствовать в каталоге
+ * @param dir_cluster - первый кластер каталога
+ * @param hash - хеш имени (fat32_name_hash)
+ * @return 0 — имени в каталоге заведомо нет,
+ *         1 — имя может присутствовать (в том числе если фильтр переполнен),
+ *         FAT32_ERR_NOT_FOUND — фильтр каталога не заполнен
+ */
+int fat32_dir_cache_filter_test(uint32_t dir_cluster, uint32_t hash);
+
+/**
+ * @brief Отбрасывает всё кэшированное состояние каталога (удаление, перезапись записей)
+ */
+void fat32_dir_cache_invalidate(uint32_t dir_cluster);
+
+/**
+ * @brief Запоминает хвост каталога — свободные записи от маркера конца до конца цепочки
+ *
+ * Если свободное место каталога ещё не было известно, список «дыр» начинается пустым.
+ *
+ * @param dir_cluster - первый кластер каталога
+ * @param tail - начало и длина хвоста (длина 0 — последний кластер заполнен)
+ * @param last_cluster - последний кластер цепочки каталога
+ */
+void fat32_dir_cache_set_tail(uint32_t dir_cluster, const Fat32DirFreeRun *tail, uint32_t last_cluster);
+
+/**
+ * @brief Возвращает запомненный хвост каталога
+ * @return 0 при успехе, FAT32_ERR_NOT_FOUND если свободное место каталога неизвестно
+ */
+int fat32_dir_cache_get_tail(uint32_t dir_cluster, Fat32DirFreeRun *tail, uint32_t *last_cluster);
+
+/**
+ * @brief Запоминает «дыру» — последовательность свободных записей перед маркером конца
+ *
+ * Если свободное место каталога неизвестно, вызов ничего не делает. При заполненном
+ * списке вытесняется самая короткая «дыра», если новая длиннее.
+ */
+void fat32_dir_cache_add_hole(uint32_t dir_cluster, const Fat32DirFreeRun *hole);
+
+/**
+ * @brief Извлекает из списка самую короткую «дыру» длиной не меньше entry_count
+ * @param hole - [out] найденная «дыра»; неиспользованный остаток вызывающий возвращает fat32_dir_cache_add_hole
+ * @return 1 — «дыра» найдена, 0 — подходящей нет
+ */
+int fat32_dir_cache_take_hole(uint32_t dir_cluster, uint32_t entry_count, Fat32DirFreeRun *hole);
+
+/**
+ * @brief Выдаёт следующий свободный номер хвоста "~N" для основы короткого имени
+ * @param basis - основа имени без хвоста (11 байт)
+ * @param number - [out] номер хвоста
+ * @return 1 — номер выдан, 0 — подсказки для этой основы нет
+ */
+int fat32_dir_cache_take_sfn_tail(uint32_t dir_cluster, const uint8_t basis[11], uint32_t *number);
+
+/**
+ * @brief Запоминает, что все хвосты основы basis начиная с next свободны
+ */
+void fat32_dir_cache_set_sfn_tail(uint32_t dir_cluster, const uint8_t basis[11], uint32_t next);
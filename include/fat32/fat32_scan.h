@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fat32_types.h"
+
+/*
+ * Ядра сканирования буферов FAT-таблицы.
+ *
+ * Реализация выбирается при компиляции: AVX2 (__AVX2__), SSE2 (__SSE2__),
+ * NEON (__ARM_NEON на AArch64) или переносимый скалярный вариант.
+ * Скалярный вариант можно принудительно включить макросом FAT32_SCAN_SCALAR.
+ *
+ * Все функции работают с массивом 32-битных записей FAT в порядке little-endian,
+ * старшие 4 бита записи (зарезервированные в FAT32) при сравнении игнорируются.
+ */
+
+/** Маска значащих бит записи FAT32 */
+#define FAT32_ENTRY_MASK 0x0FFFFFFF
+
+/**
+ * @brief Ищет первую свободную (нулевую) запись FAT
+ * @param entries - буфер записей FAT
+ * @param count - количество записей в буфере
+ * @return индекс первой свободной записи или count, если свободных нет
+ */
+uint32_t fat32_scan_find_free(const uint32_t *entries, uint32_t count);
+
+/**
+ * @brief Ищет первую занятую (ненулевую) запись FAT
+ * @param entries - буфер записей FAT
+ * @param count - количество записей в буфере
+ * @return индекс первой занятой записи или count, если все записи свободны
+ */
+uint32_t fat32_scan_find_used(const uint32_t *entries, uint32_t count);
+
+/**
+ * @brief Подсчитывает количество свободных записей FAT в буфере
+ */
+uint32_t fat32_scan_count_free(const uint32_t *entries, uint32_t count);
+
+/**
+ * @brief Ищет первую непрерывную серию свободных записей
+ * @param entries - буфер записей FAT
+ * @param count - количество записей в буфере
+ * @param run_length - длина найденной серии (0, если свободных записей нет)
+ * @return индекс начала серии или count, если свободных записей нет
+ */
+uint32_t fat32_scan_free_run(const uint32_t *entries, uint32_t count, uint32_t *run_length);
+
+/**
+ * @brief Определяет длину непрерывного участка цепочки кластеров
+ *
+ * Участок непрерывен, пока entries[i] == first_cluster + i + 1, то есть каждый
+ * кластер ссылается на следующий по номеру. Запись, на которой серия прерывается,
+ * является либо концом цепочки, либо переходом в другой участок диска.
+ *
+ * @param entries - буфер записей FAT, entries[0] соответствует кластеру first_cluster
+ * @param count - количество записей в буфере
+ * @param first_cluster - номер кластера, соответствующего entries[0]
+ * @return количество записей, продолжающих непрерывную цепочку
+ */
+uint32_t fat32_scan_chain_run(const uint32_t *entries, uint32_t count, uint32_t first_cluster);
+
+/*
+ * Ядро классификации записей каталога.
+ *
+ * За один вызов обрабатывается до FAT32_SCAN_DIR_GROUP 32-байтных записей:
+ * из каждой записи извлекаются первый байт имени и атрибут, после чего все записи
+ * группы сравниваются одновременно. Результат возвращается в виде битовых масок,
+ * где бит i соответствует i-й записи группы.
+ */
+
+/** Максимальное количество записей каталога, обрабатываемых за один вызов */
+#define FAT32_SCAN_DIR_GROUP 32
+
+typedef struct
+{
+    uint32_t end;        // DIR_Name[0] == 0x00 (конец каталога)
+    uint32_t deleted;    // DIR_Name[0] == 0xE5 (удалённая запись)
+    uint32_t lfn;        // действующая LFN-запись
+    uint32_t sfn;        // действующая SFN-запись (без метки тома)
+    uint32_t candidates; // LFN с LDIR_Ord == lfn_ord или SFN с DIR_Name[0] == sfn_first
+} Fat32DirScanMask;
+
+/**
+ * @brief Классифицирует группу записей каталога
+ * @param entries - указатель на первую запись группы
+ * @param count - количество записей (не более FAT32_SCAN_DIR_GROUP)
+ * @param lfn_ord - ожидаемый LDIR_Ord первой LFN-записи искомого имени (0 - не искать)
+ * @param sfn_first - первый символ искомого короткого имени (0 - не искать)
+ * @param mask - результат классификации
+ */
+void fat32_scan_dir_entries(const uint8_t *entries, uint32_t count, uint8_t lfn_ord, uint8_t sfn_first, Fat32DirScanMask *mask);
@@ -102,6 +102,21 @@ typedef struct
 
 #define MAX_NAME_SIZE 255
 
+/**
+ * Результат разрешения пути: родительский каталог, положение записи и сама запись.
+ *
+ * Группа записей файла (LFN-записи + SFN-запись) начинается в lfn_position
+ * и занимает entry_count записей подряд; SFN-запись находится в position.
+ */
+typedef struct
+{
+    uint32_t parent_cluster;       // первый кластер родительского каталога
+    DirEntryPosition position;     // положение SFN-записи
+    DirEntryPosition lfn_position; // положение первой записи группы
+    uint16_t entry_count;          // количество записей группы
+    FatDir_Type entry;             // копия SFN-записи
+} DirEntryRef;
+
 typedef struct
 {
     uint32_t cluster_idx;
@@ -110,15 +125,74 @@ typedef struct
     uint16_t byte_offset;
 } FilePos;
 
+/** Наибольшее количество непрерывных участков, выделяемых за один вызов fat32_allocate_clusters */
+#define FAT32_ALLOC_MAX_RUNS 8
+
 typedef struct
+{
+    uint32_t first; // первый кластер участка
+    uint32_t count; // количество кластеров участка
+} Fat32ClusterRun;
+
+/**
+ * Результат пакетного выделения кластеров: участки перечислены в порядке
+ * следования по цепочке, номера кластеров внутри участка возрастают.
+ */
+typedef struct
+{
+    Fat32ClusterRun runs[FAT32_ALLOC_MAX_RUNS];
+    uint32_t run_count;
+    uint32_t total; // всего выделено кластеров
+} Fat32ClusterAlloc;
+
+typedef struct FAT32_File
 {
     DirEntryPosition entry_pos;
     uint32_t first_cluster;
     uint32_t size_bytes;
     FilePos position;
+    Fat32ClusterAlloc extents;    // известные участки цепочки файла: переходы по ним не читают FAT
+    uint8_t *delay_buffer;        // буфер отложенного выделения (NULL — запись сразу на носитель)
+    uint32_t delay_capacity;      // размер буфера отложенного выделения
+    uint32_t delay_length;        // данные в буфере, ещё не записанные на носитель
+    struct FAT32_File *next_open; // следующий открытый файл тома
     uint8_t flags;
 } FAT32_File;
 
+/**
+ * Дескриптор открытого каталога.
+ *
+ * Хранит разрешённый кластер каталога, чтобы операции *_at искали имена
+ * только в нём, без повторного прохода по пути от корня, а также курсор
+ * fat32_readdir и буфер текущего сектора каталога.
+ */
+typedef struct
+{
+    uint32_t first_cluster;     // первый кластер каталога
+    uint32_t parent_cluster;    // первый кластер родительского каталога (0 для корня)
+    DirEntryPosition cursor;    // положение следующей записи для fat32_readdir
+    uint32_t buffer_sector;     // номер сектора, загруженного в buffer (0 - буфер пуст)
+    uint32_t buffer_generation; // счётчик записей в каталоги на момент чтения buffer
+    uint8_t *buffer;            // сектор каталога, выделяется при первом fat32_readdir
+    uint8_t at_end;             // достигнут конец каталога
+} FAT32_Dir;
+
+/**
+ * Сохраняемая позиция курсора fat32_readdir (fat32_telldir / fat32_seekdir).
+ *
+ * fat32_readdir возвращает управление только после SFN-записи, поэтому позиция
+ * всегда указывает на начало группы записей и не содержит незавершённого LFN.
+ * Структура упакована и может сохраняться как есть между сеансами сканирования.
+ */
+typedef struct
+{
+    uint32_t first_cluster; // первый кластер каталога, которому принадлежит позиция
+    uint32_t cluster;       // кластер следующей записи
+    uint32_t sector;        // сектор внутри кластера
+    uint16_t offset;        // индекс записи внутри сектора
+    uint8_t at_end;         // каталог был прочитан до конца
+} FAT32_DirPos;
+
 typedef enum
 {
     F_READ,
@@ -160,6 +234,7 @@ typedef enum
 #define FREE_CLUSTER 0x0
 #define CLASTER_DAMAGE 0xFFFFFFF7
 #define FAT32_CLUSTER_END 0x0FFFFFFF
+#define FAT32_CLUSTER_EOC_MIN 0x0FFFFFF8 // минимальное значение конца цепочки
 
 #define SHORT_NAME_SIZE 11
 
@@ -200,6 +275,38 @@ typedef struct
 
 #pragma pack(pop)
 
+/**
+ * Запись каталога, возвращаемая fat32_readdir.
+ *
+ * Имя собирается из LFN-записей, если они присутствуют и их контрольная сумма
+ * совпадает с SFN-записью, иначе формируется из короткого имени ("NAME.EXT").
+ */
+typedef struct
+{
+    char name[MAX_NAME_SIZE + 1]; // имя, завершённое нулём
+    uint8_t attr;                 // атрибуты (ATTR_*)
+    uint32_t size;                // размер файла в байтах
+    uint32_t first_cluster;       // первый кластер данных
+    Fat32_DateTime created;       // дата и время создания
+    Fat32_DateTime modified;      // дата и время последней записи
+    FAT32_Date_Type accessed;     // дата последнего доступа
+} FAT32_DirInfo;
+
+/** Значение FAT32_StatEntry.parent для записей самого перечисляемого каталога */
+#define FAT32_STAT_NO_PARENT 0xFFFFFFFF
+
+/**
+ * Запись результата fat32_stat_dir.
+ *
+ * При обходе поддерева parent содержит индекс записи каталога, в котором
+ * находится данная запись, что позволяет восстановить путь без повторного поиска.
+ */
+typedef struct
+{
+    FAT32_DirInfo info; // имя, размер, кластер, атрибуты и временные метки
+    uint32_t parent;    // индекс родительского каталога в массиве или FAT32_STAT_NO_PARENT
+} FAT32_StatEntry;
+
 typedef enum
 {
     SIZE_1GB = 1073741824,
@@ -263,6 +370,8 @@ typedef enum
     FAT32_ERR_ENTRY_NOT_FOUND = -240, // Entry not found
     FAT32_ERR_ENTRY_CORRUPTED = -241, // Corrupted entry
     FAT32_ERR_NOT_FOUND = -242,       // Generic "not found"
+    FAT32_ERR_BUFFER_TOO_SMALL = -243, // Output array cannot hold all entries
+    FAT32_ERR_ENTRY_EXISTS = -244,     // Entry with this name already exists
 
     /* ============================
        I/O errors (-250..-259)
@@ -29,6 +29,18 @@ typedef enum {
  */
 int validate_path(const char *path);
 
+/**
+ * Проверяет корректность пути относительно открытого каталога.
+ * Правила для сегментов те же, что и в validate_path, но путь не начинается с '/'.
+ *
+ * @param path — строка с проверяемым путём (например, "sub/file.txt").
+ * @return 0 — если путь корректен,
+ *         FAT_ERR_NULL / FAT_ERR_EMPTY — путь отсутствует или пуст,
+ *         FAT_ERR_PATH_EMPTY_SEG — путь начинается с '/' или содержит пустой сегмент,
+ *         другие отрицательные значения — недопустимые символы или длина.
+ */
+int validate_relative_path(const char *path);
+
 /**
  * Проверяет корректность имени файла в формате FAT LFN.
  * Имя может содержать буквы, цифры, символы '_' и '-'.
@@ -78,6 +90,51 @@ int validate_fat_sfn_dir(const char *name);
 
 
 
+/**
+ * Итератор компонентов пути.
+ *
+ * Не копирует и не модифицирует строку пути: каждый компонент возвращается
+ * как указатель на его начало в исходной строке и длина. Повторяющиеся
+ * и завершающие '/' пропускаются.
+ */
+typedef struct
+{
+    const char *cursor; // позиция начала поиска следующего компонента
+    const char *end;    // конец разбираемой части пути
+} Fat32PathIter;
+
+/**
+ * @brief Инициализирует итератор компонентов пути
+ * @param iter - итератор
+ * @param path - строка пути (не обязательно завершённая нулём)
+ * @param length - длина разбираемой части пути
+ */
+void fat32_path_iter_init(Fat32PathIter *iter, const char *path, uint32_t length);
+
+/**
+ * @brief Возвращает следующий компонент пути
+ * @param iter - итератор
+ * @param name - [out] указатель на начало компонента в строке пути
+ * @param length - [out] длина компонента
+ * @return 1 - компонент получен, 0 - компоненты закончились
+ */
+int fat32_path_iter_next(Fat32PathIter *iter, const char **name, uint32_t *length);
+
+/**
+ * @brief Разделяет путь на родительскую директорию и последний компонент без копирования
+ *
+ * Для "/dir/file.txt" родительская часть - "/dir/" (parent_length = 5), имя - "file.txt".
+ * Завершающие '/' не входят в имя.
+ *
+ * @param path - строка пути
+ * @param length - длина пути
+ * @param parent_length - [out] длина родительской части пути, включая последний '/'
+ * @param name - [out] указатель на последний компонент
+ * @param name_length - [out] длина последнего компонента
+ * @return 0 при успехе, FAT32_ERR_INVALID_PATH если в пути нет '/' или последнего компонента
+ */
+int fat32_path_split(const char *path, uint32_t length, uint32_t *parent_length, const char **name, uint32_t *name_length);
+
 /**
  * @brief Вычисляет глубину пути (количество компонентов)
  */
@@ -102,13 +159,83 @@ void fat32_format_sfn(const char *input, uint16_t length, char output[11]);
 int fat32_is_special_dir(const uint8_t dir_name[11]);
 
 /**
- * @brief Сравнивает LFN (UTF-16) с ASCII строкой
+ * @brief Переводит символ BMP в верхний регистр
+ *
+ * Используется при сравнении длинных имён и хешировании имён. Таблица покрывает
+ * латиницу, греческий, кириллицу и армянский; прочие символы возвращаются без изменений.
+ */
+uint16_t fat32_upcase(uint16_t c);
+
+/**
+ * @brief Декодирует символ UTF-8 и переводит его в верхний регистр (fat32_upcase)
+ * @param text - начало символа
+ * @param available - количество доступных байт
+ * @param upper - [out] кодовая точка в верхнем регистре; некорректный байт возвращается как есть
+ * @return длина символа в байтах (не меньше 1)
+ */
+uint8_t fat32_utf8_upcase_char(const char *text, uint32_t available, uint32_t *upper);
+
+/**
+ * @brief Сравнивает LFN (UTF-16) с ASCII строкой без учёта регистра
+ * @param name_ascii - имя (не обязательно завершённое нулём)
+ * @param length - длина имени
+ * @param name_unicode - длинное имя в UTF-16 (не менее length + 1 символов), завершённое нулём
  * @return 0 если совпадают, иначе != 0
  */
-int fat32_compare_lfn(const char *name_ascii, const uint16_t *name_unicode);
+int fat32_compare_lfn(const char *name_ascii, uint32_t length, const uint16_t *name_unicode);
 
 /**
- * @brief Генерирует короткое имя (SFN) из длинного имени (LFN)
+ * @brief Сравнивает с именем один фрагмент длинного имени прямо в LFN-записи
+ *
+ * Фрагмент сравнивается с частью имени, соответствующей его порядковому номеру,
+ * без сборки полного имени. Для последнего фрагмента (LFN_ENTRY_LAST) проверяется
+ * и длина: имя должно закончиться в нём. Регистр не учитывается (fat32_upcase).
+ *
+ * @param name - имя в UTF-16 (fat32_utf8_to_utf16le)
+ * @param length - длина имени в символах UTF-16
+ * @param entry - LFN-запись
+ * @return 0 если фрагмент совпадает, иначе != 0
+ */
+int fat32_compare_lfn_fragment(const uint16_t *name, uint32_t length, const LDIR_Type *entry);
+
+/**
+ * @brief Строит основу короткого имени (SFN) из длинного имени без числового хвоста
+ *
+ * Символы приводятся к верхнему регистру, пробелы и точки основы пропускаются,
+ * недопустимые в SFN символы (в том числе каждый символ UTF-8 вне ASCII)
+ * заменяются на '_'. Расширение берётся после последней точки.
+ *
+ * @param name - длинное имя (не обязательно завершённое нулём)
+ * @param length - длина имени
+ * @param buffer - [out] основа имени в формате 8.3 (11 байт, дополнена пробелами)
+ * @return длина основы имени (1..8)
+ */
+uint8_t fat32_sfn_basis(const char *name, uint32_t length, uint8_t buffer[11]);
+
+/**
+ * @brief Записывает числовой хвост "~N" в основу короткого имени
+ *
+ * Основа обрезается ровно настолько, чтобы хвост поместился в 8 символов имени.
+ *
+ * @param buffer - основа имени от fat32_sfn_basis, изменяется на месте
+ * @param base_len - длина основы имени
+ * @param number - номер хвоста (1..999999)
+ */
+void fat32_sfn_set_tail(uint8_t buffer[11], uint8_t base_len, uint32_t number);
+
+/**
+ * @brief Определяет номер хвоста, если короткое имя получено из основы basis
+ * @param sfn - короткое имя записи каталога
+ * @param basis - основа имени от fat32_sfn_basis
+ * @param base_len - длина основы имени
+ * @return N, если sfn совпадает с basis и хвостом "~N", иначе 0
+ */
+uint32_t fat32_sfn_tail_number(const uint8_t sfn[11], const uint8_t basis[11], uint8_t base_len);
+
+/**
+ * @brief Генерирует короткое имя (SFN) из длинного имени (LFN) с хвостом "~1"
+ *
+ * Уникальность имени в каталоге не проверяется.
  */
 void fat32_generate_sfn_from_lfn(const char *name, uint32_t length, uint8_t buffer[11]);
 
@@ -117,6 +244,35 @@ void fat32_generate_sfn_from_lfn(const char *name, uint32_t length, uint8_t buff
  */
 uint8_t fat32_sfn_checksum(const uint8_t *pFcbName);
 
+/**
+ * @brief Перекодирует имя из UTF-8 в UTF-16 (символы вне BMP — суррогатными парами)
+ *
+ * Блоки ASCII перекодируются по 16 байт за шаг (SSE2/NEON, если доступны).
+ *
+ * @param utf8 - имя (не обязательно завершённое нулём)
+ * @param length - длина имени в байтах
+ * @param utf16 - [out] буфер результата без завершающего нуля; NULL — только подсчитать длину
+ * @param capacity - максимальная длина результата в символах UTF-16
+ * @return длина в символах UTF-16,
+ *         FAT_ERR_INVALID_CHAR — некорректная последовательность UTF-8,
+ *         FAT_ERR_TOO_LONG — результат длиннее capacity
+ */
+int fat32_utf8_to_utf16le(const char *utf8, uint32_t length, uint16_t *utf16, uint32_t capacity);
+
+/**
+ * @brief Перекодирует длинное имя из UTF-16 в UTF-8
+ *
+ * Перекодирование заканчивается на count символах или на 0x0000/0xFFFF.
+ * Одиночные суррогаты заменяются на '?'. Блоки ASCII перекодируются по 16 символов за шаг.
+ *
+ * @param utf16 - имя в UTF-16
+ * @param count - максимальная длина имени в символах
+ * @param utf8 - [out] имя, завершённое нулём
+ * @param capacity - размер буфера utf8 в байтах, включая завершающий нуль
+ * @return длина результата в байтах, FAT_ERR_TOO_LONG — имя не помещается в буфер
+ */
+int fat32_utf16le_to_utf8(const uint16_t *utf16, uint32_t count, char *utf8, uint32_t capacity);
+
 /**
  * @brief Конвертирует ASCII строку в UTF-16LE
  */
@@ -8,40 +8,79 @@
 #include "fat32/fat32_alloc.h"
 #include "fat32/file_utils.h"
 #include "fat32/log_fat32.h"
+#include "fat32/fat32_scan.h"
+#include "fat32/fat32_dir_cache.h"
+
+// Количество секторов FAT, читаемых за одно обращение при сканировании таблицы
+#define FAT32_FAT_SCAN_SECTORS 8
+
+// Максимальное количество LFN-записей одного имени и размер буфера для его сборки
+#define LFN_MAX_ENTRIES ((MAX_NAME_SIZE + MAX_SYMBOLS_ENTRY - 1) / MAX_SYMBOLS_ENTRY)
+#define LFN_BUFFER_SIZE (LFN_MAX_ENTRIES * MAX_SYMBOLS_ENTRY + 1)
 
 FatLayoutInfo *fat_info = NULL;
 
+// Очередь цепочек, ожидающих отложенного освобождения (см. fat32_set_deferred_free)
+static uint32_t deferred_chains[FAT32_DEFERRED_FREE_SLOTS];
+static uint32_t deferred_count = 0;
+static uint8_t deferred_free_enabled = 0;
+
+// Счётчик записей в секторы каталогов: буфер дескриптора каталога, прочитанный при
+// другом значении, считается устаревшим (см. read_dir_group)
+static uint32_t dir_generation = 0;
+
+// Открытые дескрипторы файлов: уплотнение каталога переносит их entry_pos вслед за записями
+static FAT32_File *open_files = NULL;
+
 void *stm_memcpy(void *dest, const void *src, uint32_t size);
 
 // ===============================
 // Directory entry handling
 // ===============================
-int find_entry_cluster_fat32(char *name, uint32_t length, uint32_t parent_cluster, uint32_t *out_cluster);
+int find_entry_cluster_fat32(const char *name, uint32_t length, uint32_t parent_cluster, uint32_t *out_cluster);
 int get_attr_entry_fat32(uint32_t cluster_parent, uint32_t child_cluster, uint8_t *attr);
 int find_free_dir_entries(uint32_t parent_cluster, const uint16_t entry_count, DirEntryPosition *position);
 int make_lfn_entries(const char *name, uint32_t length, uint8_t chkSum, LDIR_Type *entries, uint16_t numb_entries);
-FAT32_File *init_file_handle(const char *file_name, uint32_t parent_cluster, uint8_t mode);
+FAT32_File *init_file_handle(const DirEntryRef *ref, uint8_t mode);
 int read_directory_entry_fat32(DirEntryPosition *position, FatDir_Type *entry);
 int write_dir_entries_at(const DirEntryPosition *position, const void *entries, uint16_t entry_count);
 int is_free_entry_fat32(FatDir_Type *entry);
+static int resolve_path_fat32(uint32_t base_cluster, const char *path, uint32_t length, uint32_t *out_cluster);
+static int resolve_parent_fat32(uint32_t base_cluster, const char *path, uint32_t *parent_cluster, const char **name, uint32_t *name_length);
+static int resolve_entry_fat32(uint32_t base_cluster, const char *path, DirEntryRef *ref);
+static int dir_position_advance(DirEntryPosition *position, uint32_t count);
+static int delete_file_in_dir(uint32_t base_cluster, const char *path);
+static int read_dir_group(FAT32_Dir *dir, FAT32_DirInfo *info, DirEntryPosition *group, uint16_t *group_count);
+static int find_dir_entry(const char *name, uint32_t length, uint32_t dir_cluster, DirEntryRef *ref);
+static int match_dir_group(const uint16_t *name_utf16, int length_utf16, const char *name, uint32_t length,
+                           const FatDir_Type *group, uint16_t count);
+static int generate_sfn_alias(uint32_t dir_cluster, const char *name, uint32_t length, uint8_t sfn[11]);
+int read_dir_entries_at(const DirEntryPosition *position, void *entries, uint16_t entry_count);
+static int delete_dir_in_dir(uint32_t base_cluster, const char *path, DeleteDirMode mode);
 int create_dir_fat32(char *name, uint32_t name_length, uint32_t parent_cluster); // create a new directory
 
 // ===============================
 // Cluster management
 // ===============================
 int extend_cluster_chain_if_needed(uint32_t *last_cluster);
+static int file_next_cluster(const FAT32_File *file, uint32_t *cluster);
+static void file_extents_link(FAT32_File *file, uint32_t last_cluster, const Fat32ClusterAlloc *alloc);
+static int allocate_contiguous(uint32_t last_cluster, uint32_t count, int first_fit, Fat32ClusterAlloc *alloc);
+static int drain_delay_buffer(FAT32_File *file);
 int allocate_cluster_fat32(uint32_t *new_cluster);
+static int release_cluster_chain(uint32_t *cluster, uint32_t *sector_budget, uint32_t *released);
+static int queue_chain_release(uint32_t cluster);
 int get_next_cluster_fat32(uint32_t *prev_cluster);
 int is_dir_empty_fat32(uint32_t cluster);
 int update_fat32(uint32_t cluster, uint32_t value);
-int find_free_cluster(uint32_t *free_cluster);
+int delete_entry_fat32(uint32_t cluster_file);
 void join_cluster_number(uint32_t *cluster, uint16_t high, uint16_t low);
 void split_cluster_number(uint32_t cluster, uint16_t *high, uint16_t *low);
 
 // ===============================
 // File name handling
 // ===============================
-int fat32_compare_sfn(char *name, uint32_t length, const FatDir_Type *entry);
+int fat32_compare_sfn(const char *name, uint32_t length, const FatDir_Type *entry);
 
 /**
  * Извлекает путь к директории из полного пути к файлу/каталогу.
@@ -54,50 +93,29 @@ int fat32_compare_sfn(char *name, uint32_t length, const FatDir_Type *entry);
  * @return 0 при успехе,
  *          FAT32_ERR_INVALID_ARGUMENT если аргументы некорректны,
  *         FAT32_ERR_INVALID_PATH если не найден символ '/',
- *         FAT32_ERR_ALLOC_FAILED при ошибке выделения памяти.
+ *         FAT32_ERR_NAME_TOO_LONG если путь не помещается в буфер.
  */
 int get_dir_path(char *path, char *dir_path, int size)
 {
-    if (path == NULL || dir_path == NULL)
+    if (path == NULL || dir_path == NULL || size <= 0)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
 
-    int length = strlen(path);
-    int status = 0;
-
-    char *pathToFile = fat32_alloc(length);
-    if (pathToFile == NULL)
+    uint32_t parent_length = 0, name_length = 0;
+    const char *name = NULL;
+    int status = fat32_path_split(path, strlen(path), &parent_length, &name, &name_length);
+    if (status != 0)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        return status;
     }
-
-    // Если в конце пути указан / заменяем на конец строки
-    strcpy(pathToFile, path);
-    if (length > 0 && pathToFile[length - 1] == '/')
-        *(pathToFile + (length - 1)) = '\0';
-
-    // Ищем последний символ '/'
-    char *last_slash = fat32_find_last_char(pathToFile, '/');
-    if (last_slash == NULL)
+    if (parent_length >= (uint32_t)size)
     {
-        status = fat32_free(pathToFile, length);
-        if (status != 0)
-        {
-            // вывести в лог
-        };
-        return FAT32_ERR_INVALID_PATH;
+        return FAT32_ERR_NAME_TOO_LONG;
     }
 
-    // Извлекаем путь до директории
-    size_t path_len = last_slash - pathToFile + 1;
-    strncpy(dir_path, pathToFile, path_len);
-    dir_path[path_len] = '\0';
-    status = fat32_free(pathToFile, length);
-    if (status != 0)
-    {
-        // вывести в лог
-    };
+    memcpy(dir_path, path, parent_length);
+    dir_path[parent_length] = '\0';
     return 0;
 }
 
@@ -107,11 +125,11 @@ int get_dir_path(char *path, char *dir_path, int size)
  * Например, из "/folder1/folder2/file.txt" вернёт "file.txt".
  *
  * @param path           Полный путь.
- * @param name_component Буфер для записи последней компоненты пути.
+ * @param name_component Буфер для записи последней компоненты пути (не менее MAX_NAME_SIZE байт).
  * @return 0 при успехе,
  *         FAT32_ERR_INVALID_ARGUMENT если path или name_component равны NULL,
  *         FAT32_ERR_INVALID_PATH если в пути не найдено ни одного '/',
- *         FAT32_ERR_ALLOC_FAILED при ошибке выделения памяти.
+ *         FAT32_ERR_NAME_TOO_LONG если имя длиннее MAX_NAME_SIZE - 1 символов.
  */
 int get_last_path_component(char *path, char *name_component)
 {
@@ -120,40 +138,20 @@ int get_last_path_component(char *path, char *name_component)
         return FAT32_ERR_INVALID_ARGUMENT;
     }
 
-    int length = strlen(path);
-    int status = 0;
-    char *pathToFile = fat32_alloc(length);
-    if (pathToFile == NULL)
-    {
-        return FAT32_ERR_ALLOC_FAILED;
-    }
-
-    strcpy(pathToFile, path);
-    if (length > 0 && pathToFile[length - 1] == '/')
-    {
-        pathToFile[length - 1] = '\0';
-    }
-
-    // Ищем последнее вхождение символа '/'
-    char *last_slash = fat32_find_last_char(pathToFile, '/');
-    if (last_slash == NULL)
+    uint32_t parent_length = 0, name_length = 0;
+    const char *name = NULL;
+    int status = fat32_path_split(path, strlen(path), &parent_length, &name, &name_length);
+    if (status != 0)
     {
-        status = fat32_free(pathToFile, length);
-        if (status != 0)
-        {
-            // вывести в лог
-        }
-        return FAT32_ERR_INVALID_PATH;
+        return status;
     }
-    // Копируем имя файла/директории в name_component
-    strcpy(name_component, last_slash + 1);
-
-    status = fat32_free(pathToFile, length);
-    if (status != 0)
+    if (name_length >= MAX_NAME_SIZE)
     {
-        // вывести в лог
+        return FAT32_ERR_NAME_TOO_LONG;
     }
 
+    memcpy(name_component, name, name_length);
+    name_component[name_length] = '\0';
     return 0;
 }
 
@@ -232,8 +230,12 @@ int seek_file_fat32(FAT32_File *file, int32_t offset, SEEK_Mode mode)
     }
     int32_t position = 0;
     uint32_t bytes_per_cluster = fat_info->bytesPerSec * fat_info->secPerClus;
-    uint32_t count_cluster = offset / bytes_per_cluster;
-    int status = 0;
+    // Отложенные данные записываются до перемещения позиции
+    int status = drain_delay_buffer(file);
+    if (status != 0)
+    {
+        return status;
+    }
 
     if (mode == F_SEEK_SET)
     {
@@ -257,7 +259,17 @@ int seek_file_fat32(FAT32_File *file, int32_t offset, SEEK_Mode mode)
         return FAT32_ERR_INVALID_POSITION;
     }
 
-    if (mode == F_SEEK_SET || mode == F_SEEK_END)
+    uint32_t count_cluster = position / bytes_per_cluster;
+    uint32_t offset_in_cluster = position % bytes_per_cluster;
+    // Позиция на границе кластера задаётся концом предыдущего: следующего кластера
+    // в цепочке может ещё не быть (файл, занимающий ровно N кластеров)
+    if (offset_in_cluster == 0 && count_cluster > 0)
+    {
+        --count_cluster;
+        offset_in_cluster = bytes_per_cluster;
+    }
+
+    if (mode != F_SEEK_CUR || count_cluster < file->position.cluster_idx)
     {
         file->position.cluster_number = file->first_cluster;
         file->position.cluster_idx = 0;
@@ -266,11 +278,10 @@ int seek_file_fat32(FAT32_File *file, int32_t offset, SEEK_Mode mode)
     }
 
     uint32_t next_cluster = file->position.cluster_number;
-    uint32_t offset_in_cluster = position % bytes_per_cluster;
 
     while (file->position.cluster_idx != count_cluster)
     {
-        status = get_next_cluster_fat32(&next_cluster);
+        status = file_next_cluster(file, &next_cluster);
         if (status == -1 || next_cluster == FILE_END_TABLE_FAT32)
         {
             return FAT32_ERR_CLUSTER_CHAIN_BROKEN;
@@ -279,99 +290,96 @@ int seek_file_fat32(FAT32_File *file, int32_t offset, SEEK_Mode mode)
     }
 
     file->position.cluster_number = next_cluster;
+    if (offset_in_cluster == bytes_per_cluster)
+    {
+        file->position.sector_idx = fat_info->secPerClus - 1;
+        file->position.byte_offset = fat_info->bytesPerSec;
+        return 0;
+    }
     file->position.sector_idx = offset_in_cluster / fat_info->bytesPerSec;
     file->position.byte_offset = offset_in_cluster % fat_info->bytesPerSec;
     return 0;
 }
 
 /**
- * Освобождает цепочку кластеров в FAT32, начиная с указанного кластера.
+ * Копирует фрагмент имени из LFN-записи в буфер полного имени (UTF-16).
  *
- * Функция проходит по цепочке кластеров, начиная с `cluster`, и помечает каждый кластер как свободный.
- *
- * @param cluster Начальный кластер для освобождения.
- * @return 0 при успешном освобождении,
- *         FAT32_ERR_FS_NOT_LOADED если файловая система не инициализирована,
- *         код ошибки из get_next_cluster_fat32 при ошибке чтения,
- *         FAT32_ERR_UPDATE_FAILED при ошибке обновления таблицы FAT.
+ * @param lfn_entry   LFN-запись.
+ * @param buffer_name Буфер полного имени (LFN_BUFFER_SIZE символов).
  */
-int free_cluster_fat32(uint32_t cluster)
+static void copy_lfn_fragment(const LDIR_Type *lfn_entry, uint16_t *buffer_name)
 {
-    if (fat_info == NULL)
-        return FAT32_ERR_FS_NOT_LOADED;
-
-    uint32_t next_cluster = 0;
-    int status = 0;
-    while (1)
-    {
-        next_cluster = cluster;
-        status = get_next_cluster_fat32(&next_cluster);
-        if (status != 0)
-        {
-            return status;
-        }
-        if (next_cluster == FILE_END_TABLE_FAT32)
-        {
-            break;
-        }
-        status = update_fat32(cluster, NOT_USED_CLUSTER_FAT32);
-        if (status != 0)
-        {
-            return FAT32_ERR_UPDATE_FAILED;
-        }
-        cluster = next_cluster;
-    }
-
-    // Освободить последний кластер
-    status = update_fat32(cluster, NOT_USED_CLUSTER_FAT32);
-    if (status != 0)
-    {
-        return FAT32_ERR_UPDATE_FAILED;
-    }
-    return 0;
+    uint8_t order = lfn_entry->LDIR_Ord & ~LFN_ENTRY_LAST;
+    uint32_t idx = (order - 1) * MAX_SYMBOLS_ENTRY;
+    if (order == 0 || order > LFN_MAX_ENTRIES)
+        return;
+    stm_memcpy((uint8_t *)(&buffer_name[idx]), lfn_entry->LDIR_Name1, sizeof(lfn_entry->LDIR_Name1));
+    idx += sizeof(lfn_entry->LDIR_Name1) / 2;
+    stm_memcpy((uint8_t *)&buffer_name[idx], lfn_entry->LDIR_Name2, sizeof(lfn_entry->LDIR_Name2));
+    idx += sizeof(lfn_entry->LDIR_Name2) / 2;
+    stm_memcpy((uint8_t *)&buffer_name[idx], lfn_entry->LDIR_Name3, sizeof(lfn_entry->LDIR_Name3));
 }
 
 /**
- * Ищет запись файла или папки по имени в указанном родительском кластере.
+ * Ищет запись с заданным именем в каталоге.
  *
- * Функция перебирает все сектора в кластере и его цепочке, обрабатывая как обычные имена (8.3),
- * так и длинные имена (LFN). Если запись найдена, позиция сохраняется в структуре entry_pos.
- *
- * @param name           Имя файла или папки, которое необходимо найти (длинное имя поддерживается).
- * @param parent_cluster Кластер каталога, в котором производится поиск.
- * @param entry_pos      Указатель на структуру DirEntryPosition, в которую будет записано положение найденной записи.
+ * Каждый сектор каталога обрабатывается группами записей ядром fat32_scan_dir_entries:
+ * свободные, удалённые и заведомо неподходящие записи отбрасываются по битовым маскам,
+ * а сборка длинного имени выполняется только для LFN-групп, чей первый LDIR_Ord
+ * соответствует длине искомого имени, и для SFN-записей с совпадающим первым символом.
  *
- * @return 0 — если запись найдена,
- *         FAT32_ERR_INVALID_ARGUMENT — если указаны некорректные параметры (например, name == NULL),
- *         FAT32_ERR_ENTRY_NOT_FOUND — если запись с заданным именем не найдена,
- *         FAT32_ERR_ENTRY_CORRUPTED — если структура LFN повреждена или нарушена,
- *         FAT32_ERR_READ_FAIL — если произошла ошибка чтения с SD-карты,
- *         FAT32_ERR_ALLOC_FAILED — если не удалось выделить буфер из пула памяти.
+ * @param name_utf16   Имя в UTF-16 для сравнения с длинными именами.
+ * @param length_utf16 Длина имени в UTF-16 (<= 0 — имя не может быть длинным).
+ * @param name         Имя файла или папки (не обязательно завершённое нулём).
+ * @param length       Длина имени.
+ * @param dir_cluster  Первый кластер каталога.
+ * @param ref          [out] Положение группы записей и копия SFN-записи.
+ * @return 0 — запись найдена,
+ *         FAT32_ERR_ENTRY_NOT_FOUND — запись не найдена,
+ *         FAT32_ERR_READ_FAIL / FAT32_ERR_ALLOC_FAILED — ошибки ввода-вывода и памяти.
  */
-int find_entry_by_name(const char *name, uint32_t parent_cluster, DirEntryPosition *entry_pos)
+static int scan_dir_for_name(const uint16_t *name_utf16, int length_utf16, const char *name, uint32_t length,
+                             uint32_t dir_cluster, DirEntryRef *ref)
 {
-    if (name == NULL)
+    if (name == NULL || length == 0 || ref == NULL)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
     uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
     if (buffer == NULL)
     {
         return FAT32_ERR_ALLOC_FAILED;
     }
-    uint32_t current_cluster = parent_cluster;
-    uint32_t address = (current_cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
-    uint32_t sector = 0, idxEntry = 0;
-    int status = 0;
 
-    FatDir_Type *entry;
-    uint8_t lfn_active = 0;
-    uint8_t check_sum = 0;
+    uint32_t current_cluster = dir_cluster;
+    uint32_t address = 0;
+    uint32_t sector = 0, group = 0, idx = 0, limit = 0;
+    uint32_t entries_per_sector = fat_info->bytesPerSec / sizeof(FatDir_Type);
+    int status = FAT32_ERR_ENTRY_NOT_FOUND;
+
+    // Первая физическая LFN-запись содержит последний фрагмент имени и флаг LFN_ENTRY_LAST
+    uint8_t lfn_count = (length_utf16 > 0) ? (length_utf16 + LFN_NAME_LENGTH - 1) / LFN_NAME_LENGTH : 0;
+    uint8_t lfn_ord = (length_utf16 > 0) ? (LFN_ENTRY_LAST | lfn_count) : 0;
+
+    // Имя в формате 8.3 может совпасть с короткой записью
+    char sfn_name[SHORT_NAME_SIZE];
+    uint8_t sfn_first = 0;
+    if (length <= SHORT_NAME_SIZE + 1)
+    {
+        fat32_format_sfn(name, length, sfn_name);
+        sfn_first = (uint8_t)sfn_name[0];
+    }
 
-    uint8_t idx = 0;
-    uint8_t order = 0;
-    uint32_t length = strlen(name);
-    uint16_t buffer_name[MAX_NAME_SIZE] = {0};
+    Fat32DirScanMask mask;
+    FatDir_Type *entry = NULL;
+    uint8_t lfn_next = 0;    // ожидаемый порядковый номер следующей LFN-записи
+    uint8_t lfn_active = 0;  // собирается LFN-группа искомой длины
+    uint8_t check_sum = 0;
+    DirEntryPosition lfn_start = {0};
 
     while (current_cluster != FILE_END_TABLE_FAT32)
     {
@@ -379,84 +387,103 @@ int find_entry_by_name(const char *name, uint32_t parent_cluster, DirEntryPositi
 
         for (sector = 0; sector < fat_info->secPerClus; ++sector)
         {
-            status = fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec);
-            if (status < 0)
+            if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
             {
                 status = FAT32_ERR_READ_FAIL;
                 goto cleanup;
             }
-            for (idxEntry = 0; idxEntry < fat_info->bytesPerSec; idxEntry += sizeof(FatDir_Type))
+            for (group = 0; group < entries_per_sector; group += FAT32_SCAN_DIR_GROUP)
             {
-                entry = (FatDir_Type *)&buffer[idxEntry];
-                if (entry->DIR_Name[0] == ENTRY_FREE_FULL_FAT32)
-                {
-                    status = FAT32_ERR_ENTRY_NOT_FOUND;
-                    goto cleanup;
-                }
-                else if (entry->DIR_Name[0] == ENTRY_FREE_FAT32)
+                uint32_t count = entries_per_sector - group;
+                if (count > FAT32_SCAN_DIR_GROUP)
+                    count = FAT32_SCAN_DIR_GROUP;
+                fat32_scan_dir_entries(&buffer[group * sizeof(FatDir_Type)], count, lfn_ord, sfn_first, &mask);
+
+                limit = (mask.end != 0) ? (uint32_t)__builtin_ctz(mask.end) : count;
+                for (idx = 0; idx < limit; ++idx)
                 {
-                    if (lfn_active)
+                    uint32_t bit = (uint32_t)1 << idx;
+                    if (!lfn_active)
                     {
-                        status = FAT32_ERR_ENTRY_CORRUPTED;
-                        goto cleanup;
+                        // Переход сразу к следующему кандидату группы
+                        uint32_t pending = mask.candidates & ~(bit - 1);
+                        if (pending == 0)
+                            break;
+                        idx = __builtin_ctz(pending);
+                        if (idx >= limit)
+                            break;
+                        bit = (uint32_t)1 << idx;
                     }
-                    continue;
-                }
-                else if ((entry->DIR_Attr & ATTR_LONG_NAME_MASK) == ATTR_LONG_NAME)
-                {
-                    LDIR_Type *lfn_entry = (LDIR_Type *)entry;
-                    if (lfn_entry->LDIR_Ord & LFN_ENTRY_LAST)
-                        check_sum = lfn_entry->LDIR_Chksum;
-                    if (lfn_entry->LDIR_Type != 0)
-                        continue;
-                    order = lfn_entry->LDIR_Ord & ~LFN_ENTRY_LAST;
-
-                    idx = (order - 1) * MAX_SYMBOLS_ENTRY;
-                    stm_memcpy((uint8_t *)(&buffer_name[idx]), lfn_entry->LDIR_Name1, sizeof(lfn_entry->LDIR_Name1));
-                    idx += sizeof(lfn_entry->LDIR_Name1) / 2;
-                    stm_memcpy((uint8_t *)&buffer_name[idx], lfn_entry->LDIR_Name2, sizeof(lfn_entry->LDIR_Name2));
-                    idx += sizeof(lfn_entry->LDIR_Name2) / 2;
-                    stm_memcpy((uint8_t *)&buffer_name[idx], lfn_entry->LDIR_Name3, sizeof(lfn_entry->LDIR_Name3));
-                    lfn_active = 1;
-                }
-                else
-                {
+                    entry = (FatDir_Type *)&buffer[(group + idx) * sizeof(FatDir_Type)];
+
                     if (lfn_active)
                     {
-                        if (fat32_sfn_checksum((uint8_t *)entry->DIR_Name) == check_sum)
+                        LDIR_Type *lfn_entry = (LDIR_Type *)entry;
+                        if ((mask.lfn & bit) && lfn_next != 0 && lfn_entry->LDIR_Ord == lfn_next &&
+                            lfn_entry->LDIR_Chksum == check_sum &&
+                            fat32_compare_lfn_fragment(name_utf16, length_utf16, lfn_entry) == 0)
+                        {
+                            --lfn_next;
+                            continue;
+                        }
+                        if ((mask.sfn & bit) && lfn_next == 0 &&
+                            fat32_sfn_checksum(entry->DIR_Name) == check_sum)
                         {
-                            if (fat32_compare_lfn(name, buffer_name) == 0)
-                            {
-                                entry_pos->cluster = parent_cluster;
-                                entry_pos->sector = sector;
-                                entry_pos->offset = (idxEntry / sizeof(LDIR_Type));
-                                status = 0;
-                                goto cleanup;
-                            }
+                            ref->lfn_position = lfn_start;
+                            ref->entry_count = lfn_count + 1;
+                            goto found;
                         }
+                        // Группа не совпала: запись рассматривается заново как возможный кандидат
                         lfn_active = 0;
-                        check_sum = 0;
-                        memset(buffer_name, 0x00, sizeof(buffer_name));
+                        if ((mask.candidates & bit) == 0)
+                            continue;
+                    }
+
+                    if (mask.lfn & bit)
+                    {
+                        LDIR_Type *lfn_entry = (LDIR_Type *)entry;
+                        // Первым читается последний фрагмент: он же проверяет длину имени
+                        if (lfn_entry->LDIR_Type != 0 || fat32_compare_lfn_fragment(name_utf16, length_utf16, lfn_entry) != 0)
+                            continue;
+                        check_sum = lfn_entry->LDIR_Chksum;
+                        lfn_next = lfn_count - 1;
+                        lfn_active = 1;
+                        lfn_start.cluster = current_cluster;
+                        lfn_start.sector = sector;
+                        lfn_start.offset = group + idx;
                     }
                     else if (fat32_compare_sfn(name, length, entry) == 0)
                     {
-                        entry_pos->cluster = parent_cluster;
-                        entry_pos->sector = sector;
-                        entry_pos->offset = idxEntry / sizeof(FatDir_Type);
-                        status = 0;
-                        goto cleanup;
+                        ref->lfn_position.cluster = current_cluster;
+                        ref->lfn_position.sector = sector;
+                        ref->lfn_position.offset = group + idx;
+                        ref->entry_count = 1;
+                        goto found;
                     }
                 }
+                if (mask.end != 0)
+                {
+                    status = FAT32_ERR_ENTRY_NOT_FOUND;
+                    goto cleanup;
+                }
             }
-            status = get_next_cluster_fat32(&current_cluster);
-            if (status != 0)
-            {
-                status = FAT32_ERR_READ_FAIL;
-                goto cleanup;
-            }
+        }
+        if (get_next_cluster_fat32(&current_cluster) != 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
         }
     }
     status = FAT32_ERR_ENTRY_NOT_FOUND;
+    goto cleanup;
+
+found:
+    ref->parent_cluster = dir_cluster;
+    ref->position.cluster = current_cluster;
+    ref->position.sector = sector;
+    ref->position.offset = group + idx;
+    stm_memcpy((uint8_t *)&ref->entry, (uint8_t *)entry, sizeof(FatDir_Type));
+    status = 0;
 
 cleanup:
     if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
@@ -467,112 +494,405 @@ cleanup:
 }
 
 /**
- * Инициализирует дескриптор файла FAT32 для работы с файлом.
- *
- * @param file_name       Имя файла для открытия.
- * @param parent_cluster  Кластер родительской директории.
- * @param mode            Режим доступа: F_READ, F_WRITE или F_APPEND.
+ * Строит индекс имён каталога и заполняет фильтр имён одним проходом по его записям.
  *
- * @return Указатель на структуру FAT32_File или NULL при ошибке.
+ * @param dir_cluster Первый кластер каталога.
+ * @return 0 при успехе, иначе код ошибки (фильтр и индекс при этом не создаются).
  */
-FAT32_File *init_file_handle(const char *file_name, uint32_t parent_cluster, uint8_t mode)
+static int build_dir_index(uint32_t dir_cluster)
 {
-    if (file_name == NULL)
+    int status = 0;
+    // Если индекс не помещается в бюджет, фильтр всё равно заполняется
+    int with_index = (fat32_dir_cache_build_begin(dir_cluster) == 0);
+    fat32_dir_cache_filter_begin(dir_cluster);
+
+    FAT32_Dir dir;
+    FAT32_DirInfo info;
+    DirEntryPosition group;
+    uint16_t group_count = 0;
+    memset((uint8_t *)&dir, 0, sizeof(FAT32_Dir));
+    dir.first_cluster = dir_cluster;
+
+    while ((status = read_dir_group(&dir, &info, &group, &group_count)) > 0)
     {
-        return NULL;
+        fat32_dir_cache_add(dir_cluster, fat32_name_hash(info.name, strlen(info.name)), &group, group_count);
+    }
+    if (dir.buffer != NULL)
+    {
+        if (fat32_free(dir.buffer, fat_info->bytesPerSec) != 0)
+        {
+            // Вывод в лог
+        }
+    }
+    if (with_index)
+    {
+        fat32_dir_cache_build_end(dir_cluster, status);
     }
+    fat32_dir_cache_filter_end(dir_cluster, status);
+    return status;
+}
 
-    // Поиск записи директории по имени файла
+/**
+ * Ищет имя проходом по группам записей каталога, попутно заполняя фильтр имён.
+ *
+ * Используется, когда фильтр каталога ещё не заполнен, а индекса нет: если имени
+ * в каталоге нет, проход доходит до конца и фильтр становится готовым без
+ * отдельного чтения каталога. При совпадении проход прекращается, а неполный
+ * фильтр отбрасывается.
+ *
+ * Параметры имени — как у scan_dir_for_name.
+ *
+ * @param hash Хеш имени (fat32_name_hash).
+ * @return 0 — запись найдена, FAT32_ERR_ENTRY_NOT_FOUND — нет, иначе код ошибки.
+ */
+static int scan_dir_by_hash(const uint16_t *name_utf16, int length_utf16, const char *name, uint32_t length,
+                            uint32_t hash, uint32_t dir_cluster, DirEntryRef *ref)
+{
+    FAT32_Dir dir;
+    FAT32_DirInfo info;
+    FatDir_Type group[LFN_MAX_ENTRIES + 1];
     DirEntryPosition position;
-    int status = find_entry_by_name(file_name, parent_cluster, &position);
-    if (status != 0)
+    uint16_t count = 0;
+    int status = 0;
+    memset((uint8_t *)&dir, 0, sizeof(FAT32_Dir));
+    dir.first_cluster = dir_cluster;
+
+    fat32_dir_cache_filter_begin(dir_cluster);
+    while ((status = read_dir_group(&dir, &info, &position, &count)) > 0)
     {
-        return NULL;
+        uint32_t group_hash = fat32_name_hash(info.name, strlen(info.name));
+        fat32_dir_cache_add(dir_cluster, group_hash, &position, count);
+        if (group_hash != hash || count > LFN_MAX_ENTRIES + 1)
+        {
+            continue;
+        }
+        status = read_dir_entries_at(&position, group, count);
+        if (status != 0)
+        {
+            break;
+        }
+        if (match_dir_group(name_utf16, length_utf16, name, length, group, count) == 0)
+        {
+            ref->parent_cluster = dir_cluster;
+            ref->lfn_position = position;
+            ref->position = position;
+            ref->entry_count = count;
+            stm_memcpy((uint8_t *)&ref->entry, (uint8_t *)&group[count - 1], sizeof(FatDir_Type));
+            status = dir_position_advance(&ref->position, count - 1);
+            if (status == 0)
+            {
+                status = 1;
+            }
+            break;
+        }
     }
-
-    // Чтение записи директории по найденной позиции
-    FatDir_Type entry = {0};
-    status = read_directory_entry_fat32(&position, &entry);
-    if (status != 0)
+    if (dir.buffer != NULL)
     {
-        return NULL;
+        if (fat32_free(dir.buffer, fat_info->bytesPerSec) != 0)
+        {
+            // Вывод в лог
+        }
     }
 
-    // Выделение памяти из пула и инициализация дескриптора
-    FAT32_File *desc = fat32_alloc(sizeof(FAT32_File));
-    if (desc == NULL)
+    // Фильтр готов, только если каталог прочитан до конца
+    fat32_dir_cache_filter_end(dir_cluster, (status == 0) ? 0 : -1);
+    if (status == 0)
     {
-        return NULL;
+        return FAT32_ERR_ENTRY_NOT_FOUND;
     }
+    return (status == 1) ? 0 : status;
+}
 
-    memset((uint8_t *)desc, 0, sizeof(FAT32_File));
-    join_cluster_number(&desc->first_cluster, entry.DIR_FstClusHI, entry.DIR_FstClusLO);
-    stm_memcpy((uint8_t *)&desc->entry_pos, (uint8_t *)&position, sizeof(DirEntryPosition));
-
-    if (mode == F_READ)
+/**
+ * Проверяет, что группа записей каталога соответствует имени.
+ *
+ * Имя сравнивается с длинным именем группы (если LFN-записи целы и их контрольная
+ * сумма совпадает с SFN-записью), затем с коротким именем.
+ *
+ * @param name_utf16   Имя в UTF-16 для сравнения с длинным именем.
+ * @param length_utf16 Длина имени в UTF-16 (<= 0 — имя не может быть длинным).
+ * @param name         Исходное имя для сравнения с коротким именем.
+ * @param length       Длина исходного имени.
+ * @param group Записи группы: LFN-записи и последняя SFN-запись.
+ * @param count Количество записей группы.
+ * @return 0 — имя совпадает, -1 — не совпадает.
+ */
+static int match_dir_group(const uint16_t *name_utf16, int length_utf16, const char *name, uint32_t length,
+                           const FatDir_Type *group, uint16_t count)
+{
+    const FatDir_Type *sfn = &group[count - 1];
+    if (group[0].DIR_Name[0] == ENTRY_FREE_FAT32 || group[0].DIR_Name[0] == ENTRY_FREE_FULL_FAT32 ||
+        (sfn->DIR_Attr & ATTR_LONG_NAME_MASK) == ATTR_LONG_NAME)
     {
-        desc->size_bytes = entry.DIR_FileSize;
-        desc->flags = F_READ;
-        status = seek_file_fat32(desc, 0, F_SEEK_SET);
+        return -1;
     }
-    else if (mode == F_WRITE)
+
+    if (count > 1 && length_utf16 > 0)
     {
-        // Очистка последующих кластеров, если они есть
-        uint32_t next_cluster = desc->first_cluster;
-        while (1)
+        uint8_t check_sum = fat32_sfn_checksum(sfn->DIR_Name);
+        uint16_t idx = 0;
+        for (idx = 0; idx < count - 1; ++idx)
         {
-            status = get_next_cluster_fat32(&next_cluster);
-            if (status != 0)
-            {
-                goto cleanup;
-            }
-
-            if (next_cluster == FILE_END_TABLE_FAT32)
+            const LDIR_Type *lfn_entry = (const LDIR_Type *)&group[idx];
+            if ((lfn_entry->LDIR_Attr & ATTR_LONG_NAME_MASK) != ATTR_LONG_NAME ||
+                lfn_entry->LDIR_Chksum != check_sum ||
+                (lfn_entry->LDIR_Ord & ~LFN_ENTRY_LAST) != count - 1 - idx ||
+                ((lfn_entry->LDIR_Ord & LFN_ENTRY_LAST) != 0) != (idx == 0) ||
+                fat32_compare_lfn_fragment(name_utf16, length_utf16, lfn_entry) != 0)
             {
                 break;
             }
-
-            status = free_cluster_fat32(next_cluster);
-            if (status != 0)
-            {
-                goto cleanup;
-            }
         }
+        if (idx == count - 1)
+        {
+            return 0;
+        }
+    }
+    return fat32_compare_sfn(name, length, sfn);
+}
 
-        desc->flags = F_WRITE;
-        desc->size_bytes = 0;
-        status = seek_file_fat32(desc, 0, F_SEEK_SET);
+/**
+ * Ищет запись с заданным именем в каталоге, используя индекс имён, если он доступен.
+ *
+ * При первом обращении к каталогу за один проход заполняется фильтр имён и строится
+ * индекс (если позволяет бюджет fat32_dir_cache). Имя, которого заведомо нет по
+ * фильтру, отвергается без чтения носителя; каждое совпадение хеша в индексе
+ * проверяется чтением только самой группы записей. Без индекса выполняется
+ * линейный поиск scan_dir_for_name.
+ *
+ * @return 0 — запись найдена, FAT32_ERR_ENTRY_NOT_FOUND — нет, иначе код ошибки.
+ */
+static int find_dir_entry(const char *name, uint32_t length, uint32_t dir_cluster, DirEntryRef *ref)
+{
+    if (name == NULL || length == 0 || length > MAX_NAME_SIZE || ref == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
-    else if (mode == F_APPEND)
+
+    uint32_t hash = fat32_name_hash(name, length);
+    int ready = fat32_dir_cache_ready(dir_cluster);
+    if (ready == 0 && build_dir_index(dir_cluster) == 0)
     {
-        // Установка позиции в конец файла
-        desc->flags = F_APPEND;
-        desc->size_bytes = entry.DIR_FileSize;
-        status = seek_file_fat32(desc, desc->size_bytes, F_SEEK_SET);
+        ready = fat32_dir_cache_ready(dir_cluster);
     }
-    if (status == 0)
+    int present = fat32_dir_cache_filter_test(dir_cluster, hash);
+
+    // Псевдонимы вида NAME~N.EXT индексируются только через длинное имя
+    int alias = (memchr(name, '~', length) != NULL);
+    if (present == 0 && !alias)
     {
-        return desc;
+        return FAT32_ERR_ENTRY_NOT_FOUND;
     }
 
-cleanup:
-    if (desc != NULL)
+    // Длинные имена хранятся в UTF-16: имя перекодируется один раз для всех сравнений
+    // и передаётся в функции сканирования. Некорректное или слишком длинное имя может
+    // совпасть только с короткой записью.
+    uint16_t name_utf16[MAX_NAME_SIZE];
+    int length_utf16 = fat32_utf8_to_utf16le(name, length, name_utf16, MAX_NAME_SIZE);
+    if (ready != 1)
     {
-        if (fat32_free(desc, sizeof(FAT32_File)) != 0)
+        if (present == FAT32_ERR_NOT_FOUND && !alias)
         {
-            // Вывод в лог
+            return scan_dir_by_hash(name_utf16, length_utf16, name, length, hash, dir_cluster, ref);
         }
+        return scan_dir_for_name(name_utf16, length_utf16, name, length, dir_cluster, ref);
     }
-    return NULL;
-}
 
-int flush_fat32(FAT32_File *file)
+    FatDir_Type group[LFN_MAX_ENTRIES + 1];
+    DirEntryPosition position;
+    uint16_t count = 0;
+    uint32_t cursor = 0;
+    int status = 0;
+
+    while ((status = fat32_dir_cache_find(dir_cluster, hash, &cursor, &position, &count)) > 0)
+    {
+        if (count == 0 || count > LFN_MAX_ENTRIES + 1)
+        {
+            continue;
+        }
+        status = read_dir_entries_at(&position, group, count);
+        if (status != 0)
+        {
+            return status;
+        }
+        if (match_dir_group(name_utf16, length_utf16, name, length, group, count) != 0)
+        {
+            continue;
+        }
+
+        ref->parent_cluster = dir_cluster;
+        ref->lfn_position = position;
+        ref->position = position;
+        ref->entry_count = count;
+        stm_memcpy((uint8_t *)&ref->entry, (uint8_t *)&group[count - 1], sizeof(FatDir_Type));
+        return dir_position_advance(&ref->position, count - 1);
+    }
+
+    if (alias)
+    {
+        return scan_dir_for_name(name_utf16, length_utf16, name, length, dir_cluster, ref);
+    }
+    return FAT32_ERR_ENTRY_NOT_FOUND;
+}
+
+/**
+ * Ищет запись файла или папки по имени в указанном родительском кластере.
+ *
+ * Обрабатываются как обычные имена (8.3), так и длинные имена (LFN).
+ * Если запись найдена, позиция сохраняется в структуре entry_pos.
+ *
+ * @param name           Имя файла или папки, которое необходимо найти (длинное имя поддерживается).
+ * @param parent_cluster Кластер каталога, в котором производится поиск.
+ * @param entry_pos      Указатель на структуру DirEntryPosition, в которую будет записано положение найденной записи.
+ *
+ * @return 0 — если запись найдена,
+ *         FAT32_ERR_INVALID_ARGUMENT — если указаны некорректные параметры (например, name == NULL),
+ *         FAT32_ERR_ENTRY_NOT_FOUND — если запись с заданным именем не найдена,
+ *         FAT32_ERR_READ_FAIL — если произошла ошибка чтения с SD-карты,
+ *         FAT32_ERR_ALLOC_FAILED — если не удалось выделить буфер из пула памяти.
+ */
+int find_entry_by_name(const char *name, uint32_t parent_cluster, DirEntryPosition *entry_pos)
+{
+    if (name == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    DirEntryRef ref;
+    int status = find_dir_entry(name, strlen(name), parent_cluster, &ref);
+    if (status == 0 && entry_pos != NULL)
+    {
+        *entry_pos = ref.position;
+    }
+    return status;
+}
+
+/**
+ * Сравнивает положения записей каталога по полям (структура содержит байты выравнивания).
+ */
+static int same_entry_position(const DirEntryPosition *a, const DirEntryPosition *b)
+{
+    return a->cluster == b->cluster && a->sector == b->sector && a->offset == b->offset;
+}
+
+/**
+ * Регистрирует открытый дескриптор и исключает его из списка при закрытии.
+ */
+static void open_files_add(FAT32_File *file)
+{
+    file->next_open = open_files;
+    open_files = file;
+}
+
+static void open_files_remove(const FAT32_File *file)
+{
+    for (FAT32_File **link = &open_files; *link != NULL; link = &(*link)->next_open)
+    {
+        if (*link == file)
+        {
+            *link = file->next_open;
+            return;
+        }
+    }
+}
+
+/**
+ * Инициализирует дескриптор файла FAT32 для работы с файлом.
+ *
+ * Запись каталога уже найдена резолвером пути, поэтому повторный поиск по имени
+ * и повторное чтение сектора записи не выполняются.
+ *
+ * @param ref   Найденная запись файла.
+ * @param mode  Режим доступа: F_READ, F_WRITE или F_APPEND.
+ *
+ * @return Указатель на структуру FAT32_File или NULL при ошибке.
+ */
+FAT32_File *init_file_handle(const DirEntryRef *ref, uint8_t mode)
+{
+    if (ref == NULL)
+    {
+        return NULL;
+    }
+    int status = 0;
+
+    // Выделение памяти из пула и инициализация дескриптора
+    FAT32_File *desc = fat32_alloc(sizeof(FAT32_File));
+    if (desc == NULL)
+    {
+        return NULL;
+    }
+
+    memset((uint8_t *)desc, 0, sizeof(FAT32_File));
+    join_cluster_number(&desc->first_cluster, ref->entry.DIR_FstClusHI, ref->entry.DIR_FstClusLO);
+    stm_memcpy((uint8_t *)&desc->entry_pos, (uint8_t *)&ref->position, sizeof(DirEntryPosition));
+
+    if (mode == F_READ)
+    {
+        desc->size_bytes = ref->entry.DIR_FileSize;
+        desc->flags = F_READ;
+        status = seek_file_fat32(desc, 0, F_SEEK_SET);
+    }
+    else if (mode == F_WRITE)
+    {
+        // Очистка последующих кластеров, если они есть
+        uint32_t next_cluster = desc->first_cluster;
+        status = get_next_cluster_fat32(&next_cluster);
+        if (status != 0)
+        {
+            goto cleanup;
+        }
+        if (next_cluster != FILE_END_TABLE_FAT32)
+        {
+            status = update_fat32(desc->first_cluster, FILE_END_TABLE_FAT32);
+            if (status != 0)
+            {
+                goto cleanup;
+            }
+            status = queue_chain_release(next_cluster);
+            if (status != 0)
+            {
+                goto cleanup;
+            }
+        }
+
+        desc->flags = F_WRITE;
+        desc->size_bytes = 0;
+        status = seek_file_fat32(desc, 0, F_SEEK_SET);
+    }
+    else if (mode == F_APPEND)
+    {
+        // Установка позиции в конец файла
+        desc->flags = F_APPEND;
+        desc->size_bytes = ref->entry.DIR_FileSize;
+        status = seek_file_fat32(desc, desc->size_bytes, F_SEEK_SET);
+    }
+    if (status == 0)
+    {
+        open_files_add(desc);
+        return desc;
+    }
+
+cleanup:
+    if (desc != NULL)
+    {
+        if (fat32_free(desc, sizeof(FAT32_File)) != 0)
+        {
+            // Вывод в лог
+        }
+    }
+    return NULL;
+}
+
+int flush_fat32(FAT32_File *file)
 {
     if (fat_info == NULL || file == NULL)
         return -1;
 
+    int status = drain_delay_buffer(file);
+    if (status != 0)
+        return status;
+
     FatDir_Type entry = {0};
-    int status = read_directory_entry_fat32(&file->entry_pos, &entry);
+    status = read_directory_entry_fat32(&file->entry_pos, &entry);
     if (status != 0)
         return -2;
 
@@ -607,7 +927,17 @@ int close_file_fat32(FAT32_File **file)
     if (flush_fat32(*file) != 0)
         return FAT32_ERR_FLUSH_FAILED;
 
-    int status = fat32_free(*file, sizeof(FAT32_File));
+    open_files_remove(*file);
+    int status = 0;
+    if ((*file)->delay_buffer != NULL)
+    {
+        status = fat32_free((*file)->delay_buffer, (*file)->delay_capacity);
+        if (status != 0)
+        {
+            // вывод в лог
+        }
+    }
+    status = fat32_free(*file, sizeof(FAT32_File));
     if (status != 0)
     {
         // вывод в лог
@@ -624,7 +954,7 @@ uint32_t tell_fat32(FAT32_File *file)
     }
     uint32_t position = file->position.cluster_idx * fat_info->secPerClus * fat_info->bytesPerSec;
     position = position + file->position.sector_idx * fat_info->bytesPerSec + file->position.byte_offset;
-    return position;
+    return position + file->delay_length;
 }
 
 int read_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t size)
@@ -661,7 +991,7 @@ int read_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t size)
     int status = 0;
 
     if (file->size_bytes == 0)
-        return 0;
+        goto cleanup;
     uint32_t position = tell_fat32(file);
     if (file->size_bytes < (size + position))
     {
@@ -672,6 +1002,12 @@ int read_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t size)
     {
         for (; sector < fat_info->secPerClus; ++sector)
         {
+            // Позиция в конце сектора: данные начинаются со следующего
+            if (shift == fat_info->bytesPerSec)
+            {
+                shift = 0;
+                continue;
+            }
             status = fat_info->device->read(buffer_local, 1, address + sector, fat_info->bytesPerSec);
             if (status < 0)
             {
@@ -696,7 +1032,7 @@ int read_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t size)
             if (countRBytes >= size)
             {
                 file->position.sector_idx = sector;
-                file->position.byte_offset = shift % fat_info->bytesPerSec;
+                file->position.byte_offset = shift;
                 status = 0;
                 goto cleanup;
             }
@@ -728,25 +1064,13 @@ cleanup:
     return (status == 0 ? countRBytes : status);
 }
 
-int write_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t length)
+/**
+ * Записывает данные в файл с текущей позиции, выделяя кластеры при достижении конца цепочки.
+ *
+ * @return количество записанных байт или код ошибки.
+ */
+static int write_file_data(FAT32_File *file, const uint8_t *buffer, uint32_t length)
 {
-    if (file == NULL || buffer == NULL)
-    {
-        return FAT32_ERR_INVALID_ARGUMENT;
-    }
-    if (fat_info == NULL)
-    {
-        return FAT32_ERR_FS_NOT_LOADED;
-    }
-    if (length == 0)
-    {
-        return 0;
-    }
-    if (file->flags == F_READ)
-    {
-        return FAT32_ERR_INVALID_FILE_MODE;
-    }
-
     uint32_t countWBytes = 0;
     uint32_t sector = file->position.sector_idx;
 
@@ -760,6 +1084,8 @@ int write_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t length)
     uint32_t to_copy = 0;
     uint16_t shift = file->position.byte_offset;
     int status = 0;
+    // Кластеры, выделенные при достижении конца цепочки
+    Fat32ClusterAlloc alloc;
     FAT32_LOG_INFO("next_cluster: %d, adderess:%d, shift:%d\r\n", next_cluster, address, shift);
     while (1)
     {
@@ -786,7 +1112,7 @@ int write_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t length)
 
             stm_memcpy(buffer_local + shift, &buffer[countWBytes], to_copy);
             countWBytes += to_copy;
-            shift = 0;
+            shift += to_copy;
 
             // Запись сектора обратно
             status = fat_info->device->write(buffer_local, 1, address + sector, fat_info->bytesPerSec);
@@ -798,7 +1124,8 @@ int write_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t length)
             if (countWBytes >= length)
             {
                 file->position.sector_idx = sector;
-                file->position.byte_offset = to_copy;
+                // Позиция — конец записанных данных в секторе, а не длина последнего фрагмента
+                file->position.byte_offset = shift;
                 file->size_bytes += length;
                 if (fat32_free(buffer_local, fat_info->bytesPerSec) != 0)
                 {
@@ -806,15 +1133,39 @@ int write_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t length)
                 }
                 return countWBytes;
             }
+            shift = 0;
         }
 
-        // Переход к следующему кластеру
+        // Переход к следующему кластеру: внутри известных участков файла FAT не читается
         sector = 0;
-        status = extend_cluster_chain_if_needed(&next_cluster);
+        uint32_t cluster = next_cluster;
+        status = file_next_cluster(file, &cluster);
         if (status != 0)
         {
             goto cleanup;
         }
+        if (cluster == FILE_END_TABLE_FAT32)
+        {
+            // Конец цепочки: кластеры под весь остаток данных выделяются одним вызовом
+            uint32_t cluster_bytes = fat_info->secPerClus * fat_info->bytesPerSec;
+            uint32_t needed = (length - countWBytes + cluster_bytes - 1) / cluster_bytes;
+            if (file->delay_buffer != NULL)
+            {
+                // Пакет отложенных данных размещается одним непрерывным участком, если он есть
+                status = allocate_contiguous(next_cluster, needed, 1, &alloc);
+            }
+            else
+            {
+                status = fat32_allocate_clusters(next_cluster, needed, &alloc);
+            }
+            if (status != 0)
+            {
+                goto cleanup;
+            }
+            file_extents_link(file, next_cluster, &alloc);
+            cluster = alloc.runs[0].first;
+        }
+        next_cluster = cluster;
         address = fat_info->address_region + (next_cluster - fat_info->root_cluster) * fat_info->secPerClus;
         file->position.cluster_idx++;
         file->position.cluster_number = next_cluster;
@@ -828,1415 +1179,3881 @@ cleanup:
 }
 
 /**
- * Создаёт новый файл в указанной директории FAT32.
- *
- * @param cluster_directory  Кластер директории, в которой создаётся файл.
- * @param cluster_file       Указатель, в который будет записан номер первого кластера файла.
- * @param file_name          Имя файла (может быть в формате SFN или LFN).
+ * Записывает накопленные в буфере отложенного выделения данные на носитель.
  *
- * @return 0 при успехе или отрицательное значение — при ошибке.
+ * @return 0 при успехе (в том числе если буфера нет или он пуст), иначе код ошибки;
+ *         при ошибке данные остаются в буфере.
  */
-int create_file_fat32(uint32_t cluster_directory, uint32_t *cluster_file, char *file_name)
+static int drain_delay_buffer(FAT32_File *file)
 {
-    int status = 0;
-    uint16_t length = strlen(file_name);
-
-    if (cluster_file == NULL)
+    if (file->delay_length == 0)
     {
-        return FAT32_ERR_INVALID_ARGUMENT;
+        return 0;
     }
-
-    *cluster_file = FILE_END_TABLE_FAT32;
-
-    int entry_count = 0;
-    FatDir_Type *entries = NULL;
-
-    // выделяем память(кластер) в таблице для нового файла
-    status = allocate_cluster_fat32(cluster_file);
-    if (status != 0)
+    uint32_t length = file->delay_length;
+    file->delay_length = 0;
+    int status = write_file_data(file, file->delay_buffer, length);
+    if (status < 0)
     {
-        return FAT32_ERR_CLUSTER_ALLOC_FAIL;
+        file->delay_length = length;
+        return status;
     }
+    return 0;
+}
 
-    if (validate_fat_sfn_file(file_name) != 0)
+int write_file_fat32(FAT32_File *file, uint8_t *buffer, uint32_t length)
+{
+    if (file == NULL || buffer == NULL)
     {
-        entry_count = ((length + MAX_SYMBOLS_ENTRY) / MAX_SYMBOLS_ENTRY) + 1;
-
-        entries = fat32_alloc(sizeof(LDIR_Type) * entry_count);
-        if (entries == NULL)
-        {
-            return FAT32_ERR_ALLOC_FAILED;
-        }
-
-        FatDir_Type *entry = &entries[entry_count - 1];
-        memset((uint8_t *)entry, 0, sizeof(FatDir_Type));
-        entry->DIR_Attr = ATTR_ARCHIVE;
-
-        split_cluster_number(*cluster_file, &entry->DIR_FstClusHI, &entry->DIR_FstClusLO);
-        fat32_generate_sfn_from_lfn(file_name, length, entry->DIR_Name);
-        uint8_t chksum = fat32_sfn_checksum(entry->DIR_Name);
-        make_lfn_entries(file_name, length, chksum, (LDIR_Type *)entries, entry_count - 1);
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
-    else
+    if (fat_info == NULL)
     {
-        entry_count = 1;
-        entries = fat32_alloc(sizeof(FatDir_Type));
-        if (entries == NULL)
-        {
-            return FAT32_ERR_ALLOC_FAILED;
-        }
-        // Ищем и добавляем запись в родительскую директорию
-        FatDir_Type *entry = &entries[0];
-        memset((uint8_t *)entry, 0, sizeof(FatDir_Type));
-
-        entry->DIR_Attr = ATTR_ARCHIVE;
-        split_cluster_number(*cluster_file, &entry->DIR_FstClusHI, &entry->DIR_FstClusLO);
-        fat32_format_sfn(file_name, length, (char *)entry->DIR_Name);
+        return FAT32_ERR_FS_NOT_LOADED;
     }
-
-    // Найти позицию в директории с нужным количеством свободных записей
-    DirEntryPosition position;
-    status = find_free_dir_entries(cluster_directory, entry_count, &position);
-    if (status != 0)
+    if (length == 0)
     {
-        status = FAT32_ERR_NO_FREE_ENTRIES;
-        goto cleanup;
+        return 0;
     }
-    // Записать в корневую директорию
-    status = write_dir_entries_at(&position, entries, entry_count);
-    if (status != 0)
+    if (file->flags == F_READ)
     {
-        status = FAT32_ERR_WRITE_FAIL;
-        goto cleanup;
+        return FAT32_ERR_INVALID_FILE_MODE;
     }
-
-cleanup:
-    if (fat32_free(entries, sizeof(LDIR_Type) * entry_count) != 0)
+    if (file->delay_buffer == NULL)
     {
-        // вывод в лог
+        return write_file_data(file, buffer, length);
     }
-    return status;
-}
 
-int open_file_fat32(char *path, FAT32_File **file, uint8_t mode)
-{
-    uint32_t cluster_parent = 0;
-    uint32_t file_cluster;
+    // Отложенное выделение: данные копятся в буфере, кластеры выделяются при его сбросе.
+    // При ошибке сброса байты этого вызова из буфера убираются: возвращается число уже
+    // принятых байт (или код ошибки, если не принято ни одного), и повтор записи их не удвоит
+    uint32_t written = 0;
     int status = 0;
+    while (written < length)
+    {
+        if (file->delay_length == 0 && length - written >= file->delay_capacity)
+        {
+            // Запись не меньше буфера идёт напрямую: кластеры под неё и так выделяются одним вызовом
+            status = write_file_data(file, buffer + written, length - written);
+            if (status < 0)
+            {
+                return (written > 0) ? (int)written : status;
+            }
+            return (int)length;
+        }
+        uint32_t to_copy = file->delay_capacity - file->delay_length;
+        if (to_copy > length - written)
+        {
+            to_copy = length - written;
+        }
+        stm_memcpy(file->delay_buffer + file->delay_length, buffer + written, to_copy);
+        file->delay_length += to_copy;
+        if (file->delay_length == file->delay_capacity)
+        {
+            status = drain_delay_buffer(file);
+            if (status != 0)
+            {
+                file->delay_length -= to_copy;
+                return (written > 0) ? (int)written : status;
+            }
+        }
+        written += to_copy;
+    }
+    return written;
+}
 
-    if (path == NULL)
+int fat32_set_delayed_alloc(FAT32_File *file, uint32_t buffer_size)
+{
+    if (file == NULL)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
-
     if (fat_info == NULL)
     {
         return FAT32_ERR_FS_NOT_LOADED;
     }
-
-    // Проверка валидности пути
-    status = validate_path(path);
-    if (status != 0)
+    if (file->flags == F_READ)
     {
-        return FAT32_ERR_INVALID_PATH;
+        return FAT32_ERR_INVALID_FILE_MODE;
     }
 
-    // Получаем имя последнего сегмента
-    char file_name[256];
-    status = get_last_path_component(path, file_name);
+    int status = drain_delay_buffer(file);
     if (status != 0)
     {
         return status;
     }
-
-    // Проверка имени файла на валидность по LFN
-    status = validate_fat_lfn_file(file_name);
-    if (status != 0)
-    {
-        return FAT32_ERR_INVALID_CHAR;
-    }
-
-    uint32_t size = strlen(path) + 1;
-    char *parent_dir_path = fat32_alloc(size);
-    if (parent_dir_path == NULL)
-    {
-        return FAT32_ERR_ALLOC_FAILED;
-    }
-
-    // Извлечение пути родительской директории
-    status = get_dir_path(path, parent_dir_path, size);
-    if (status != 0)
-    {
-        goto cleanup;
-    }
-
-    status = find_directory_fat32(path, &file_cluster);
-    if (status == 0)
+    if (file->delay_buffer != NULL)
     {
-        status = find_directory_fat32(parent_dir_path, &cluster_parent);
-        if (status != 0)
-        {
-            goto cleanup;
-        }
-        // загрузить данные в дескриптор
-        *file = init_file_handle(file_name, cluster_parent, mode);
-        if (file == NULL)
-        {
-            status = FAT32_ERR_OPEN_FAILED;
-        }
-        else
+        if (fat32_free(file->delay_buffer, file->delay_capacity) != 0)
         {
-            status = 0;
+            // вывод в лог
         }
-        goto cleanup;
-    }
-
-    status = find_directory_fat32(parent_dir_path, &cluster_parent);
-    if (status != 0)
-    {
-        status = FAT32_ERR_INVALID_PATH;
-        goto cleanup;
+        file->delay_buffer = NULL;
+        file->delay_capacity = 0;
     }
-
-    status = create_file_fat32(cluster_parent, &file_cluster, file_name);
-    if (status != 0)
+    if (buffer_size == 0)
     {
-        status = FAT32_ERR_CREATE_FAILED;
-        goto cleanup;
+        return 0;
     }
 
-    *file = init_file_handle(file_name, cluster_parent, mode);
-    if (*file != NULL)
+    file->delay_buffer = fat32_alloc(buffer_size);
+    if (file->delay_buffer == NULL)
     {
-        status = 0;
-    }
-    else
-    {
-        status = FAT32_ERR_OPEN_FAILED;
-    }
-cleanup:
-    if (fat32_free(parent_dir_path, size) != 0)
-    {
-        // Вывод в лог
+        return FAT32_ERR_ALLOC_FAILED;
     }
-    return status;
+    file->delay_capacity = buffer_size;
+    return 0;
 }
 
-int mkdir_fat32(char *path)
+int fat32_truncate(FAT32_File *file, uint32_t new_size)
 {
-    if (path == NULL)
+    if (file == NULL)
+    {
         return FAT32_ERR_INVALID_ARGUMENT;
-
+    }
     if (fat_info == NULL)
     {
         return FAT32_ERR_FS_NOT_LOADED;
     }
+    if (file->flags == F_READ)
+    {
+        return FAT32_ERR_INVALID_FILE_MODE;
+    }
 
-    // Проверка корректности формата пути
-    uint32_t cluster_dir = 0;
-    int status = validate_path(path);
+    int status = drain_delay_buffer(file);
     if (status != 0)
     {
-        return FAT32_ERR_INVALID_PATH;
+        return status;
+    }
+    if (new_size > file->size_bytes)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
 
-    // Получаем имя новой директории
-    char file_name[MAX_NAME_SIZE];
-    memset(file_name, '0', MAX_NAME_SIZE);
-    status = get_last_path_component(path, file_name);
+    // Позиция в новом размере сохраняется, иначе переносится в конец файла
+    FilePos saved = file->position;
+    uint32_t offset = tell_fat32(file);
+
+    // Позиция new_size указывает на последний остающийся кластер
+    status = seek_file_fat32(file, (int32_t)new_size, F_SEEK_SET);
     if (status != 0)
     {
-        return FAT32_ERR_INVALID_PATH;
+        return status;
     }
-    FAT32_LOG_INFO("name new dir: %s\r\n", file_name);
-    // Проверка имени директории
-    status = validate_fat_lfn_dir(file_name);
+    uint32_t last_cluster = file->position.cluster_number;
+    uint32_t next_cluster = last_cluster;
+    status = file_next_cluster(file, &next_cluster);
     if (status != 0)
     {
-        return FAT32_ERR_INVALID_CHAR;
+        return FAT32_ERR_READ_FAIL;
     }
 
-    uint32_t size = strlen(path) + 1;
-    char *dir_path = fat32_alloc(size);
-    if (dir_path == NULL)
+    // Сначала в запись каталога пишется новый размер: при сбое после этого цепочка
+    // лишь длиннее нужного, а размер никогда не указывает за её конец
+    uint32_t old_size = file->size_bytes;
+    file->size_bytes = new_size;
+    status = flush_fat32(file);
+    if (status != 0)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        file->size_bytes = old_size;
+        file->position = saved;
+        return status;
     }
-
-    // Получаем путь к родительской директории
-    status = get_dir_path(path, dir_path, size);
-    if (status != 0)
+    if (offset <= new_size && saved.cluster_idx <= file->position.cluster_idx)
     {
-        status = FAT32_ERR_INVALID_PATH;
-        goto cleanup;
+        file->position = saved;
     }
 
-    if (path_exists_fat32(path) == 0)
+    if (next_cluster != FILE_END_TABLE_FAT32)
     {
-        status = 0;
-        goto cleanup;
+        if (update_fat32(last_cluster, FILE_END_TABLE_FAT32) != 0)
+        {
+            return FAT32_ERR_UPDATE_FAILED;
+        }
+        status = queue_chain_release(next_cluster);
+        if (status != 0)
+        {
+            return status;
+        }
     }
 
-    status = find_directory_fat32(dir_path, &cluster_dir);
-    if (status != 0)
+    // Известные участки обрезаются по последнему кластеру; если его в них нет,
+    // положение участков относительно разреза неизвестно и они отбрасываются
+    Fat32ClusterAlloc *extents = &file->extents;
+    uint32_t run = 0;
+    while (run < extents->run_count &&
+           (last_cluster < extents->runs[run].first || last_cluster >= extents->runs[run].first + extents->runs[run].count))
     {
-        status = FAT32_ERR_DIR_NOT_FOUND;
-        goto cleanup;
+        ++run;
     }
-    status = create_dir_fat32(file_name, strlen(file_name), cluster_dir);
-    if (status != 0)
+    if (run < extents->run_count)
     {
-        status = FAT32_ERR_CREATE_FAILED;
+        extents->runs[run].count = last_cluster - extents->runs[run].first + 1;
+        extents->run_count = run + 1;
+        extents->total = 0;
+        for (run = 0; run < extents->run_count; ++run)
+        {
+            extents->total += extents->runs[run].count;
+        }
     }
-cleanup:
-    if (fat32_free(dir_path, size) != 0)
+    else
     {
-        // Вывод в лог
+        extents->run_count = 0;
+        extents->total = 0;
     }
-    return status;
-}
-
-/**
- * Разделяет 32-битный номер кластера на две 16-битные части: старшую и младшую.
- *
- * Это необходимо при работе с файловой системой FAT32, где номер кластера
- * хранится в двух полях: DIR_FstClusHI (старшие 16 бит) и DIR_FstClusLO (младшие 16 бит).
- *
- * @param cluster  Полный 32-битный номер кластера.
- * @param[out] high Указатель на переменную, куда будет записана старшая 16-битная часть.
- * @param[out] low  Указатель на переменную, куда будет записана младшая 16-битная часть.
- */
-void split_cluster_number(uint32_t cluster, uint16_t *high, uint16_t *low)
-{
-    if (low == NULL || high == NULL)
-        return;
-    *low = cluster & 0xFFFF;
-    *high = (cluster >> 16) & 0xFFFF;
-}
-
-/**
- * Объединяет два 16-битных значения (старшую и младшую части) в одно 32-битное значение кластера.
- *
- * Эта функция используется в FAT32 для объединения двух полей из записи директории:
- * - DIR_FstClusHI (старшие 16 бит номера кластера)
- * - DIR_FstClusLO (младшие 16 бит номера кластера)
- *
- * @param cluster Указатель на переменную, в которую будет записан полный номер кластера.
- * @param high    Старшие 16 бит номера кластера.
- * @param low     Младшие 16 бит номера кластера.
- */
-void join_cluster_number(uint32_t *cluster, uint16_t high, uint16_t low)
-{
-    if (cluster == NULL)
-        return;
-    *cluster = ((uint32_t)high << 16) | ((uint32_t)low << 0);
+    return 0;
 }
 
 /**
- * Поиск свободного кластера в FAT-таблице.
+ * Собирает группу записей каталога (LFN-записи + SFN-запись) для имени.
  *
- * Эта функция сканирует FAT-таблицу, читая её сектора по одному, и ищет первый свободный кластер,
- * помеченный как FREE_CLUSTER.
+ * Поля SFN-записи, кроме имени, берутся из sfn_entry. Если имя допустимо как короткое,
+ * группа состоит из одной SFN-записи; иначе для каталога dir_cluster подбирается
+ * псевдоним "~N" и перед ним добавляются LFN-записи.
  *
- * @param[out] free_cluster Указатель на переменную, в которую будет записан номер найденного свободного кластера.
- *                          В случае ошибки или если свободный кластер не найден, значение будет FILE_END_TABLE_FAT32.
- *
- * @return 0 при успешном поиске,
- *         FAT32_ERR_INVALID_ARGUMENT, если передан NULL-указатель,
- *         FAT32_ERR_FS_NOT_LOADED, если файловая система не инициализирована,
- *         FAT32_ERR_ALLOC_FAILED, если не удалось выделить буфер,
- *         FAT32_ERR_READ_FAIL, если не удалось прочитать сектор FAT,
- *         либо ненулевое значение в случае других ошибок.
+ * @param dir_cluster Каталог, в который будет записана группа.
+ * @param name        Имя, завершённое нулём.
+ * @param length      Длина имени в байтах.
+ * @param is_dir      Имя каталога (другие правила коротких имён).
+ * @param sfn_entry   Образец SFN-записи.
+ * @param entries     [out] Группа записей; освобождается fat32_free(sizeof(LDIR_Type) * entry_count).
+ * @param entry_count [out] Количество записей группы.
+ * @return 0 при успехе, FAT32_ERR_INVALID_CHAR, FAT32_ERR_ALLOC_FAILED или код ошибки подбора псевдонима.
  */
-int find_free_cluster(uint32_t *free_cluster)
+static int build_entry_group(uint32_t dir_cluster, const char *name, uint32_t length, int is_dir,
+                             const FatDir_Type *sfn_entry, FatDir_Type **entries, int *entry_count)
 {
-    int status = 0;
-    if (free_cluster == NULL)
+    int status = is_dir ? validate_fat_sfn_dir(name) : validate_fat_sfn_file(name);
+    int count = 1;
+    if (status != 0)
     {
-        return FAT32_ERR_INVALID_ARGUMENT;
+        // Количество LFN-записей определяется длиной имени в UTF-16, а не в байтах
+        count = fat32_utf8_to_utf16le(name, length, NULL, MAX_NAME_SIZE);
+        if (count <= 0)
+        {
+            return FAT32_ERR_INVALID_CHAR;
+        }
+        count = ((count + MAX_SYMBOLS_ENTRY - 1) / MAX_SYMBOLS_ENTRY) + 1;
     }
 
-    *free_cluster = FILE_END_TABLE_FAT32;
-
-    if (fat_info == NULL)
-        return FAT32_ERR_FS_NOT_LOADED;
-
-    uint32_t *buffer = fat32_alloc(fat_info->bytesPerSec);
-    if (buffer == NULL)
+    FatDir_Type *group = fat32_alloc(sizeof(LDIR_Type) * count);
+    if (group == NULL)
     {
         return FAT32_ERR_ALLOC_FAILED;
     }
+    FatDir_Type *entry = &group[count - 1];
+    stm_memcpy((uint8_t *)entry, (const uint8_t *)sfn_entry, sizeof(FatDir_Type));
 
-    int sector = 0, idx = 0;
-
-    do
+    if (count > 1)
     {
-        status = fat_info->device->read((uint8_t *)buffer, 1, fat_info->address_tabl1 + sector, fat_info->bytesPerSec);
-        if (status < 0)
-        {
-            return FAT32_ERR_READ_FAIL;
-        }
-        for (idx = 0; idx < fat_info->bytesPerSec; ++idx)
+        status = generate_sfn_alias(dir_cluster, name, length, entry->DIR_Name);
+        if (status != 0)
         {
-            if (buffer[idx] == FREE_CLUSTER)
+            if (fat32_free(group, sizeof(LDIR_Type) * count) != 0)
             {
-                *free_cluster = sector * fat_info->fat_ents_sec + idx;
-                status = 0;
-                goto cleanup;
+                // вывод в лог
             }
+            return status;
         }
-    } while (++sector < fat_info->sizeFAT);
-
-cleanup:
-    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+        uint8_t chksum = fat32_sfn_checksum(entry->DIR_Name);
+        make_lfn_entries(name, length, chksum, (LDIR_Type *)group, count - 1);
+    }
+    else
     {
-        // вывод в лог
+        fat32_format_sfn(name, length, (char *)entry->DIR_Name);
     }
-    return status;
+    *entries = group;
+    *entry_count = count;
+    return 0;
 }
 
 /**
- * Обновляет запись в таблице FAT32 для указанного кластера в обеих копиях FAT.
- *
- * Функция сначала изменяет FAT1, затем FAT2. Если обновление второй копии (FAT2) не удалось,
- * FAT1 останется обновлённой, что приведёт к частичной неконсистентности.
- * В случае ошибки пользователь обязан сам обработать откат снаружи.
+ * Создаёт новый файл в указанной директории FAT32.
  *
- * @param cluster Номер кластера для обновления.
- * @param value Значение, которое будет записано (например, номер следующего кластера или EOF).
+ * @param cluster_directory  Кластер директории, в которой создаётся файл.
+ * @param cluster_file       Указатель, в который будет записан номер первого кластера файла.
+ * @param file_name          Имя файла (может быть в формате SFN или LFN).
+ * @param ref                [out] Положение и содержимое созданной записи (может быть NULL).
  *
- * @return 0 — успех,
- *         FAT32_ERR_INVALID_ARGUMENT — некорректный указатель fat_info,
- *         FAT32_ERR_ALLOC_FAILED — не удалось выделить память из пула,
- *         FAT32_ERR_UPDATE_FAILED — ошибка при работе с FAT1,
- *         FAT32_ERR_UPDATE_PARTIAL_FAIL — FAT1 обновлена, FAT2 — нет (требуется откат на стороне вызывающего кода).
+ * @return 0 при успехе или отрицательное значение — при ошибке.
  */
-int update_fat32(uint32_t cluster, uint32_t value)
+int create_file_fat32(uint32_t cluster_directory, uint32_t *cluster_file, char *file_name, DirEntryRef *ref)
 {
-    if (fat_info == NULL)
-        return FAT32_ERR_INVALID_ARGUMENT;
-
-    uint32_t sector = ((uint32_t)cluster / fat_info->fat_ents_sec);
-    uint32_t *buffer = fat32_alloc(fat_info->bytesPerSec);
     int status = 0;
+    uint16_t length = strlen(file_name);
 
-    if (buffer == NULL)
+    if (cluster_file == NULL)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
 
-    status = fat_info->device->read((uint8_t *)buffer, 1, fat_info->address_tabl1 + sector, fat_info->bytesPerSec);
-    if (status < 0)
+    // Ориентир для политики выделения — каталог файла
+    *cluster_file = cluster_directory;
+
+    int entry_count = 0;
+    FatDir_Type *entries = NULL;
+
+    // выделяем память(кластер) в таблице для нового файла
+    status = allocate_cluster_fat32(cluster_file);
+    if (status != 0)
     {
-        status = FAT32_ERR_UPDATE_FAILED;
-        goto update_failed;
+        return FAT32_ERR_CLUSTER_ALLOC_FAIL;
     }
-    uint32_t idx_entry = (uint32_t)(cluster % fat_info->fat_ents_sec);
 
-    buffer[idx_entry] = value;
-    status = fat_info->device->write((uint8_t *)buffer, 1, fat_info->address_tabl1 + sector, fat_info->bytesPerSec);
-    if (status < 0)
+    FatDir_Type sfn_entry;
+    memset((uint8_t *)&sfn_entry, 0, sizeof(FatDir_Type));
+    sfn_entry.DIR_Attr = ATTR_ARCHIVE;
+    split_cluster_number(*cluster_file, &sfn_entry.DIR_FstClusHI, &sfn_entry.DIR_FstClusLO);
+    status = build_entry_group(cluster_directory, file_name, length, 0, &sfn_entry, &entries, &entry_count);
+    if (status != 0)
     {
-        status = FAT32_ERR_UPDATE_FAILED;
-        goto update_failed;
+        return status;
     }
 
-    status = fat_info->device->read((uint8_t *)buffer, 1, fat_info->address_tabl2 + sector, fat_info->bytesPerSec);
-    if (status < 0)
-    {
-        fat32_free(buffer, fat_info->bytesPerSec);
-        return FAT32_ERR_UPDATE_PARTIAL_FAIL;
+    // Найти позицию в директории с нужным количеством свободных записей
+    DirEntryPosition position;
+    status = find_free_dir_entries(cluster_directory, entry_count, &position);
+    if (status != 0)
+    {
+        status = FAT32_ERR_NO_FREE_ENTRIES;
+        goto cleanup;
     }
-
-    buffer[idx_entry] = value;
-    status = fat_info->device->write((uint8_t *)buffer, 1, fat_info->address_tabl2 + sector, fat_info->bytesPerSec);
-    if (status < 0)
+    // Записать в корневую директорию
+    status = write_dir_entries_at(&position, entries, entry_count);
+    if (status != 0)
     {
-        fat32_free(buffer, fat_info->bytesPerSec);
-        return FAT32_ERR_UPDATE_PARTIAL_FAIL;
+        // Место уже списано из кэша свободных записей, но записи не легли на носитель
+        fat32_dir_cache_invalidate(cluster_directory);
+        status = FAT32_ERR_WRITE_FAIL;
+        goto cleanup;
     }
+    fat32_dir_cache_add(cluster_directory, fat32_name_hash(file_name, length), &position, entry_count);
 
-update_failed:
-    if (status == 0)
+    if (ref != NULL)
     {
+        ref->parent_cluster = cluster_directory;
+        ref->lfn_position = position;
+        ref->position = position;
+        ref->entry_count = entry_count;
+        stm_memcpy((uint8_t *)&ref->entry, (uint8_t *)&entries[entry_count - 1], sizeof(FatDir_Type));
+        status = dir_position_advance(&ref->position, entry_count - 1);
     }
-    status = fat32_free((uint8_t *)buffer, fat_info->bytesPerSec);
-    if (status != 0)
+
+cleanup:
+    if (fat32_free(entries, sizeof(LDIR_Type) * entry_count) != 0)
     {
         // вывод в лог
     }
-
     return status;
 }
 
 /**
- * Получает следующий кластер в цепочке FAT32.
+ * @brief Открывает (или создаёт) файл по пути относительно каталога base_cluster.
  *
- * @param prev_cluster [in, out] - указатель на текущий кластер; при успешном завершении
- *                                будет обновлен на следующий кластер.
- * @return 0 при успехе,
- *         FAT32_ERR_INVALID_ARGUMENT если fat_info не инициализирован,
- *         FAT32_ERR_ALLOC_FAILED при ошибке выделения памяти.
+ * Путь должен быть предварительно проверен вызывающей функцией.
  */
-int get_next_cluster_fat32(uint32_t *prev_cluster)
+static int open_file_in_dir(uint32_t base_cluster, const char *path, FAT32_File **file, uint8_t mode)
 {
-    if (fat_info == NULL)
+    uint32_t file_cluster;
+    const char *name = NULL;
+    uint32_t name_length = 0;
+    DirEntryRef ref;
+
+    // Один проход по пути: родительский каталог и последний компонент
+    int status = resolve_parent_fat32(base_cluster, path, &ref.parent_cluster, &name, &name_length);
+    if (status != 0 || name_length >= MAX_NAME_SIZE)
     {
-        return FAT32_ERR_INVALID_ARGUMENT;
+        return FAT32_ERR_INVALID_PATH;
     }
-    int status = 0;
-    uint32_t address = fat_info->address_tabl1 + *prev_cluster / fat_info->fat_ents_sec;
-    uint32_t *buffer = fat32_alloc(fat_info->bytesPerSec);
-    if (buffer == NULL)
+
+    char file_name[MAX_NAME_SIZE];
+    memcpy(file_name, name, name_length);
+    file_name[name_length] = '\0';
+
+    // Проверка имени файла на валидность по LFN
+    status = validate_fat_lfn_file(file_name);
+    if (status != 0)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        return FAT32_ERR_INVALID_CHAR;
     }
-    status = fat_info->device->read((uint8_t *)buffer, 1, address, fat_info->bytesPerSec);
-    if (status < 0)
+
+    status = find_dir_entry(file_name, name_length, ref.parent_cluster, &ref);
+    if (status == FAT32_ERR_ENTRY_NOT_FOUND)
     {
-        status = FAT32_ERR_READ_FAIL;
-        goto cleanup;
+        status = create_file_fat32(ref.parent_cluster, &file_cluster, file_name, &ref);
+        if (status != 0)
+        {
+            return FAT32_ERR_CREATE_FAILED;
+        }
+    }
+    else if (status != 0)
+    {
+        return FAT32_ERR_INVALID_PATH;
     }
-    uint32_t idx_entry = (uint32_t)(*prev_cluster % fat_info->fat_ents_sec);
-    *prev_cluster = buffer[idx_entry];
 
-cleanup:
-    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    // загрузить данные в дескриптор
+    *file = init_file_handle(&ref, mode);
+    if (*file == NULL)
     {
-        // вывод в Лог
+        return FAT32_ERR_OPEN_FAILED;
     }
-    return status;
+    return 0;
 }
 
-/**
- * Выделяет свободный кластер и помечает его концом цепочки (EOF) в таблице FAT.
- *
- * @param new_cluster Указатель, по которому будет записан номер выделенного кластера.
- * @return 0 при успехе,
- *         FAT32_ERR_INVALID_ARGUMENT — если аргумент NULL,
- *         FAT32_ERR_DISK_FULL — если свободный кластер не найден,
- *         FAT32_ERR_UPDATE_FAILED — если не удалось записать в обе FAT-таблицы,
- *         FAT32_ERR_UPDATE_PARTIAL_FAIL — если запись прошла только в одну таблицу, но откат удался,
- *         FAT32_ERR_RECOVERY_FAILED — если не удалось выполнить откат после частичной записи.
- */
-int allocate_cluster_fat32(uint32_t *new_cluster)
+int open_file_fat32(char *path, FAT32_File **file, uint8_t mode)
 {
-    int status = 0;
-    if (new_cluster == NULL)
+    if (path == NULL || file == NULL)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
 
-    // Поиск первого свободного кластера
-    status = find_free_cluster(new_cluster);
-    if (status != 0)
-    {
-        return status;
-    }
-    else if (*new_cluster == FILE_END_TABLE_FAT32)
+    if (fat_info == NULL)
     {
-        return FAT32_ERR_DISK_FULL;
+        return FAT32_ERR_FS_NOT_LOADED;
     }
 
-    // Обновляем информацию в таблицах FAT
-    status = update_fat32(*new_cluster, FILE_END_TABLE_FAT32);
-    if (status == FAT32_ERR_UPDATE_PARTIAL_FAIL)
+    // Проверка валидности пути
+    if (validate_path(path) != 0)
     {
-        status = update_fat32(*new_cluster, NOT_USED_CLUSTER_FAT32);
-        if (status == FAT32_ERR_UPDATE_FAILED)
-        {
-            return FAT32_ERR_UPDATE_PARTIAL_FAIL;
-        }
-        else
-        {
-            status = FAT32_ERR_UPDATE_FAILED;
-        }
+        return FAT32_ERR_INVALID_PATH;
     }
-    return (status == 0 ? 0 : FAT32_ERR_UPDATE_FAILED);
+    return open_file_in_dir(fat_info->root_cluster, path, file, mode);
 }
 
-/**
- * Проверяет, существует ли следующий кластер в цепочке,
- * и при необходимости выделяет новый кластер, расширяя цепочку.
- *
- * @param last_cluster Указатель на текущий (последний) кластер в цепочке.
- *                     При успешном расширении обновляется на следующий кластер.
- *
- * @return 0 при успехе (либо если кластер уже продолжен, либо если выделен новый),
- *         FAT32_ERR_INVALID_ARGUMENT — если аргумент некорректен,
- *         FAT32_ERR_DISK_FULL — если не удалось найти свободный кластер,
- *         FAT32_ERR_UPDATE_FAILED — ошибка обновления FAT,
- *         FAT32_ERR_UPDATE_PARTIAL_FAIL — если FAT обновлена частично,
- *         FAT32_ERR_RECOVERY_FAILED — если откат не удался.
- */
-int extend_cluster_chain_if_needed(uint32_t *last_cluster)
+int open_file_at_fat32(FAT32_Dir *dir, const char *name, FAT32_File **file, uint8_t mode)
 {
-    uint32_t cluster_next = *last_cluster;
-    if (last_cluster == NULL)
+    if (dir == NULL || name == NULL || file == NULL)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
 
-    // Ищем следующий кластер в цепочке
-    int status = get_next_cluster_fat32(&cluster_next);
-    if (status == 0 && cluster_next != FILE_END_TABLE_FAT32)
+    if (fat_info == NULL)
     {
-        *last_cluster = cluster_next;
-        return 0;
+        return FAT32_ERR_FS_NOT_LOADED;
     }
 
-    // Если кластер не найден, добавляем новый кластер
-    cluster_next = *last_cluster;
-    status = allocate_cluster_fat32(&cluster_next);
-    if (status == 0)
+    if (validate_relative_path(name) != 0)
     {
-        *last_cluster = cluster_next;
-        return 0;
+        return FAT32_ERR_INVALID_PATH;
     }
-    return status;
+    return open_file_in_dir(dir->first_cluster, name, file, mode);
 }
 
 /**
- * Проверяет, является ли запись в каталоге FAT32 свободной.
- *
- * @param entry Указатель на структуру записи каталога FAT32 (FatDir_Type).
- * @return 0 — если запись свободна,
- *         1 — если запись занята,
- *        FAT32_ERR_INVALID_ARGUMENT — если передан NULL-указатель.
+ * @brief Создаёт каталог по пути относительно каталога base_cluster.
  *
- * Свободные записи определяются по первому байту имени:
- *   - 0x00 (ENTRY_FREE_FAT32) — запись никогда не использовалась.
- *   - 0xE5 (ENTRY_FREE_FULL_FAT32) — запись удалена.
+ * Путь должен быть предварительно проверен вызывающей функцией.
+ * Если каталог уже существует, возвращается 0.
  */
-int is_free_entry_fat32(FatDir_Type *entry)
+static int mkdir_in_dir(uint32_t base_cluster, const char *path)
 {
-    if (entry == NULL)
-        return FAT32_ERR_INVALID_ARGUMENT;
+    uint32_t cluster_dir = 0;
+    const char *name = NULL;
+    uint32_t length = 0;
 
-    if (entry->DIR_Name[0] == ENTRY_FREE_FAT32 || entry->DIR_Name[0] == ENTRY_FREE_FULL_FAT32)
+    // Поиск родительской директории по префиксу пути
+    int status = resolve_parent_fat32(base_cluster, path, &cluster_dir, &name, &length);
+    if (status == FAT32_ERR_INVALID_PATH)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+    if (status != 0)
+    {
+        return FAT32_ERR_DIR_NOT_FOUND;
+    }
+    if (length >= MAX_NAME_SIZE)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+
+    // Получаем имя новой директории
+    char file_name[MAX_NAME_SIZE];
+    memcpy(file_name, name, length);
+    file_name[length] = '\0';
+    FAT32_LOG_INFO("name new dir: %s\r\n", file_name);
+
+    // Проверка имени директории
+    status = validate_fat_lfn_dir(file_name);
+    if (status != 0)
+    {
+        return FAT32_ERR_INVALID_CHAR;
+    }
+
+    uint32_t cluster_exists = 0;
+    if (find_entry_cluster_fat32(file_name, length, cluster_dir, &cluster_exists) == 0)
     {
         return 0;
     }
-    return 1;
-}
 
-int path_exists_fat32(char *path)
-{
-    uint32_t cluster = 0;
-    if (path == NULL)
+    status = create_dir_fat32(file_name, length, cluster_dir);
+    if (status != 0)
     {
-        return FAT32_ERR_INVALID_ARGUMENT;
+        status = FAT32_ERR_CREATE_FAILED;
     }
-    return (find_directory_fat32(path, &cluster) == 0 ? 0 : 1);
+    return status;
 }
 
-/**
- * @brief Заполняет поля имени в LFN-структуре (Long File Name) символами UTF-16.
- *
- * FAT LFN-записи хранят до 13 символов UTF-16:
- *
- * Эта функция копирует заданные символы в соответствующие поля структуры.
- * Если длина меньше 13, оставшиеся позиции заполняются 0xFFFF (указание на конец строки).
- *
- * @param entry        Указатель на структуру LDIR_Type, которую нужно заполнить.
- * @param utf16_chunk  Указатель на массив UTF-16 символов (не более 13).
- * @param length       Количество символов в utf16_chunk (от 0 до 13).
- */
-void fill_lfn_name_fields(LDIR_Type *entry, const uint16_t *utf16_chunk, uint8_t length)
+int mkdir_fat32(char *path)
 {
-    int idx = 0;
-    uint16_t *lfn_fields[MAX_SYMBOLS_ENTRY] = {0};
+    if (path == NULL)
+        return FAT32_ERR_INVALID_ARGUMENT;
 
-    for (idx = 0; idx < 5; ++idx)
-        lfn_fields[idx] = (uint16_t *)&entry->LDIR_Name1[idx * 2];
-    for (idx = 0; idx < 6; ++idx)
-        lfn_fields[idx + 5] = (uint16_t *)&entry->LDIR_Name2[idx * 2];
-    for (idx = 0; idx < 2; ++idx)
-        lfn_fields[idx + 11] = (uint16_t *)&entry->LDIR_Name3[idx * 2];
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
 
-    for (idx = 0; idx < MAX_SYMBOLS_ENTRY; ++idx)
+    // Проверка корректности формата пути
+    if (validate_path(path) != 0)
     {
-        if (idx < length)
-        {
-            *lfn_fields[idx] = utf16_chunk[idx];
-        }
-        else
-        {
-            *lfn_fields[idx] = 0xFFFF;
-        }
+        return FAT32_ERR_INVALID_PATH;
     }
+    return mkdir_in_dir(fat_info->root_cluster, path);
 }
 
-/**
- * @brief Создаёт LFN-записи (Long File Name) для длинного имени файла.
- *
- * FAT LFN хранит длинные имена в нескольких 13-символьных записях,
- * каждая из которых является структурой LDIR_Type.
- *
- * @param name          Исходное имя файла в ASCII.
- * @param length        Длина имени файла (в байтах).
- * @param chkSum        Контрольная сумма короткого имени (SFN), используемая в LFN-записях.
- * @param entries       Указатель на массив LDIR_Type для записи LFN-записей.
- * @param numb_entries  Количество LFN-записей (обычно вычисляется как ceil(length/13)).
- *
- * @return 0 при успехе, код ошибки при неудаче.
- */
-int make_lfn_entries(const char *name, uint32_t length, uint8_t chkSum, LDIR_Type *entries, uint16_t numb_entries)
+int mkdir_at_fat32(FAT32_Dir *dir, const char *name)
 {
-    if (entries == NULL || name == NULL)
+    if (dir == NULL || name == NULL)
         return FAT32_ERR_INVALID_ARGUMENT;
 
-    int idx = 0;
-    uint32_t size_buffer = length + 1;
-    uint16_t *name_utf16le = fat32_alloc(size_buffer * sizeof(uint16_t));
-    if (name_utf16le == NULL)
+    if (fat_info == NULL)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        return FAT32_ERR_FS_NOT_LOADED;
     }
 
-    LDIR_Type *entry = NULL;
-
-    fat32_ascii_to_utf16le(name, (uint8_t *)name_utf16le);
-
-    for (idx = 0; idx < numb_entries; ++idx)
+    if (validate_relative_path(name) != 0)
     {
-        entry = &entries[numb_entries - idx - 1];
-        entry->LDIR_Attr = ATTR_LONG_NAME;
-        entry->LDIR_FstClusLO = 0;
-        entry->LDIR_Type = 0;
-        entry->LDIR_Chksum = chkSum;
-        entry->LDIR_Ord = idx + 1;
-        fill_lfn_name_fields(entry, name_utf16le + (idx * LFN_NAME_LENGTH), size_buffer - (idx * LFN_NAME_LENGTH));
+        return FAT32_ERR_INVALID_PATH;
     }
+    return mkdir_in_dir(dir->first_cluster, name);
+}
 
-    // Помечаем первую (последнюю в физическом порядке) LFN-запись как последнюю (бит 0x40 в LDIR_Ord)
-    entries[0].LDIR_Ord |= LFN_ENTRY_LAST;
-
-    if (fat32_free(name_utf16le, size_buffer * sizeof(uint16_t)))
-    {
-        // вывод в лог
-    }
-    return 0;
-}
-
-/**
- * @brief Ищет свободную последовательность записей в каталоге для размещения файла или LFN-записей.
- *
- * Функция сканирует кластер(ы) каталога, чтобы найти подряд идущие `entry_count` свободных записей (32-байтных),
- * необходимых для размещения длинного имени файла (LFN) + основной SFN-записи.
- * Если свободных записей нет — цепочка кластеров расширяется.
- *
- * @param parent_cluster Кластер родительского каталога.
- * @param entry_count    Количество необходимых подряд идущих записей (обычно 1 + кол-во LFN записей).
- * @param position       Указатель на структуру, куда будет записано положение свободных записей.
- *
- * @return 0 при успехе, либо код ошибки (например, FAT32_ERR_DISK_FULL).
- */
-int find_free_dir_entries(uint32_t parent_cluster, const uint16_t entry_count, DirEntryPosition *position)
+int fat32_opendir(const char *path, FAT32_Dir **dir)
 {
-    if (position == NULL)
+    if (path == NULL || dir == NULL)
+    {
         return FAT32_ERR_INVALID_ARGUMENT;
+    }
     if (fat_info == NULL)
     {
         return FAT32_ERR_FS_NOT_LOADED;
     }
-
-    uint32_t address = 0;
-    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
-    if (buffer == NULL)
+    if (validate_path(path) != 0 || path[0] != '/')
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        return FAT32_ERR_INVALID_PATH;
     }
 
-    uint32_t free_sectors = 0;
-    int status = 1;
-    int sector, idx;
-    while (1)
+    uint32_t first_cluster = fat_info->root_cluster;
+    uint32_t parent_cluster = 0;
+    if (fat32_path_depth(path) > 0)
     {
-        free_sectors = 0;
-        address = (parent_cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
-        for (sector = 0; sector < fat_info->secPerClus; ++sector)
+        DirEntryRef ref;
+        int status = resolve_entry_fat32(fat_info->root_cluster, path, &ref);
+        if (status != 0)
         {
-            status = fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec);
-            if (status < 0)
-            {
-                status = FAT32_ERR_READ_FAIL;
-                goto cleanup;
-            }
-            for (idx = 0; idx < fat_info->bytesPerSec; idx += sizeof(LDIR_Type))
-            {
-                if (is_free_entry_fat32((FatDir_Type *)&buffer[idx]) == 0)
-                {
-                    if (++free_sectors == entry_count)
-                    {
-                        position->cluster = parent_cluster;
-                        uint16_t count_entries_sec = (fat_info->bytesPerSec / sizeof(LDIR_Type));
-                        uint16_t current_entry = sector * count_entries_sec + (idx / sizeof(LDIR_Type));
-                        position->sector = (current_entry - entry_count) / (count_entries_sec);
-                        position->offset = (current_entry + 1) - entry_count;
-                        status = 0;
-                        goto cleanup;
-                    }
-                }
-                else
-                {
-                    free_sectors = 0;
-                }
-            }
+            return FAT32_ERR_DIR_NOT_FOUND;
+        }
+        if ((ref.entry.DIR_Attr & ATTR_DIRECTORY) == 0)
+        {
+            return FAT32_ERR_NOT_A_DIRECTORY;
         }
-        free_sectors = 0;
-        status = extend_cluster_chain_if_needed(&parent_cluster);
+        join_cluster_number(&first_cluster, ref.entry.DIR_FstClusHI, ref.entry.DIR_FstClusLO);
+        parent_cluster = ref.parent_cluster;
+    }
+
+    FAT32_Dir *desc = fat32_alloc(sizeof(FAT32_Dir));
+    if (desc == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+    memset((uint8_t *)desc, 0, sizeof(FAT32_Dir));
+    desc->first_cluster = first_cluster;
+    desc->parent_cluster = parent_cluster;
+    *dir = desc;
+    return 0;
+}
+
+int fat32_closedir(FAT32_Dir **dir)
+{
+    if (dir == NULL || *dir == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+
+    int status = 0;
+    if ((*dir)->buffer != NULL && fat_info != NULL)
+    {
+        status = fat32_free((*dir)->buffer, fat_info->bytesPerSec);
         if (status != 0)
         {
-            // Если не осталось свободных кластеров, тогда очищаем запись для новый кластера
-            update_fat32(parent_cluster, FREE_CLUSTER);
-            status = FAT32_ERR_DISK_FULL;
-            goto cleanup;
+            // вывод в лог
         }
     }
-cleanup:
-    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    status = fat32_free(*dir, sizeof(FAT32_Dir));
+    if (status != 0)
     {
-        // Вывод в лог
+        // вывод в лог
     }
-    return status;
+    *dir = NULL;
+    return 0;
 }
 
 /**
- * @brief Записывает записи каталога (LFN + SFN) начиная с заданной позиции.
+ * Формирует имя вида "NAME.EXT" из поля DIR_Name короткой записи.
  *
- * @param position     Позиция в каталоге, куда нужно записывать.
- * @param entries      Указатель на массив записей (структуры LDIR_Type / FatDir_Type).
- * @param entry_count  Количество записей для записи.
+ * Учитываются флаги DIR_NTRes, задающие нижний регистр имени (0x08) и расширения (0x10).
+ */
+static void format_sfn_name(const FatDir_Type *entry, char *name)
+{
+    uint32_t length = 0;
+    uint32_t idx = 0;
+    uint8_t lower_base = entry->DIR_NTRes & 0x08;
+    uint8_t lower_ext = entry->DIR_NTRes & 0x10;
+
+    for (idx = 0; idx < 8 && entry->DIR_Name[idx] != ' '; ++idx)
+    {
+        char c = (char)entry->DIR_Name[idx];
+        // 0x05 в первом байте хранит символ 0xE5
+        if (idx == 0 && entry->DIR_Name[0] == 0x05)
+            c = (char)0xE5;
+        name[length++] = lower_base ? (char)tolower((unsigned char)c) : c;
+    }
+    if (entry->DIR_Name[8] != ' ')
+    {
+        name[length++] = '.';
+        for (idx = 8; idx < SHORT_NAME_SIZE && entry->DIR_Name[idx] != ' '; ++idx)
+        {
+            char c = (char)entry->DIR_Name[idx];
+            name[length++] = lower_ext ? (char)tolower((unsigned char)c) : c;
+        }
+    }
+    name[length] = '\0';
+}
+
+/**
+ * Преобразует собранное из LFN-записей имя UTF-16 в UTF-8.
  *
- * @return 0 при успехе, иначе код ошибки.
+ * @return 0 при успехе, -1 если имя в UTF-8 длиннее MAX_NAME_SIZE байт.
  */
-int write_dir_entries_at(const DirEntryPosition *position, const void *entries, uint16_t entry_count)
+static int decode_lfn_name(const uint16_t *buffer_name, char *name)
 {
-    if (position == NULL || entries == NULL)
+    return (fat32_utf16le_to_utf8(buffer_name, LFN_BUFFER_SIZE, name, MAX_NAME_SIZE + 1) < 0) ? -1 : 0;
+}
+
+/**
+ * Заполняет FAT32_DirInfo данными короткой записи (без имени).
+ */
+static void fill_dir_info(const FatDir_Type *entry, FAT32_DirInfo *info)
+{
+    info->attr = entry->DIR_Attr;
+    info->size = entry->DIR_FileSize;
+    join_cluster_number(&info->first_cluster, entry->DIR_FstClusHI, entry->DIR_FstClusLO);
+    fat32_date_from_fat(entry->DIR_CrtDate, &info->created.date);
+    fat32_time_from_fat(entry->DIR_CrtTime, &info->created.time);
+    fat32_date_from_fat(entry->DIR_WrtDate, &info->modified.date);
+    fat32_time_from_fat(entry->DIR_WrtTime, &info->modified.time);
+    fat32_date_from_fat(entry->DIR_LstAccDate, &info->accessed);
+}
+
+int fat32_readdir(FAT32_Dir *dir, FAT32_DirInfo *info)
+{
+    if (dir == NULL || info == NULL)
+    {
         return FAT32_ERR_INVALID_ARGUMENT;
+    }
     if (fat_info == NULL)
     {
         return FAT32_ERR_FS_NOT_LOADED;
     }
+    return read_dir_group(dir, info, NULL, NULL);
+}
 
-    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
-    if (buffer == NULL)
+/**
+ * Читает следующую запись каталога (реализация fat32_readdir).
+ *
+ * @param dir         Дескриптор каталога.
+ * @param info        [out] Сведения о записи.
+ * @param group       [out] Положение первой записи группы (может быть NULL).
+ * @param group_count [out] Количество записей группы (может быть NULL).
+ * @return 1 — запись получена, 0 — записи закончились, < 0 — ошибка.
+ */
+static int read_dir_group(FAT32_Dir *dir, FAT32_DirInfo *info, DirEntryPosition *group, uint16_t *group_count)
+{
+    if (dir->at_end)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        return 0;
     }
 
-    memset(buffer, 0, fat_info->bytesPerSec);
-    uint16_t entries_written = 0;
-    uint32_t address = (position->cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
-    int status = 0;
+    if (dir->buffer == NULL)
+    {
+        dir->buffer = fat32_alloc(fat_info->bytesPerSec);
+        if (dir->buffer == NULL)
+        {
+            return FAT32_ERR_ALLOC_FAILED;
+        }
+        dir->buffer_sector = 0;
+        if (dir->cursor.cluster == 0)
+        {
+            dir->cursor.cluster = dir->first_cluster;
+        }
+    }
 
-    uint16_t to_copy = 0;
-    int sector = position->sector;
+    uint32_t entries_per_sector = fat_info->bytesPerSec / sizeof(FatDir_Type);
+    uint16_t buffer_name[LFN_BUFFER_SIZE];
+    uint8_t lfn_next = 0;   // ожидаемый порядковый номер следующей LFN-записи
+    uint8_t lfn_active = 0; // собирается LFN-группа
+    uint8_t lfn_count = 0;
+    uint8_t check_sum = 0;
+    DirEntryPosition lfn_start = {0};
 
-    uint16_t count_entries_sector = fat_info->bytesPerSec / sizeof(LDIR_Type);
-    if (position->offset != 0)
+    while (1)
     {
-        if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+        if (dir->cursor.offset >= entries_per_sector)
         {
-            status = FAT32_ERR_READ_FAIL;
-            goto cleanup;
-        };
+            dir->cursor.offset = 0;
+            ++dir->cursor.sector;
+        }
+        if (dir->cursor.sector >= fat_info->secPerClus)
+        {
+            uint32_t next_cluster = dir->cursor.cluster;
+            if (get_next_cluster_fat32(&next_cluster) != 0)
+            {
+                return FAT32_ERR_READ_FAIL;
+            }
+            if (next_cluster == FILE_END_TABLE_FAT32)
+            {
+                dir->at_end = 1;
+                return 0;
+            }
+            dir->cursor.cluster = next_cluster;
+            dir->cursor.sector = 0;
+        }
+
+        // Сектор читается с носителя один раз, пока каталоги не изменялись; записи выбираются из буфера
+        uint32_t address = (dir->cursor.cluster - fat_info->root_cluster) * fat_info->secPerClus +
+                           fat_info->address_region + dir->cursor.sector;
+        if (dir->buffer_sector != address || dir->buffer_generation != dir_generation)
+        {
+            if (fat_info->device->read(dir->buffer, 1, address, fat_info->bytesPerSec) < 0)
+            {
+                dir->buffer_sector = 0;
+                return FAT32_ERR_READ_FAIL;
+            }
+            dir->buffer_sector = address;
+            dir->buffer_generation = dir_generation;
+        }
+
+        FatDir_Type *entry = (FatDir_Type *)&dir->buffer[dir->cursor.offset * sizeof(FatDir_Type)];
+        DirEntryPosition current = dir->cursor;
+        ++dir->cursor.offset;
 
-        if (entry_count > (count_entries_sector - position->offset))
+        if (entry->DIR_Name[0] == ENTRY_FREE_FULL_FAT32)
         {
-            to_copy = entry_count - (count_entries_sector - position->offset);
+            dir->at_end = 1;
+            return 0;
         }
-        else
+        if (entry->DIR_Name[0] == ENTRY_FREE_FAT32)
         {
-            to_copy = entry_count;
+            lfn_active = 0;
+            continue;
         }
 
-        stm_memcpy(buffer + position->offset * sizeof(LDIR_Type), (uint8_t *)entries, to_copy * sizeof(LDIR_Type));
-        if (fat_info->device->write(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+        if ((entry->DIR_Attr & ATTR_LONG_NAME_MASK) == ATTR_LONG_NAME)
         {
-            status = FAT32_ERR_WRITE_FAIL;
-            goto cleanup;
+            LDIR_Type *lfn_entry = (LDIR_Type *)entry;
+            if (lfn_entry->LDIR_Ord & LFN_ENTRY_LAST)
+            {
+                memset(buffer_name, 0x00, sizeof(buffer_name));
+                check_sum = lfn_entry->LDIR_Chksum;
+                copy_lfn_fragment(lfn_entry, buffer_name);
+                lfn_count = lfn_entry->LDIR_Ord & ~LFN_ENTRY_LAST;
+                lfn_next = lfn_count - 1;
+                lfn_active = 1;
+                lfn_start = current;
+            }
+            else if (lfn_active && lfn_next != 0 && lfn_entry->LDIR_Ord == lfn_next &&
+                     lfn_entry->LDIR_Chksum == check_sum)
+            {
+                copy_lfn_fragment(lfn_entry, buffer_name);
+                --lfn_next;
+            }
+            else
+            {
+                lfn_active = 0;
+            }
+            continue;
         }
-        ++sector;
-        entries_written += to_copy;
-    }
 
-    for (; sector < fat_info->secPerClus && entries_written < entry_count; ++sector)
-    {
-        if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+        if ((entry->DIR_Attr & ATTR_VOLUME_ID) || fat32_is_special_dir(entry->DIR_Name) == 0)
         {
-            status = FAT32_ERR_READ_FAIL;
-            goto cleanup;
-        };
-        to_copy = count_entries_sector;
-        if (entries_written + to_copy > entry_count)
+            lfn_active = 0;
+            continue;
+        }
+
+        uint16_t count = 1;
+        // Имя, не помещающееся в info->name в UTF-8, отдаётся коротким
+        if (lfn_active && lfn_next == 0 && fat32_sfn_checksum(entry->DIR_Name) == check_sum &&
+            decode_lfn_name(buffer_name, info->name) == 0)
         {
-            to_copy = entry_count - entries_written;
+            count = lfn_count + 1;
+            current = lfn_start;
         }
-        stm_memcpy(buffer, (const uint8_t *)(entries + entries_written), to_copy * sizeof(LDIR_Type));
-        if (fat_info->device->write(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+        else
         {
-            status = FAT32_ERR_WRITE_FAIL;
-            goto cleanup;
-        };
-        entries_written += to_copy;
-    }
-cleanup:
-    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
-    {
-        // Вывод в лог
+            format_sfn_name(entry, info->name);
+        }
+        fill_dir_info(entry, info);
+        if (group != NULL)
+            *group = current;
+        if (group_count != NULL)
+            *group_count = count;
+        return 1;
     }
-    return status;
 }
 
 /**
- * @brief Создаёт новую директорию в FAT32.
+ * Перемещает курсор дескриптора на начало каталога first_cluster.
  *
- * @param name            Имя директории (LFN или SFN).
- * @param length          Длина имени.
- * @param parent_cluster  Кластер родительской директории.
- * @return 0 при успехе, иначе код ошибки.
+ * Буфер сектора сохраняется, так как хранит абсолютный номер сектора.
  */
-int create_dir_fat32(char *name, uint32_t length, uint32_t parent_cluster)
+static void dir_handle_rewind(FAT32_Dir *dir, uint32_t first_cluster)
 {
-    int status = 0;
-    uint32_t cluster_new_dir = 0;
-
-    int entry_count = 0;
-    FatDir_Type *entries = NULL;
+    dir->first_cluster = first_cluster;
+    dir->cursor.cluster = first_cluster;
+    dir->cursor.sector = 0;
+    dir->cursor.offset = 0;
+    dir->at_end = 0;
+}
 
-    if (name == NULL)
+int fat32_telldir(const FAT32_Dir *dir, FAT32_DirPos *pos)
+{
+    if (dir == NULL || pos == NULL)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
+    pos->first_cluster = dir->first_cluster;
+    pos->cluster = (dir->cursor.cluster != 0) ? dir->cursor.cluster : dir->first_cluster;
+    pos->sector = dir->cursor.sector;
+    pos->offset = dir->cursor.offset;
+    pos->at_end = dir->at_end;
+    return 0;
+}
 
-    // выделяем память в таблице для новой директории
-    status = allocate_cluster_fat32(&cluster_new_dir);
-    if (status != 0)
+int fat32_seekdir(FAT32_Dir *dir, const FAT32_DirPos *pos)
+{
+    if (dir == NULL || pos == NULL)
     {
-        return FAT32_ERR_CLUSTER_ALLOC_FAIL;
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
-    FatDir_Type *entry = NULL;
-    if (validate_fat_sfn_dir(name) == 0)
+    if (fat_info == NULL)
     {
-        entry_count = ((length + MAX_SYMBOLS_ENTRY) / MAX_SYMBOLS_ENTRY) + 1;
-
-        entries = fat32_alloc(sizeof(LDIR_Type) * entry_count);
-        if (entries == NULL)
-        {
-            return FAT32_ERR_ALLOC_FAILED;
-        }
-        entry = &entries[entry_count - 1];
-        memset((uint8_t *)entry, 0, sizeof(FatDir_Type));
-
-        split_cluster_number(cluster_new_dir, &entry->DIR_FstClusHI, &entry->DIR_FstClusLO);
-        fat32_generate_sfn_from_lfn(name, length, entry->DIR_Name);
-        uint8_t chksum = fat32_sfn_checksum(entry->DIR_Name);
-        make_lfn_entries(name, length, chksum, (LDIR_Type *)entries, entry_count - 1);
+        return FAT32_ERR_FS_NOT_LOADED;
     }
-    else
-    {
-        entry_count = 1;
-        entries = fat32_alloc(sizeof(FatDir_Type));
-        if (entries == NULL)
-        {
-            return FAT32_ERR_ALLOC_FAILED;
-        }
-        // Ищем и добавляем запись в родительскую директорию
-        entry = &entries[0];
-        memset((uint8_t *)entry, 0, sizeof(FatDir_Type));
 
-        split_cluster_number(cluster_new_dir, &entry->DIR_FstClusHI, &entry->DIR_FstClusLO);
-        fat32_format_sfn(name, length, (char *)entry->DIR_Name);
+    // Позиция должна относиться к этому каталогу и не выходить за пределы тома
+    if (pos->first_cluster != dir->first_cluster ||
+        pos->cluster < fat_info->root_cluster || pos->cluster >= fat_info->cluster_count ||
+        pos->sector > fat_info->secPerClus ||
+        pos->offset > fat_info->bytesPerSec / sizeof(FatDir_Type))
+    {
+        return FAT32_ERR_INVALID_POSITION;
     }
 
-    Fat32_DateTime datetime = {0};
-
-    if (fat_info->device->datetime)
-        status = fat_info->device->datetime(&datetime);
+    dir->cursor.cluster = pos->cluster;
+    dir->cursor.sector = pos->sector;
+    dir->cursor.offset = pos->offset;
+    dir->at_end = pos->at_end;
+    return 0;
+}
 
-    entry->DIR_Attr = ATTR_DIRECTORY;
-    if (status == 0)
+int fat32_rewinddir(FAT32_Dir *dir)
+{
+    if (dir == NULL)
     {
-        fat32_date_to_fat(&datetime.date, &entry->DIR_CrtDate);
-        fat32_time_to_fat(&datetime.time, &entry->DIR_CrtTime);
-        entry->DIR_CrtTimeTenth = 0;
-        entry->DIR_WrtDate = entry->DIR_CrtDate;
-        entry->DIR_WrtTime = entry->DIR_CrtTime;
-        entry->DIR_LstAccDate = entry->DIR_CrtDate;
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
+    dir_handle_rewind(dir, dir->first_cluster);
+    return 0;
+}
 
-    // Поиск свободного места в директории
-    DirEntryPosition position;
-    status = find_free_dir_entries(parent_cluster, entry_count, &position);
-    if (status != 0)
+int fat32_compact_dir(FAT32_Dir *dir, uint32_t *released_clusters)
+{
+    if (dir == NULL)
     {
-        status = FAT32_ERR_NO_FREE_ENTRIES;
-        goto cleanup;
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
-    // Записать в корневую директорию
-    status = write_dir_entries_at(&position, entries, entry_count);
-    if (status != 0)
+    if (fat_info == NULL)
     {
-        status = FAT32_ERR_WRITE_FAIL;
-        goto cleanup;
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    if (released_clusters != NULL)
+    {
+        *released_clusters = 0;
     }
 
-    // Создаем entries для новой папки
-
-    FatDir_Type dir_entries[2];
-    memset((uint8_t *)dir_entries, 0, sizeof(FatDir_Type) * 2);
-
-    dir_entries[0].DIR_Attr = dir_entries[1].DIR_Attr = ATTR_DIRECTORY;
-    dir_entries[0].DIR_FileSize = dir_entries[1].DIR_FileSize = 0;
-
-    memset(dir_entries[0].DIR_Name, ' ', sizeof(dir_entries[0].DIR_Name));
-    memset(dir_entries[1].DIR_Name, ' ', sizeof(dir_entries[0].DIR_Name));
-    stm_memcpy(dir_entries[0].DIR_Name, (uint8_t *)"..", 2);
-    stm_memcpy(dir_entries[1].DIR_Name, (uint8_t *)".", 1);
-
-    split_cluster_number(position.cluster, &dir_entries[0].DIR_FstClusHI, &dir_entries[0].DIR_FstClusLO);
-    split_cluster_number(cluster_new_dir, &dir_entries[1].DIR_FstClusHI, &dir_entries[1].DIR_FstClusLO);
-
-    position.cluster = cluster_new_dir;
-    position.offset = 0;
-    position.sector = 0;
-
-    status = write_dir_entries_at(&position, dir_entries, 2);
-    if (status != 0)
-    {
-        status = FAT32_ERR_WRITE_FAIL;
-        goto cleanup;
-    }
-
-cleanup:
-    if (fat32_free(entries, sizeof(LDIR_Type) * entry_count) != 0)
-    {
-        // Вывод в лог
-    }
-
-    return status;
-}
-
-/**
- * @brief Удаляет цепочку кластеров, связанных с файлом или директорией в FAT32.
- *
- * Освобождает все кластеры, начиная с переданного `cluster_file`, путём последовательного
- * чтения следующего кластера через FAT и пометки текущего как свободного (FREE_CLUSTER).
- *
- * @param cluster_file Начальный кластер файла или директории, которую требуется удалить.
- * @return int Код ошибки или 0 при успешном завершении:
- *  - FAT32_ERR_FS_NOT_LOADED — если файловая система не инициализирована.
- *  - FAT32_ERR_INVALID_CLUSTER — если передан некорректный номер кластера.
- *  - FAT32_ERR_READ_FAIL — если не удалось прочитать следующий кластер.
- *  - FAT32_ERR_WRITE_FAIL — если не удалось обновить FAT.
- *  - FAT32_ERR_INVALID_CLUSTER_CHAIN — если цепочка повреждена (бесконечный цикл).
- */
-int delete_entry_fat32(uint32_t cluster_file)
-{
-    if (fat_info == NULL)
-    {
-        return FAT32_ERR_FS_NOT_LOADED;
-    }
-    if (cluster_file < 2 || cluster_file >= FILE_END_TABLE_FAT32)
-    {
-        return FAT32_ERR_INVALID_CLUSTER;
-    }
-    uint32_t next_cluster = cluster_file;
-    int status = 0;
-    while (cluster_file < FILE_END_TABLE_FAT32)
+    uint8_t *source = fat32_alloc(fat_info->bytesPerSec);
+    uint8_t *target = fat32_alloc(fat_info->bytesPerSec);
+    if (source == NULL || target == NULL)
     {
-        status = get_next_cluster_fat32(&next_cluster);
-        if (status != 0)
-        {
-            return FAT32_ERR_READ_FAIL;
-        }
-
-        status = update_fat32(cluster_file, FREE_CLUSTER);
-        if (status != 0)
+        if (source != NULL && fat32_free(source, fat_info->bytesPerSec) != 0)
         {
-            return FAT32_ERR_WRITE_FAIL;
+            // Вывод в лог
         }
-        if (cluster_file == next_cluster)
+        if (target != NULL && fat32_free(target, fat_info->bytesPerSec) != 0)
         {
-            return FAT32_ERR_INVALID_CLUSTER_CHAIN;
+            // Вывод в лог
         }
-
-        cluster_file = next_cluster;
-    };
-    return 0;
-}
-
-/**
- * @brief Рекурсивно удаляет директорию и всё её содержимое (файлы и поддиректории) в FAT32.
- *
- * @param cluster Кластер директории, которую необходимо удалить.
- * @return int 0 при успехе, либо отрицательный код ошибки:
- *  - FAT32_ERR_FS_NOT_LOADED — если файловая система не инициализирована.
- *  - FAT32_ERR_ALLOC_FAILED — ошибка при выделении буфера.
- *  - FAT32_ERR_READ_FAIL — ошибка чтения сектора.
- *  - FAT32_ERR_WRITE_FAIL — ошибка записи сектора.
- *  - FAT32_ERR_DELETE_PROTECTED — попытка удалить системный файл.
- */
-int delete_dir_recursive_fat32(uint32_t cluster)
-{
-    if (fat_info == NULL)
-    {
-        return FAT32_ERR_FS_NOT_LOADED;
-    }
-
-    FatDir_Type *entry_child;
-
-    uint32_t cluster_child;
-
-    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
-    if (buffer == NULL)
-    {
         return FAT32_ERR_ALLOC_FAILED;
     }
 
-    uint32_t sector = 0;
+    uint32_t entries_per_sector = fat_info->bytesPerSec / sizeof(FatDir_Type);
+    uint32_t src_cluster = dir->first_cluster;
+    uint32_t dst_cluster = dir->first_cluster;
+    uint32_t dst_prev = 0;
+    uint32_t dst_sector = 0;
+    uint32_t dst_offset = 0;
+    uint32_t skipped = 0;
     uint32_t address = 0;
-    uint32_t idx = 0;
+    uint32_t next_cluster = 0;
+    uint32_t sector, idx;
     int status = 0;
 
-    while (1)
+    // Записи переносятся только назад, поэтому сектор назначения никогда не опережает читаемый
+    while (src_cluster != FILE_END_TABLE_FAT32)
     {
-        address = fat_info->address_region + (cluster - fat_info->root_cluster) * fat_info->secPerClus;
-
+        address = (src_cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
         for (sector = 0; sector < fat_info->secPerClus; ++sector)
         {
-            if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+            if (fat_info->device->read(source, 1, address + sector, fat_info->bytesPerSec) < 0)
             {
                 status = FAT32_ERR_READ_FAIL;
                 goto cleanup;
             }
-            for (idx = 0; idx < fat_info->bytesPerSec; idx += sizeof(FatDir_Type *))
+            for (idx = 0; idx < entries_per_sector; ++idx)
             {
-                entry_child = (FatDir_Type *)&buffer[idx];
-                if (entry_child->DIR_Name[0] == ENTRY_FREE_FULL_FAT32)
+                uint8_t *entry = &source[idx * sizeof(FatDir_Type)];
+                if (entry[0] == ENTRY_FREE_FULL_FAT32)
                 {
-                    status = 1;
-                    break;
+                    goto tail;
                 }
-                else if (entry_child->DIR_Name[0] == ENTRY_FREE_FAT32)
+                if (entry[0] == ENTRY_FREE_FAT32)
                 {
+                    ++skipped;
                     continue;
                 }
-                if ((entry_child->DIR_Attr & ATTR_LONG_NAME_MASK) != ATTR_LONG_NAME)
+                stm_memcpy(&target[dst_offset * sizeof(FatDir_Type)], entry, sizeof(FatDir_Type));
+                if (skipped > 0)
                 {
-                    join_cluster_number(&cluster_child, entry_child->DIR_FstClusHI, entry_child->DIR_FstClusLO);
-
-                    if (fat32_is_special_dir(entry_child->DIR_Name) == 0)
-                    {
-                        memset(entry_child, 0x00, sizeof(FatDir_Type));
-                        continue;
-                    }
-
-                    if (entry_child->DIR_Attr & ATTR_DIRECTORY)
+                    // Открытые файлы продолжают указывать на свою SFN-запись
+                    DirEntryPosition from = {src_cluster, sector, (uint16_t)idx};
+                    DirEntryPosition to = {dst_cluster, dst_sector, (uint16_t)dst_offset};
+                    for (FAT32_File *file = open_files; file != NULL; file = file->next_open)
                     {
-                        status = delete_dir_recursive_fat32(cluster_child);
-                        if (status != 0)
+                        if (same_entry_position(&file->entry_pos, &from))
                         {
-                            goto cleanup;
-                        };
+                            file->entry_pos = to;
+                        }
                     }
-                    else if (entry_child->DIR_Attr == ATTR_SYSTEM)
+                }
+                if (++dst_offset < entries_per_sector)
+                {
+                    continue;
+                }
+
+                // Пока удалённых записей не встречалось, записи остаются на своих местах
+                if (skipped > 0)
+                {
+                    uint32_t dst_address = (dst_cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region + dst_sector;
+                    ++dir_generation;
+                    if (fat_info->device->write(target, 1, dst_address, fat_info->bytesPerSec) < 0)
                     {
-                        status = FAT32_ERR_DELETE_PROTECTED;
+                        status = FAT32_ERR_WRITE_FAIL;
                         goto cleanup;
                     }
-                    status = delete_entry_fat32(cluster_child);
-                    if (status != 0)
+                }
+                dst_offset = 0;
+                if (++dst_sector == fat_info->secPerClus)
+                {
+                    dst_sector = 0;
+                    dst_prev = dst_cluster;
+                    if (get_next_cluster_fat32(&dst_cluster) != 0)
                     {
+                        status = FAT32_ERR_READ_FAIL;
                         goto cleanup;
-                    };
+                    }
                 }
-                entry_child->DIR_Name[0] = ENTRY_FREE_FAT32;
             }
-            if (fat_info->device->write(buffer, 1, address, fat_info->bytesPerSec) != 0)
+        }
+        if (get_next_cluster_fat32(&src_cluster) != 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+    }
+
+tail:
+    if (dst_cluster == FILE_END_TABLE_FAT32)
+    {
+        // Каталог заполнен живыми записями до конца цепочки
+        goto cleanup;
+    }
+
+    if (dst_offset == 0 && dst_sector == 0 && dst_prev != 0)
+    {
+        // Кластер назначения остался пустым и освобождается целиком
+        next_cluster = dst_cluster;
+        dst_cluster = dst_prev;
+    }
+    else
+    {
+        if (skipped > 0)
+        {
+            memset(&target[dst_offset * sizeof(FatDir_Type)], 0, (entries_per_sector - dst_offset) * sizeof(FatDir_Type));
+            address = (dst_cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
+            ++dir_generation;
+            if (fat_info->device->write(target, 1, address + dst_sector, fat_info->bytesPerSec) < 0)
             {
                 status = FAT32_ERR_WRITE_FAIL;
                 goto cleanup;
             }
-            if (status == 1)
+            if (dst_sector + 1 < fat_info->secPerClus &&
+                fat_info->device->clear(address + dst_sector + 1, fat_info->secPerClus - dst_sector - 1, fat_info->bytesPerSec) < 0)
             {
-                status = 0;
+                status = FAT32_ERR_WRITE_FAIL;
                 goto cleanup;
             }
         }
-        if (get_next_cluster_fat32(&cluster) != 0)
+        next_cluster = dst_cluster;
+        if (get_next_cluster_fat32(&next_cluster) != 0)
         {
             status = FAT32_ERR_READ_FAIL;
             goto cleanup;
         }
-        if (cluster == FILE_END_TABLE_FAT32)
+    }
+
+    if (next_cluster != FILE_END_TABLE_FAT32)
+    {
+        if (update_fat32(dst_cluster, FILE_END_TABLE_FAT32) != 0)
         {
-            break;
+            status = FAT32_ERR_WRITE_FAIL;
+            goto cleanup;
         }
+        status = release_cluster_chain(&next_cluster, NULL, released_clusters);
     }
 
 cleanup:
-    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    // Положение записей изменилось: индекс имён и сведения о свободном месте устарели
+    fat32_dir_cache_invalidate(dir->first_cluster);
+    dir_handle_rewind(dir, dir->first_cluster);
+
+    if (fat32_free(source, fat_info->bytesPerSec) != 0)
+    {
+        // Вывод в лог
+    }
+    if (fat32_free(target, fat_info->bytesPerSec) != 0)
     {
         // Вывод в лог
     }
     return status;
 }
 
-/**
- * @brief Проверяет, пустая ли директория (не содержит файлов и папок, кроме "." и "..").
- *
- * @param cluster Кластер директории для проверки.
- * @return int
- *   1 — директория пустая,
- *   0 — содержит записи,
- *   <0 — код ошибки.
- */
-int is_dir_empty_fat32(uint32_t cluster)
+int fat32_stat_dir(const char *path, FAT32_StatEntry *entries, uint32_t capacity, uint32_t *count, uint8_t recursive)
 {
-    if (fat_info == NULL)
+    if (path == NULL || entries == NULL || count == NULL)
     {
-        return FAT32_ERR_FS_NOT_LOADED;
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
-    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
-    if (buffer == NULL)
+    *count = 0;
+
+    FAT32_Dir *dir = NULL;
+    int status = fat32_opendir(path, &dir);
+    if (status != 0)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        return status;
     }
 
-    int sector = 0;
-    uint32_t address = 0;
-    uint32_t idx = 2 * sizeof(FatDir_Type); // // Пропускаем первые две записи "." и ".."
-    int status = 0;
-    while (cluster != FILE_END_TABLE_FAT32)
+    // Массив результата служит очередью обхода в ширину: каталоги раскрываются
+    // в порядке их появления, дополнительная память не требуется
+    uint32_t filled = 0;
+    uint32_t next_dir = 0;
+    uint32_t parent = FAT32_STAT_NO_PARENT;
+    FAT32_DirInfo extra;
+
+    while (1)
     {
-        address = fat_info->address_region + (cluster - fat_info->root_cluster) * fat_info->secPerClus;
-        for (sector = 0; sector < fat_info->secPerClus; ++sector)
+        if (filled < capacity)
         {
-            if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+            status = fat32_readdir(dir, &entries[filled].info);
+            if (status > 0)
             {
-                status = FAT32_ERR_READ_FAIL;
-                goto cleanup;
+                entries[filled].parent = parent;
+                ++filled;
+                continue;
             }
-            for (; idx < fat_info->bytesPerSec; idx += sizeof(FatDir_Type))
+        }
+        else
+        {
+            status = fat32_readdir(dir, &extra);
+            if (status > 0)
             {
-                if (buffer[idx] == ENTRY_FREE_FULL_FAT32)
-                {
-                    return 0;
-                }
-                if (buffer[idx] == ENTRY_FREE_FAT32)
-                {
-                    continue;
-                }
-                else
-                {
-                    status = FAT32_ERR_DIR_NOT_EMPTY;
-                    goto cleanup;
-                }
+                status = FAT32_ERR_BUFFER_TOO_SMALL;
             }
-            idx = 0;
         }
-        status = get_next_cluster_fat32(&cluster);
+        if (status != 0 || !recursive)
+        {
+            break;
+        }
+
+        while (next_dir < filled && ((entries[next_dir].info.attr & ATTR_DIRECTORY) == 0 ||
+                                     entries[next_dir].info.first_cluster < fat_info->root_cluster))
+        {
+            ++next_dir;
+        }
+        if (next_dir == filled)
+        {
+            break;
+        }
+        parent = next_dir;
+        dir_handle_rewind(dir, entries[next_dir].info.first_cluster);
+        ++next_dir;
+    }
+
+    *count = filled;
+    fat32_closedir(&dir);
+    return status;
+}
+
+int list_directory_fat32(const char *path)
+{
+    FAT32_Dir *dir = NULL;
+    FAT32_DirInfo info;
+
+    int status = fat32_opendir(path, &dir);
+    if (status != 0)
+    {
+        return status;
+    }
+
+    while ((status = fat32_readdir(dir, &info)) > 0)
+    {
+        FAT32_LOG_INFO("%c %10lu %s\r\n", (info.attr & ATTR_DIRECTORY) ? 'd' : '-',
+                       (unsigned long)info.size, info.name);
+    }
+
+    fat32_closedir(&dir);
+    return status;
+}
+
+/**
+ * Разделяет 32-битный номер кластера на две 16-битные части: старшую и младшую.
+ *
+ * Это необходимо при работе с файловой системой FAT32, где номер кластера
+ * хранится в двух полях: DIR_FstClusHI (старшие 16 бит) и DIR_FstClusLO (младшие 16 бит).
+ *
+ * @param cluster  Полный 32-битный номер кластера.
+ * @param[out] high Указатель на переменную, куда будет записана старшая 16-битная часть.
+ * @param[out] low  Указатель на переменную, куда будет записана младшая 16-битная часть.
+ */
+void split_cluster_number(uint32_t cluster, uint16_t *high, uint16_t *low)
+{
+    if (low == NULL || high == NULL)
+        return;
+    *low = cluster & 0xFFFF;
+    *high = (cluster >> 16) & 0xFFFF;
+}
+
+/**
+ * Объединяет два 16-битных значения (старшую и младшую части) в одно 32-битное значение кластера.
+ *
+ * Эта функция используется в FAT32 для объединения двух полей из записи директории:
+ * - DIR_FstClusHI (старшие 16 бит номера кластера)
+ * - DIR_FstClusLO (младшие 16 бит номера кластера)
+ *
+ * @param cluster Указатель на переменную, в которую будет записан полный номер кластера.
+ * @param high    Старшие 16 бит номера кластера.
+ * @param low     Младшие 16 бит номера кластера.
+ */
+void join_cluster_number(uint32_t *cluster, uint16_t high, uint16_t low)
+{
+    if (cluster == NULL)
+        return;
+    *cluster = ((uint32_t)high << 16) | ((uint32_t)low << 0);
+}
+
+int fat32_get_layout(FatLayoutInfo *layout)
+{
+    if (layout == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    *layout = *fat_info;
+    return 0;
+}
+
+int count_free_clusters_fat32(uint32_t *free_count)
+{
+    if (free_count == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    if (fat_info->free_count != FAT32_FREE_COUNT_UNKNOWN)
+    {
+        *free_count = fat_info->free_count;
+        return 0;
+    }
+
+    uint32_t batch_size = fat_info->bytesPerSec * FAT32_FAT_SCAN_SECTORS;
+    uint32_t *buffer = fat32_alloc(batch_size);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    uint32_t sector = 0, count_sectors = 0;
+    uint32_t first_entry = 0, count_entries = 0, idx = 0;
+    uint32_t total = 0;
+    int status = 0;
+
+    for (sector = 0; sector < fat_info->sizeFAT; sector += count_sectors)
+    {
+        first_entry = sector * fat_info->fat_ents_sec;
+        if (first_entry >= fat_info->cluster_count)
+        {
+            break;
+        }
+        count_sectors = fat_info->sizeFAT - sector;
+        if (count_sectors > FAT32_FAT_SCAN_SECTORS)
+        {
+            count_sectors = FAT32_FAT_SCAN_SECTORS;
+        }
+        if (fat_info->device->read((uint8_t *)buffer, count_sectors, fat_info->address_tabl1 + sector, fat_info->bytesPerSec) < 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+        count_entries = count_sectors * fat_info->fat_ents_sec;
+        if (first_entry + count_entries > fat_info->cluster_count)
+        {
+            count_entries = fat_info->cluster_count - first_entry;
+        }
+        idx = (first_entry == 0) ? 2 : 0;
+        total += fat32_scan_count_free(buffer + idx, count_entries - idx);
+    }
+
+    fat_info->free_count = total;
+    *free_count = total;
+
+cleanup:
+    if (fat32_free(buffer, batch_size) != 0)
+    {
+        // вывод в лог
+    }
+    return status;
+}
+
+/**
+ * Учитывает изменение записи FAT в счётчике свободных кластеров.
+ *
+ * @param old_value Прежнее значение записи.
+ * @param new_value Новое значение записи.
+ */
+static void account_fat_entry_change(uint32_t old_value, uint32_t new_value)
+{
+    if (fat_info == NULL || fat_info->free_count == FAT32_FREE_COUNT_UNKNOWN)
+        return;
+    old_value &= FAT32_ENTRY_MASK;
+    new_value &= FAT32_ENTRY_MASK;
+    if (old_value == FREE_CLUSTER && new_value != FREE_CLUSTER)
+        --fat_info->free_count;
+    else if (old_value != FREE_CLUSTER && new_value == FREE_CLUSTER)
+        ++fat_info->free_count;
+}
+
+/**
+ * Обновляет запись в таблице FAT32 для указанного кластера в обеих копиях FAT.
+ *
+ * Функция сначала изменяет FAT1, затем FAT2. Если обновление второй копии (FAT2) не удалось,
+ * FAT1 останется обновлённой, что приведёт к частичной неконсистентности.
+ * В случае ошибки пользователь обязан сам обработать откат снаружи.
+ *
+ * @param cluster Номер кластера для обновления.
+ * @param value Значение, которое будет записано (например, номер следующего кластера или EOF).
+ *
+ * @return 0 — успех,
+ *         FAT32_ERR_INVALID_ARGUMENT — некорректный указатель fat_info,
+ *         FAT32_ERR_ALLOC_FAILED — не удалось выделить память из пула,
+ *         FAT32_ERR_UPDATE_FAILED — ошибка при работе с FAT1,
+ *         FAT32_ERR_UPDATE_PARTIAL_FAIL — FAT1 обновлена, FAT2 — нет (требуется откат на стороне вызывающего кода).
+ */
+int update_fat32(uint32_t cluster, uint32_t value)
+{
+    if (fat_info == NULL)
+        return FAT32_ERR_INVALID_ARGUMENT;
+
+    uint32_t sector = ((uint32_t)cluster / fat_info->fat_ents_sec);
+    uint32_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    int status = 0;
+
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    status = fat_info->device->read((uint8_t *)buffer, 1, fat_info->address_tabl1 + sector, fat_info->bytesPerSec);
+    if (status < 0)
+    {
+        status = FAT32_ERR_UPDATE_FAILED;
+        goto update_failed;
+    }
+    uint32_t idx_entry = (uint32_t)(cluster % fat_info->fat_ents_sec);
+    uint32_t old_value = buffer[idx_entry] & FAT32_ENTRY_MASK;
+
+    buffer[idx_entry] = value;
+    status = fat_info->device->write((uint8_t *)buffer, 1, fat_info->address_tabl1 + sector, fat_info->bytesPerSec);
+    if (status < 0)
+    {
+        status = FAT32_ERR_UPDATE_FAILED;
+        goto update_failed;
+    }
+    account_fat_entry_change(old_value, value);
+
+    status = fat_info->device->read((uint8_t *)buffer, 1, fat_info->address_tabl2 + sector, fat_info->bytesPerSec);
+    if (status < 0)
+    {
+        fat32_free(buffer, fat_info->bytesPerSec);
+        return FAT32_ERR_UPDATE_PARTIAL_FAIL;
+    }
+
+    buffer[idx_entry] = value;
+    status = fat_info->device->write((uint8_t *)buffer, 1, fat_info->address_tabl2 + sector, fat_info->bytesPerSec);
+    if (status < 0)
+    {
+        fat32_free(buffer, fat_info->bytesPerSec);
+        return FAT32_ERR_UPDATE_PARTIAL_FAIL;
+    }
+
+update_failed:
+    if (status == 0)
+    {
+    }
+    status = fat32_free((uint8_t *)buffer, fat_info->bytesPerSec);
+    if (status != 0)
+    {
+        // вывод в лог
+    }
+
+    return status;
+}
+
+/**
+ * Получает следующий кластер в цепочке FAT32.
+ *
+ * @param prev_cluster [in, out] - указатель на текущий кластер; при успешном завершении
+ *                                будет обновлен на следующий кластер.
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_ARGUMENT если fat_info не инициализирован,
+ *         FAT32_ERR_ALLOC_FAILED при ошибке выделения памяти.
+ */
+int get_next_cluster_fat32(uint32_t *prev_cluster)
+{
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    int status = 0;
+    uint32_t address = fat_info->address_tabl1 + *prev_cluster / fat_info->fat_ents_sec;
+    uint32_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+    status = fat_info->device->read((uint8_t *)buffer, 1, address, fat_info->bytesPerSec);
+    if (status < 0)
+    {
+        status = FAT32_ERR_READ_FAIL;
+        goto cleanup;
+    }
+    uint32_t idx_entry = (uint32_t)(*prev_cluster % fat_info->fat_ents_sec);
+    *prev_cluster = buffer[idx_entry] & FAT32_ENTRY_MASK;
+    // Любое значение из диапазона конца цепочки приводится к FILE_END_TABLE_FAT32
+    if (*prev_cluster >= FAT32_CLUSTER_EOC_MIN)
+    {
+        *prev_cluster = FILE_END_TABLE_FAT32;
+    }
+
+cleanup:
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // вывод в Лог
+    }
+    return status;
+}
+
+/**
+ * Ищет свободные участки политикой выделения тома.
+ *
+ * Если свободного места нет, а в очереди отложенного освобождения есть цепочки,
+ * очередь освобождается полностью и поиск повторяется.
+ */
+static int policy_find_runs(uint32_t goal, uint32_t count, Fat32ClusterAlloc *alloc)
+{
+    int status = fat_info->alloc_policy->find_runs(goal, count, alloc);
+    if (status == FAT32_ERR_DISK_FULL && deferred_count > 0 && fat32_free_step(0) == 0)
+    {
+        status = fat_info->alloc_policy->find_runs(goal, count, alloc);
+    }
+    return status;
+}
+
+/**
+ * Выделяет свободный кластер и помечает его концом цепочки (EOF) в таблице FAT.
+ *
+ * Кластер выбирается политикой выделения тома (см. mount_fat32_ex).
+ *
+ * @param new_cluster [in] Ориентир для политики: последний кластер удлиняемой цепочки
+ *                    или кластер каталога нового объекта (0 или FILE_END_TABLE_FAT32 — нет);
+ *                    [out] номер выделенного кластера.
+ * @return 0 при успехе,
+ *         FAT32_ERR_INVALID_ARGUMENT — если аргумент NULL,
+ *         FAT32_ERR_DISK_FULL — если свободный кластер не найден,
+ *         FAT32_ERR_UPDATE_FAILED — если не удалось записать в обе FAT-таблицы,
+ *         FAT32_ERR_UPDATE_PARTIAL_FAIL — если запись прошла только в одну таблицу, но откат удался,
+ *         FAT32_ERR_RECOVERY_FAILED — если не удалось выполнить откат после частичной записи.
+ */
+int allocate_cluster_fat32(uint32_t *new_cluster)
+{
+    int status = 0;
+    if (new_cluster == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+
+    // Кластер выбирает политика выделения тома; входное значение — желательное соседство
+    uint32_t goal = (*new_cluster == FILE_END_TABLE_FAT32) ? 0 : *new_cluster;
+    Fat32ClusterAlloc alloc;
+    *new_cluster = FILE_END_TABLE_FAT32;
+    status = policy_find_runs(goal, 1, &alloc);
+    if (status != 0)
+    {
+        return status;
+    }
+    *new_cluster = alloc.runs[0].first;
+
+    // Обновляем информацию в таблицах FAT
+    status = update_fat32(*new_cluster, FILE_END_TABLE_FAT32);
+    if (status == FAT32_ERR_UPDATE_PARTIAL_FAIL)
+    {
+        status = update_fat32(*new_cluster, NOT_USED_CLUSTER_FAT32);
+        if (status == FAT32_ERR_UPDATE_FAILED)
+        {
+            return FAT32_ERR_UPDATE_PARTIAL_FAIL;
+        }
+        else
+        {
+            status = FAT32_ERR_UPDATE_FAILED;
+        }
+    }
+    return (status == 0 ? 0 : FAT32_ERR_UPDATE_FAILED);
+}
+
+/**
+ * Дописывает в alloc свободные участки FAT из диапазона кластеров [from, to).
+ *
+ * @param count  Требуемое общее количество кластеров в alloc.
+ * @param buffer Буфер на FAT32_FAT_SCAN_SECTORS секторов.
+ * @return 0 — диапазон просмотрен или набрано count кластеров,
+ *         1 — закончились места под участки (поиск нужно прекратить),
+ *         FAT32_ERR_READ_FAIL — ошибка чтения FAT.
+ */
+static int scan_free_runs(uint32_t from, uint32_t to, uint32_t count, Fat32ClusterAlloc *alloc, uint32_t *buffer)
+{
+    uint32_t cluster = from;
+    while (cluster < to && alloc->total < count)
+    {
+        uint32_t sector = cluster / fat_info->fat_ents_sec;
+        uint32_t count_sectors = fat_info->sizeFAT - sector;
+        if (count_sectors > FAT32_FAT_SCAN_SECTORS)
+        {
+            count_sectors = FAT32_FAT_SCAN_SECTORS;
+        }
+        if (fat_info->device->read((uint8_t *)buffer, count_sectors, fat_info->address_tabl1 + sector, fat_info->bytesPerSec) < 0)
+        {
+            return FAT32_ERR_READ_FAIL;
+        }
+        uint32_t first_entry = sector * fat_info->fat_ents_sec;
+        uint32_t count_entries = count_sectors * fat_info->fat_ents_sec;
+        if (first_entry + count_entries > to)
+        {
+            count_entries = to - first_entry;
+        }
+
+        uint32_t idx = cluster - first_entry;
+        while (idx < count_entries && alloc->total < count)
+        {
+            uint32_t length = 0;
+            idx += fat32_scan_free_run(buffer + idx, count_entries - idx, &length);
+            if (idx >= count_entries)
+            {
+                break;
+            }
+            if (length > count - alloc->total)
+            {
+                length = count - alloc->total;
+            }
+
+            uint32_t run_first = first_entry + idx;
+            Fat32ClusterRun *last = (alloc->run_count > 0) ? &alloc->runs[alloc->run_count - 1] : NULL;
+            if (last != NULL && last->first + last->count == run_first)
+            {
+                // Участок продолжается через границу блока секторов
+                last->count += length;
+            }
+            else if (alloc->run_count < FAT32_ALLOC_MAX_RUNS)
+            {
+                alloc->runs[alloc->run_count].first = run_first;
+                alloc->runs[alloc->run_count].count = length;
+                ++alloc->run_count;
+            }
+            else
+            {
+                return 1;
+            }
+            alloc->total += length;
+            idx += length;
+        }
+        cluster = first_entry + count_sectors * fat_info->fat_ents_sec;
+    }
+    return 0;
+}
+
+int fat32_find_free_runs(uint32_t start, uint32_t count, Fat32ClusterAlloc *alloc)
+{
+    if (alloc == NULL || count == 0)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    alloc->run_count = 0;
+    alloc->total = 0;
+    if (start < 2 || start >= fat_info->cluster_count)
+    {
+        start = 2;
+    }
+
+    uint32_t batch_size = fat_info->bytesPerSec * FAT32_FAT_SCAN_SECTORS;
+    uint32_t *buffer = fat32_alloc(batch_size);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    // От start до конца тома, затем с начала до start
+    int status = scan_free_runs(start, fat_info->cluster_count, count, alloc, buffer);
+    if (status == 0 && start > 2)
+    {
+        status = scan_free_runs(2, start, count, alloc, buffer);
+    }
+    if (status > 0)
+    {
+        status = 0;
+    }
+
+    if (fat32_free(buffer, batch_size) != 0)
+    {
+        // вывод в лог
+    }
+    if (status == 0 && alloc->total == 0)
+    {
+        status = FAT32_ERR_DISK_FULL;
+    }
+    return status;
+}
+
+int fat32_cluster_is_free(uint32_t cluster)
+{
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    if (cluster < 2 || cluster >= fat_info->cluster_count)
+    {
+        return 0;
+    }
+    int status = get_next_cluster_fat32(&cluster);
+    if (status != 0)
+    {
+        return status;
+    }
+    return (cluster == FREE_CLUSTER);
+}
+
+/**
+ * Записывает записи выделенных участков в одну копию FAT.
+ *
+ * Сектор FAT записывается при переходе к следующему сектору, поэтому при участках,
+ * упорядоченных по возрастанию номеров, каждый затронутый сектор читается и
+ * записывается один раз; участки после оборота поиска (next-fit, locality) могут
+ * вернуться к уже записанному сектору — он читается повторно.
+ *
+ * @param fat_address Первый сектор копии FAT.
+ * @param alloc       Выделенные участки.
+ * @param release     0 — связать участки в цепочку, 1 — освободить их.
+ * @param buffer      Буфер на один сектор.
+ * @return 0 при успехе, FAT32_ERR_UPDATE_FAILED при ошибке ввода-вывода.
+ */
+static int write_run_entries(uint32_t fat_address, const Fat32ClusterAlloc *alloc, int release, uint32_t *buffer)
+{
+    // Счётчик свободных кластеров учитывает только первую копию FAT
+    int account = (fat_address == fat_info->address_tabl1);
+    uint32_t loaded = 0;
+    int have_sector = 0;
+
+    for (uint32_t run = 0; run < alloc->run_count; ++run)
+    {
+        uint32_t end = alloc->runs[run].first + alloc->runs[run].count;
+        for (uint32_t cluster = alloc->runs[run].first; cluster < end; ++cluster)
+        {
+            uint32_t sector = cluster / fat_info->fat_ents_sec;
+            if (!have_sector || sector != loaded)
+            {
+                if (have_sector &&
+                    fat_info->device->write((uint8_t *)buffer, 1, fat_address + loaded, fat_info->bytesPerSec) < 0)
+                {
+                    return FAT32_ERR_UPDATE_FAILED;
+                }
+                if (fat_info->device->read((uint8_t *)buffer, 1, fat_address + sector, fat_info->bytesPerSec) < 0)
+                {
+                    return FAT32_ERR_UPDATE_FAILED;
+                }
+                loaded = sector;
+                have_sector = 1;
+            }
+
+            uint32_t value = FREE_CLUSTER;
+            if (!release)
+            {
+                if (cluster + 1 < end)
+                    value = cluster + 1;
+                else if (run + 1 < alloc->run_count)
+                    value = alloc->runs[run + 1].first;
+                else
+                    value = FILE_END_TABLE_FAT32;
+            }
+            uint32_t idx_entry = cluster % fat_info->fat_ents_sec;
+            if (account)
+            {
+                account_fat_entry_change(buffer[idx_entry], value);
+            }
+            buffer[idx_entry] = value;
+        }
+    }
+    if (have_sector &&
+        fat_info->device->write((uint8_t *)buffer, 1, fat_address + loaded, fat_info->bytesPerSec) < 0)
+    {
+        return FAT32_ERR_UPDATE_FAILED;
+    }
+    return 0;
+}
+
+/**
+ * Записывает цепочку найденных участков в обе копии FAT и присоединяет её к last_cluster.
+ *
+ * @param last_cluster Последний кластер существующей цепочки (0 — новая цепочка).
+ * @param alloc        Участки; при ошибке обнуляются.
+ * @return 0 при успехе, FAT32_ERR_ALLOC_FAILED, FAT32_ERR_UPDATE_FAILED (участки освобождены).
+ */
+static int link_cluster_runs(uint32_t last_cluster, Fat32ClusterAlloc *alloc)
+{
+    uint32_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    int status = write_run_entries(fat_info->address_tabl1, alloc, 0, buffer);
+    if (status == 0)
+    {
+        status = write_run_entries(fat_info->address_tabl2, alloc, 0, buffer);
+    }
+    // Новая цепочка записана в обе копии FAT: только теперь она присоединяется к файлу
+    if (status == 0 && last_cluster != 0)
+    {
+        status = update_fat32(last_cluster, alloc->runs[0].first);
+        if (status == FAT32_ERR_UPDATE_PARTIAL_FAIL)
+        {
+            update_fat32(last_cluster, FILE_END_TABLE_FAT32);
+        }
+    }
+    if (status != 0)
+    {
+        write_run_entries(fat_info->address_tabl1, alloc, 1, buffer);
+        write_run_entries(fat_info->address_tabl2, alloc, 1, buffer);
+        alloc->run_count = 0;
+        alloc->total = 0;
+        status = FAT32_ERR_UPDATE_FAILED;
+    }
+
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // вывод в лог
+    }
+    return status;
+}
+
+int fat32_allocate_clusters(uint32_t last_cluster, uint32_t count, Fat32ClusterAlloc *alloc)
+{
+    if (alloc == NULL || count == 0)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    if (last_cluster != 0 && (last_cluster < 2 || last_cluster >= fat_info->cluster_count))
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+
+    int status = policy_find_runs(last_cluster, count, alloc);
+    if (status != 0)
+    {
+        return status;
+    }
+    return link_cluster_runs(last_cluster, alloc);
+}
+
+int fat32_find_contiguous_run(uint32_t count, int first_fit, Fat32ClusterRun *best)
+{
+    if (best == NULL || count == 0)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    best->first = 0;
+    best->count = 0;
+
+    uint32_t batch_size = fat_info->bytesPerSec * FAT32_FAT_SCAN_SECTORS;
+    uint32_t *buffer = fat32_alloc(batch_size);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    // Текущий участок может продолжаться через границу блока секторов
+    Fat32ClusterRun run = {0, 0};
+    uint32_t sector = 0, count_sectors = 0;
+    uint32_t first_entry = 0, count_entries = 0, idx = 0;
+    int status = 0;
+
+    for (sector = 0; sector < fat_info->sizeFAT; sector += count_sectors)
+    {
+        first_entry = sector * fat_info->fat_ents_sec;
+        if (first_entry >= fat_info->cluster_count)
+        {
+            break;
+        }
+        count_sectors = fat_info->sizeFAT - sector;
+        if (count_sectors > FAT32_FAT_SCAN_SECTORS)
+        {
+            count_sectors = FAT32_FAT_SCAN_SECTORS;
+        }
+        if (fat_info->device->read((uint8_t *)buffer, count_sectors, fat_info->address_tabl1 + sector, fat_info->bytesPerSec) < 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+        count_entries = count_sectors * fat_info->fat_ents_sec;
+        if (first_entry + count_entries > fat_info->cluster_count)
+        {
+            count_entries = fat_info->cluster_count - first_entry;
+        }
+
+        idx = (first_entry == 0) ? 2 : 0;
+        while (idx < count_entries)
+        {
+            uint32_t length = 0;
+            idx += fat32_scan_free_run(buffer + idx, count_entries - idx, &length);
+            if (idx >= count_entries)
+            {
+                break;
+            }
+            uint32_t cluster = first_entry + idx;
+            if (run.count > 0 && run.first + run.count == cluster)
+            {
+                run.count += length;
+            }
+            else
+            {
+                if (run.count >= count && (best->count == 0 || run.count < best->count))
+                {
+                    *best = run;
+                    if (best->count == count)
+                    {
+                        goto cleanup;
+                    }
+                }
+                run.first = cluster;
+                run.count = length;
+            }
+            if (first_fit && run.count >= count)
+            {
+                *best = run;
+                goto cleanup;
+            }
+            idx += length;
+        }
+    }
+    if (run.count >= count && (best->count == 0 || run.count < best->count))
+    {
+        *best = run;
+    }
+
+cleanup:
+    if (fat32_free(buffer, batch_size) != 0)
+    {
+        // вывод в лог
+    }
+    if (status == 0 && best->count == 0)
+    {
+        status = FAT32_ERR_NOT_FOUND;
+    }
+    if (status == 0)
+    {
+        best->count = count;
+    }
+    return status;
+}
+
+/**
+ * Выделяет count кластеров одним непрерывным участком и присоединяет их к last_cluster.
+ *
+ * Если непрерывного участка нужной длины нет, кластеры выделяются первыми подходящими
+ * участками, как в fat32_allocate_clusters (возможно, меньше count).
+ *
+ * @param first_fit 0 — наименьший подходящий участок, 1 — первый подходящий.
+ * @return 0 при успехе, иначе код ошибки fat32_allocate_clusters.
+ */
+static int allocate_contiguous(uint32_t last_cluster, uint32_t count, int first_fit, Fat32ClusterAlloc *alloc)
+{
+    int status = fat32_find_contiguous_run(count, first_fit, &alloc->runs[0]);
+    if (status == FAT32_ERR_NOT_FOUND)
+    {
+        return fat32_allocate_clusters(last_cluster, count, alloc);
+    }
+    if (status != 0)
+    {
+        return status;
+    }
+    alloc->run_count = 1;
+    alloc->total = count;
+    return link_cluster_runs(last_cluster, alloc);
+}
+
+/**
+ * Запоминает в дескрипторе участки, присоединённые к цепочке файла после last_cluster.
+ *
+ * Если last_cluster завершает последний известный участок, новые участки дописываются
+ * (смежные объединяются); иначе, а также при нехватке места, прежние участки отбрасываются.
+ */
+static void file_extents_link(FAT32_File *file, uint32_t last_cluster, const Fat32ClusterAlloc *alloc)
+{
+    Fat32ClusterAlloc *extents = &file->extents;
+    Fat32ClusterRun *tail = (extents->run_count > 0) ? &extents->runs[extents->run_count - 1] : NULL;
+    if (tail == NULL || tail->first + tail->count - 1 != last_cluster)
+    {
+        *extents = *alloc;
+        return;
+    }
+    for (uint32_t run = 0; run < alloc->run_count; ++run)
+    {
+        tail = &extents->runs[extents->run_count - 1];
+        if (tail->first + tail->count == alloc->runs[run].first)
+        {
+            tail->count += alloc->runs[run].count;
+        }
+        else if (extents->run_count < FAT32_ALLOC_MAX_RUNS)
+        {
+            extents->runs[extents->run_count++] = alloc->runs[run];
+        }
+        else
+        {
+            *extents = *alloc;
+            return;
+        }
+        extents->total += alloc->runs[run].count;
+    }
+}
+
+/**
+ * Переходит к следующему кластеру цепочки файла.
+ *
+ * Внутри известных участков дескриптора следующий кластер вычисляется без чтения FAT.
+ *
+ * @param file    Дескриптор файла.
+ * @param cluster [in/out] Текущий кластер; заменяется следующим или FILE_END_TABLE_FAT32.
+ * @return 0 при успехе, иначе код ошибки get_next_cluster_fat32.
+ */
+static int file_next_cluster(const FAT32_File *file, uint32_t *cluster)
+{
+    const Fat32ClusterAlloc *extents = &file->extents;
+    for (uint32_t run = 0; run < extents->run_count; ++run)
+    {
+        uint32_t first = extents->runs[run].first;
+        uint32_t end = first + extents->runs[run].count;
+        if (*cluster < first || *cluster >= end)
+        {
+            continue;
+        }
+        if (*cluster + 1 < end)
+        {
+            ++*cluster;
+            return 0;
+        }
+        if (run + 1 < extents->run_count)
+        {
+            *cluster = extents->runs[run + 1].first;
+            return 0;
+        }
+        break;
+    }
+    return get_next_cluster_fat32(cluster);
+}
+
+int fat32_preallocate(FAT32_File *file, uint32_t bytes)
+{
+    if (file == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    if (file->flags == F_READ)
+    {
+        return FAT32_ERR_INVALID_FILE_MODE;
+    }
+
+    uint32_t cluster_bytes = fat_info->secPerClus * fat_info->bytesPerSec;
+    uint32_t needed = bytes / cluster_bytes + (bytes % cluster_bytes != 0);
+
+    // Длина цепочки проверяется от текущей позиции: предыдущие кластеры уже существуют
+    uint32_t last_cluster = file->position.cluster_number;
+    uint32_t have = file->position.cluster_idx + 1;
+    int status = 0;
+    while (have < needed)
+    {
+        uint32_t cluster = last_cluster;
+        status = file_next_cluster(file, &cluster);
+        if (status != 0)
+        {
+            return status;
+        }
+        if (cluster == FILE_END_TABLE_FAT32)
+        {
+            break;
+        }
+        last_cluster = cluster;
+        ++have;
+    }
+    if (have >= needed)
+    {
+        return 0;
+    }
+
+    uint32_t missing = needed - have;
+    uint32_t free_count = 0;
+    status = count_free_clusters_fat32(&free_count);
+    if (status != 0)
+    {
+        return status;
+    }
+    if (free_count < missing && deferred_count > 0)
+    {
+        status = fat32_free_step(0);
+        if (status < 0)
+        {
+            return status;
+        }
+        status = count_free_clusters_fat32(&free_count);
+        if (status != 0)
+        {
+            return status;
+        }
+    }
+    if (free_count < missing)
+    {
+        return FAT32_ERR_DISK_FULL;
+    }
+
+    // Наименьший подходящий участок; если его нет — первые подходящие участки
+    Fat32ClusterAlloc alloc;
+    status = allocate_contiguous(last_cluster, missing, 0, &alloc);
+    while (status == 0)
+    {
+        file_extents_link(file, last_cluster, &alloc);
+        last_cluster = alloc.runs[alloc.run_count - 1].first + alloc.runs[alloc.run_count - 1].count - 1;
+        missing -= alloc.total;
+        if (missing == 0)
+        {
+            break;
+        }
+        status = fat32_allocate_clusters(last_cluster, missing, &alloc);
+    }
+    return status;
+}
+
+/**
+ * Проверяет, существует ли следующий кластер в цепочке,
+ * и при необходимости выделяет новый кластер, расширяя цепочку.
+ *
+ * @param last_cluster Указатель на текущий (последний) кластер в цепочке.
+ *                     При успешном расширении обновляется на следующий кластер.
+ *
+ * @return 0 при успехе (либо если кластер уже продолжен, либо если выделен новый),
+ *         FAT32_ERR_INVALID_ARGUMENT — если аргумент некорректен,
+ *         FAT32_ERR_DISK_FULL — если не удалось найти свободный кластер,
+ *         FAT32_ERR_UPDATE_FAILED — ошибка обновления FAT,
+ *         FAT32_ERR_UPDATE_PARTIAL_FAIL — если FAT обновлена частично,
+ *         FAT32_ERR_RECOVERY_FAILED — если откат не удался.
+ */
+int extend_cluster_chain_if_needed(uint32_t *last_cluster)
+{
+    uint32_t cluster_next = *last_cluster;
+    if (last_cluster == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+
+    // Ищем следующий кластер в цепочке
+    int status = get_next_cluster_fat32(&cluster_next);
+    if (status == 0 && cluster_next != FILE_END_TABLE_FAT32)
+    {
+        *last_cluster = cluster_next;
+        return 0;
+    }
+
+    // Если кластер не найден, добавляем новый кластер и присоединяем его к цепочке
+    cluster_next = *last_cluster;
+    status = allocate_cluster_fat32(&cluster_next);
+    if (status != 0)
+    {
+        return status;
+    }
+    status = update_fat32(*last_cluster, cluster_next);
+    if (status != 0)
+    {
+        update_fat32(cluster_next, FREE_CLUSTER);
+        return FAT32_ERR_UPDATE_FAILED;
+    }
+    *last_cluster = cluster_next;
+    return 0;
+}
+
+/**
+ * Проверяет, является ли запись в каталоге FAT32 свободной.
+ *
+ * @param entry Указатель на структуру записи каталога FAT32 (FatDir_Type).
+ * @return 0 — если запись свободна,
+ *         1 — если запись занята,
+ *        FAT32_ERR_INVALID_ARGUMENT — если передан NULL-указатель.
+ *
+ * Свободные записи определяются по первому байту имени:
+ *   - 0x00 (ENTRY_FREE_FAT32) — запись никогда не использовалась.
+ *   - 0xE5 (ENTRY_FREE_FULL_FAT32) — запись удалена.
+ */
+int is_free_entry_fat32(FatDir_Type *entry)
+{
+    if (entry == NULL)
+        return FAT32_ERR_INVALID_ARGUMENT;
+
+    if (entry->DIR_Name[0] == ENTRY_FREE_FAT32 || entry->DIR_Name[0] == ENTRY_FREE_FULL_FAT32)
+    {
+        return 0;
+    }
+    return 1;
+}
+
+int path_exists_fat32(char *path)
+{
+    uint32_t cluster = 0;
+    if (path == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    return (find_directory_fat32(path, &cluster) == 0 ? 0 : 1);
+}
+
+int path_exists_at_fat32(FAT32_Dir *dir, const char *name)
+{
+    uint32_t cluster = 0;
+    if (dir == NULL || name == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    if (validate_relative_path(name) != 0)
+    {
+        return 1;
+    }
+    return (resolve_path_fat32(dir->first_cluster, name, strlen(name), &cluster) == 0 ? 0 : 1);
+}
+
+/**
+ * @brief Заполняет поля имени в LFN-структуре (Long File Name) символами UTF-16.
+ *
+ * FAT LFN-записи хранят до 13 символов UTF-16:
+ *
+ * Эта функция копирует заданные символы в соответствующие поля структуры.
+ * Если длина меньше 13, оставшиеся позиции заполняются 0xFFFF (указание на конец строки).
+ *
+ * @param entry        Указатель на структуру LDIR_Type, которую нужно заполнить.
+ * @param utf16_chunk  Указатель на массив UTF-16 символов (не более 13).
+ * @param length       Количество символов в utf16_chunk (от 0 до 13).
+ */
+void fill_lfn_name_fields(LDIR_Type *entry, const uint16_t *utf16_chunk, uint8_t length)
+{
+    int idx = 0;
+    uint16_t *lfn_fields[MAX_SYMBOLS_ENTRY] = {0};
+
+    for (idx = 0; idx < 5; ++idx)
+        lfn_fields[idx] = (uint16_t *)&entry->LDIR_Name1[idx * 2];
+    for (idx = 0; idx < 6; ++idx)
+        lfn_fields[idx + 5] = (uint16_t *)&entry->LDIR_Name2[idx * 2];
+    for (idx = 0; idx < 2; ++idx)
+        lfn_fields[idx + 11] = (uint16_t *)&entry->LDIR_Name3[idx * 2];
+
+    for (idx = 0; idx < MAX_SYMBOLS_ENTRY; ++idx)
+    {
+        if (idx < length)
+        {
+            *lfn_fields[idx] = utf16_chunk[idx];
+        }
+        else
+        {
+            *lfn_fields[idx] = 0xFFFF;
+        }
+    }
+}
+
+/**
+ * @brief Создаёт LFN-записи (Long File Name) для длинного имени файла.
+ *
+ * FAT LFN хранит длинные имена в нескольких 13-символьных записях,
+ * каждая из которых является структурой LDIR_Type.
+ *
+ * @param name          Исходное имя файла в UTF-8.
+ * @param length        Длина имени файла (в байтах).
+ * @param chkSum        Контрольная сумма короткого имени (SFN), используемая в LFN-записях.
+ * @param entries       Указатель на массив LDIR_Type для записи LFN-записей.
+ * @param numb_entries  Количество LFN-записей (обычно вычисляется как ceil(length/13)).
+ *
+ * @return 0 при успехе, код ошибки при неудаче.
+ */
+int make_lfn_entries(const char *name, uint32_t length, uint8_t chkSum, LDIR_Type *entries, uint16_t numb_entries)
+{
+    if (entries == NULL || name == NULL)
+        return FAT32_ERR_INVALID_ARGUMENT;
+
+    int idx = 0;
+    // В UTF-16 символов не больше, чем байт в UTF-8
+    uint32_t size_buffer = length + 1;
+    uint16_t *name_utf16le = fat32_alloc(size_buffer * sizeof(uint16_t));
+    if (name_utf16le == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    LDIR_Type *entry = NULL;
+
+    int length_utf16 = fat32_utf8_to_utf16le(name, length, name_utf16le, length);
+    if (length_utf16 <= 0)
+    {
+        if (fat32_free(name_utf16le, size_buffer * sizeof(uint16_t)))
+        {
+            // вывод в лог
+        }
+        return FAT32_ERR_INVALID_CHAR;
+    }
+    name_utf16le[length_utf16] = 0x0000;
+
+    for (idx = 0; idx < numb_entries; ++idx)
+    {
+        entry = &entries[numb_entries - idx - 1];
+        entry->LDIR_Attr = ATTR_LONG_NAME;
+        entry->LDIR_FstClusLO = 0;
+        entry->LDIR_Type = 0;
+        entry->LDIR_Chksum = chkSum;
+        entry->LDIR_Ord = idx + 1;
+        uint32_t remaining = length_utf16 + 1 - (idx * LFN_NAME_LENGTH);
+        fill_lfn_name_fields(entry, name_utf16le + (idx * LFN_NAME_LENGTH),
+                             (remaining < LFN_NAME_LENGTH) ? remaining : LFN_NAME_LENGTH);
+    }
+
+    // Помечаем первую (последнюю в физическом порядке) LFN-запись как последнюю (бит 0x40 в LDIR_Ord)
+    entries[0].LDIR_Ord |= LFN_ENTRY_LAST;
+
+    if (fat32_free(name_utf16le, size_buffer * sizeof(uint16_t)))
+    {
+        // вывод в лог
+    }
+    return 0;
+}
+
+// Наибольший номер хвоста "~N": хвост с тильдой занимает не более 7 символов имени
+#define SFN_TAIL_MAX 999999
+// Количество младших номеров хвоста, занятость которых собирается за проход по каталогу
+#define SFN_TAIL_BITMAP_BITS 256
+
+/**
+ * @brief Генерирует уникальное в каталоге короткое имя для длинного имени.
+ *
+ * Занятые хвосты "~N" основы имени собираются в битовую карту за один проход по
+ * каталогу, выбирается наименьший свободный номер. Номер, начиная с которого все
+ * хвосты свободны, запоминается в кэше каталогов, поэтому следующие имена с той же
+ * основой (например, файлы ротации логов) получают хвост без сканирования.
+ *
+ * @param dir_cluster Первый кластер каталога.
+ * @param name        Длинное имя.
+ * @param length      Длина имени.
+ * @param sfn         [out] Короткое имя (11 байт).
+ * @return 0 при успехе, иначе код ошибки.
+ */
+static int generate_sfn_alias(uint32_t dir_cluster, const char *name, uint32_t length, uint8_t sfn[11])
+{
+    uint8_t basis[SHORT_NAME_SIZE];
+    uint8_t base_len = fat32_sfn_basis(name, length, basis);
+    uint32_t number = 0;
+
+    if (fat32_dir_cache_take_sfn_tail(dir_cluster, basis, &number) == 1 && number <= SFN_TAIL_MAX)
+    {
+        stm_memcpy(sfn, basis, SHORT_NAME_SIZE);
+        fat32_sfn_set_tail(sfn, base_len, number);
+        return 0;
+    }
+
+    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    uint8_t used[SFN_TAIL_BITMAP_BITS / 8] = {0};
+    uint32_t entries_per_sector = fat_info->bytesPerSec / sizeof(FatDir_Type);
+    uint32_t cluster = dir_cluster;
+    uint32_t max_used = 0;
+    uint32_t address = 0;
+    uint32_t sector, idx;
+    int status = 0;
+
+    while (cluster != FILE_END_TABLE_FAT32)
+    {
+        address = (cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
+        for (sector = 0; sector < fat_info->secPerClus; ++sector)
+        {
+            if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+            for (idx = 0; idx < entries_per_sector; ++idx)
+            {
+                FatDir_Type *entry = (FatDir_Type *)&buffer[idx * sizeof(FatDir_Type)];
+                if (entry->DIR_Name[0] == ENTRY_FREE_FULL_FAT32)
+                {
+                    goto done;
+                }
+                if (entry->DIR_Name[0] == ENTRY_FREE_FAT32 || (entry->DIR_Attr & ATTR_LONG_NAME_MASK) == ATTR_LONG_NAME)
+                {
+                    continue;
+                }
+                number = fat32_sfn_tail_number(entry->DIR_Name, basis, base_len);
+                if (number == 0)
+                {
+                    continue;
+                }
+                if (number <= SFN_TAIL_BITMAP_BITS)
+                {
+                    used[(number - 1) / 8] |= 1 << ((number - 1) % 8);
+                }
+                if (number > max_used)
+                {
+                    max_used = number;
+                }
+            }
+        }
+        if (get_next_cluster_fat32(&cluster) != 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+    }
+
+done:
+    for (number = 1; number <= SFN_TAIL_BITMAP_BITS; ++number)
+    {
+        if ((used[(number - 1) / 8] & (1 << ((number - 1) % 8))) == 0)
+        {
+            break;
+        }
+    }
+    if (number > SFN_TAIL_BITMAP_BITS)
+    {
+        number = max_used + 1;
+    }
+    if (number > SFN_TAIL_MAX)
+    {
+        status = FAT32_ERR_NO_FREE_ENTRIES;
+        goto cleanup;
+    }
+
+    stm_memcpy(sfn, basis, SHORT_NAME_SIZE);
+    fat32_sfn_set_tail(sfn, base_len, number);
+    fat32_dir_cache_set_sfn_tail(dir_cluster, basis, (number > max_used ? number : max_used) + 1);
+
+cleanup:
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // Вывод в лог
+    }
+    return status;
+}
+
+/**
+ * @brief Сканирует каталог до маркера конца и запоминает его свободное место в кэше каталогов.
+ *
+ * Последовательности удалённых записей запоминаются как «дыры», а свободные записи
+ * от маркера конца (0x00) до конца цепочки кластеров — как хвост каталога.
+ *
+ * @param dir_cluster Первый кластер каталога.
+ * @return 0 при успехе, иначе код ошибки.
+ */
+static int scan_dir_free_space(uint32_t dir_cluster)
+{
+    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    uint32_t entries_per_sector = fat_info->bytesPerSec / sizeof(FatDir_Type);
+    uint32_t entries_per_cluster = entries_per_sector * fat_info->secPerClus;
+    uint32_t cluster = dir_cluster;
+    uint32_t next_cluster = 0;
+    uint32_t address = 0;
+    uint32_t sector, idx;
+    Fat32DirFreeRun run = {{0, 0, 0}, 0};
+    int status = 0;
+
+    // Начинаем с пустого списка «дыр»: хвост уточняется в конце сканирования
+    fat32_dir_cache_set_tail(dir_cluster, &run, dir_cluster);
+
+    while (1)
+    {
+        address = (cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
+        for (sector = 0; sector < fat_info->secPerClus; ++sector)
+        {
+            if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+            for (idx = 0; idx < entries_per_sector; ++idx)
+            {
+                uint8_t first = buffer[idx * sizeof(FatDir_Type)];
+                if (first == ENTRY_FREE_FULL_FAT32)
+                {
+                    // За маркером конца свободны все записи до конца цепочки
+                    if (run.count == 0)
+                    {
+                        run.position.cluster = cluster;
+                        run.position.sector = sector;
+                        run.position.offset = idx;
+                    }
+                    run.count += entries_per_cluster - (sector * entries_per_sector + idx);
+                    goto tail;
+                }
+                if (first == ENTRY_FREE_FAT32)
+                {
+                    if (run.count++ == 0)
+                    {
+                        run.position.cluster = cluster;
+                        run.position.sector = sector;
+                        run.position.offset = idx;
+                    }
+                    continue;
+                }
+                fat32_dir_cache_add_hole(dir_cluster, &run);
+                run.count = 0;
+            }
+        }
+
+        next_cluster = cluster;
+        if (get_next_cluster_fat32(&next_cluster) != 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+        if (next_cluster == FILE_END_TABLE_FAT32)
+        {
+            // Каталог без маркера конца: хвостом служат удалённые записи в конце цепочки
+            break;
+        }
+        cluster = next_cluster;
+    }
+    goto done;
+
+tail:
+    // Оставшиеся кластеры цепочки после маркера конца целиком свободны
+    while (1)
+    {
+        next_cluster = cluster;
+        if (get_next_cluster_fat32(&next_cluster) != 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+        if (next_cluster == FILE_END_TABLE_FAT32)
+            break;
+        cluster = next_cluster;
+        run.count += entries_per_cluster;
+    }
+
+done:
+    fat32_dir_cache_set_tail(dir_cluster, &run, cluster);
+
+cleanup:
+    if (status != 0)
+    {
+        fat32_dir_cache_invalidate(dir_cluster);
+    }
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // Вывод в лог
+    }
+    return status;
+}
+
+/**
+ * @brief Ищет свободную последовательность записей в каталоге для размещения файла или LFN-записей.
+ *
+ * Нужны подряд идущие `entry_count` свободных записей (32-байтных) для длинного имени
+ * файла (LFN) + основной SFN-записи. Свободное место каталога берётся из кэша каталогов:
+ * сначала подходящая «дыра» от удалённых записей, затем хвост после маркера конца.
+ * Каталог сканируется, только если его свободное место ещё неизвестно. Если хвоста
+ * не хватает — цепочка кластеров расширяется обнулёнными кластерами.
+ *
+ * @param parent_cluster Кластер родительского каталога.
+ * @param entry_count    Количество необходимых подряд идущих записей (обычно 1 + кол-во LFN записей).
+ * @param position       Указатель на структуру, куда будет записано положение свободных записей.
+ *
+ * @return 0 при успехе, либо код ошибки (например, FAT32_ERR_DISK_FULL).
+ */
+int find_free_dir_entries(uint32_t parent_cluster, const uint16_t entry_count, DirEntryPosition *position)
+{
+    if (position == NULL || entry_count == 0)
+        return FAT32_ERR_INVALID_ARGUMENT;
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+
+    Fat32DirFreeRun run;
+    uint32_t last_cluster = 0;
+    int status = fat32_dir_cache_get_tail(parent_cluster, &run, &last_cluster);
+    if (status != 0)
+    {
+        status = scan_dir_free_space(parent_cluster);
+        if (status != 0)
+        {
+            return status;
+        }
+        status = fat32_dir_cache_get_tail(parent_cluster, &run, &last_cluster);
+        if (status != 0)
+        {
+            return status;
+        }
+    }
+
+    Fat32DirFreeRun hole;
+    if (fat32_dir_cache_take_hole(parent_cluster, entry_count, &hole) == 1)
+    {
+        *position = hole.position;
+        if (hole.count > entry_count && dir_position_advance(&hole.position, entry_count) == 0)
+        {
+            hole.count -= entry_count;
+            fat32_dir_cache_add_hole(parent_cluster, &hole);
+        }
+        return 0;
+    }
+
+    // Хвоста не хватает: каталог расширяется новыми обнулёнными кластерами
+    uint32_t entries_per_cluster = fat_info->bytesPerSec / sizeof(FatDir_Type) * fat_info->secPerClus;
+    uint32_t address = 0;
+    while (run.count < entry_count)
+    {
+        uint32_t cluster = last_cluster;
+        status = extend_cluster_chain_if_needed(&cluster);
+        if (status != 0)
+        {
+            status = FAT32_ERR_DISK_FULL;
+            goto cleanup;
+        }
+        address = (cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
+        ++dir_generation;
+        if (fat_info->device->clear(address, fat_info->secPerClus, fat_info->bytesPerSec) < 0)
+        {
+            status = FAT32_ERR_WRITE_FAIL;
+            goto cleanup;
+        }
+        if (run.count == 0)
+        {
+            run.position.cluster = cluster;
+            run.position.sector = 0;
+            run.position.offset = 0;
+        }
+        run.count += entries_per_cluster;
+        last_cluster = cluster;
+    }
+
+    *position = run.position;
+    run.count -= entry_count;
+    if (run.count > 0)
+    {
+        status = dir_position_advance(&run.position, entry_count);
+        if (status != 0)
+        {
+            goto cleanup;
+        }
+    }
+    fat32_dir_cache_set_tail(parent_cluster, &run, last_cluster);
+    return 0;
+
+cleanup:
+    // Цепочка каталога могла измениться частично: свободное место будет пересчитано
+    fat32_dir_cache_invalidate(parent_cluster);
+    return status;
+}
+
+/**
+ * @brief Сдвигает позицию в каталоге на count записей вперёд с переходом по цепочке кластеров.
+ *
+ * @param position Позиция, изменяемая на месте.
+ * @param count    Количество записей.
+ * @return 0 при успехе, FAT32_ERR_READ_FAIL если цепочка каталога закончилась или не читается.
+ */
+static int dir_position_advance(DirEntryPosition *position, uint32_t count)
+{
+    uint32_t entries_per_sector = fat_info->bytesPerSec / sizeof(FatDir_Type);
+    uint32_t index = position->sector * entries_per_sector + position->offset + count;
+    uint32_t entries_per_cluster = entries_per_sector * fat_info->secPerClus;
+
+    while (index >= entries_per_cluster)
+    {
+        if (get_next_cluster_fat32(&position->cluster) != 0 || position->cluster == FILE_END_TABLE_FAT32)
+        {
+            return FAT32_ERR_READ_FAIL;
+        }
+        index -= entries_per_cluster;
+    }
+    position->sector = index / entries_per_sector;
+    position->offset = index % entries_per_sector;
+    return 0;
+}
+
+/**
+ * @brief Читает подряд идущие записи каталога начиная с заданной позиции.
+ *
+ * Записи могут пересекать границы секторов и кластеров каталога; каждый сектор
+ * читается один раз.
+ *
+ * @param position     Позиция первой записи.
+ * @param entries      [out] Буфер на entry_count записей.
+ * @param entry_count  Количество записей.
+ *
+ * @return 0 при успехе, иначе код ошибки.
+ */
+int read_dir_entries_at(const DirEntryPosition *position, void *entries, uint16_t entry_count)
+{
+    if (position == NULL || entries == NULL)
+        return FAT32_ERR_INVALID_ARGUMENT;
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+
+    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    uint8_t *target = (uint8_t *)entries;
+    uint32_t entries_per_sector = fat_info->bytesPerSec / sizeof(FatDir_Type);
+    uint32_t cluster = position->cluster;
+    uint32_t sector = position->sector;
+    uint32_t offset = position->offset;
+    uint32_t entries_read = 0;
+    uint32_t to_copy = 0;
+    uint32_t address = 0;
+    int status = 0;
+
+    while (entries_read < entry_count)
+    {
+        address = (cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region + sector;
+        if (fat_info->device->read(buffer, 1, address, fat_info->bytesPerSec) < 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+
+        to_copy = entries_per_sector - offset;
+        if (to_copy > entry_count - entries_read)
+        {
+            to_copy = entry_count - entries_read;
+        }
+        stm_memcpy(target + entries_read * sizeof(FatDir_Type), buffer + offset * sizeof(FatDir_Type), to_copy * sizeof(FatDir_Type));
+        entries_read += to_copy;
+        offset = 0;
+
+        if (++sector == fat_info->secPerClus && entries_read < entry_count)
+        {
+            sector = 0;
+            if (get_next_cluster_fat32(&cluster) != 0 || cluster == FILE_END_TABLE_FAT32)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+        }
+    }
+cleanup:
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // Вывод в лог
+    }
+    return status;
+}
+
+/**
+ * @brief Записывает записи каталога (LFN + SFN) начиная с заданной позиции.
+ *
+ * Записи могут пересекать границы секторов и кластеров каталога.
+ *
+ * @param position     Позиция в каталоге, куда нужно записывать.
+ * @param entries      Указатель на массив записей (структуры LDIR_Type / FatDir_Type).
+ * @param entry_count  Количество записей для записи.
+ *
+ * @return 0 при успехе, иначе код ошибки.
+ */
+int write_dir_entries_at(const DirEntryPosition *position, const void *entries, uint16_t entry_count)
+{
+    if (position == NULL || entries == NULL)
+        return FAT32_ERR_INVALID_ARGUMENT;
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+
+    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    const uint8_t *source = (const uint8_t *)entries;
+    uint32_t entries_per_sector = fat_info->bytesPerSec / sizeof(LDIR_Type);
+    uint32_t cluster = position->cluster;
+    uint32_t sector = position->sector;
+    uint32_t offset = position->offset;
+    uint32_t entries_written = 0;
+    uint32_t to_copy = 0;
+    uint32_t address = 0;
+    int status = 0;
+
+    while (entries_written < entry_count)
+    {
+        address = (cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region + sector;
+        if (fat_info->device->read(buffer, 1, address, fat_info->bytesPerSec) < 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+
+        to_copy = entries_per_sector - offset;
+        if (to_copy > entry_count - entries_written)
+        {
+            to_copy = entry_count - entries_written;
+        }
+        stm_memcpy(buffer + offset * sizeof(LDIR_Type), source + entries_written * sizeof(LDIR_Type), to_copy * sizeof(LDIR_Type));
+        ++dir_generation;
+        if (fat_info->device->write(buffer, 1, address, fat_info->bytesPerSec) < 0)
+        {
+            status = FAT32_ERR_WRITE_FAIL;
+            goto cleanup;
+        }
+        entries_written += to_copy;
+        offset = 0;
+
+        if (++sector == fat_info->secPerClus && entries_written < entry_count)
+        {
+            sector = 0;
+            if (get_next_cluster_fat32(&cluster) != 0 || cluster == FILE_END_TABLE_FAT32)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+        }
+    }
+cleanup:
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // Вывод в лог
+    }
+    return status;
+}
+
+/**
+ * @brief Создаёт новую директорию в FAT32.
+ *
+ * @param name            Имя директории (LFN или SFN).
+ * @param length          Длина имени.
+ * @param parent_cluster  Кластер родительской директории.
+ * @return 0 при успехе, иначе код ошибки.
+ */
+int create_dir_fat32(char *name, uint32_t length, uint32_t parent_cluster)
+{
+    int status = 0;
+    uint32_t cluster_new_dir = 0;
+
+    int entry_count = 0;
+    FatDir_Type *entries = NULL;
+
+    if (name == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+
+    // выделяем память в таблице для новой директории рядом с родительской
+    cluster_new_dir = parent_cluster;
+    status = allocate_cluster_fat32(&cluster_new_dir);
+    if (status != 0)
+    {
+        return FAT32_ERR_CLUSTER_ALLOC_FAIL;
+    }
+    FatDir_Type *entry = NULL;
+    if (validate_fat_sfn_dir(name) != 0)
+    {
+        entry_count = fat32_utf8_to_utf16le(name, length, NULL, MAX_NAME_SIZE);
+        if (entry_count <= 0)
+        {
+            return FAT32_ERR_INVALID_CHAR;
+        }
+        entry_count = ((entry_count + MAX_SYMBOLS_ENTRY - 1) / MAX_SYMBOLS_ENTRY) + 1;
+
+        entries = fat32_alloc(sizeof(LDIR_Type) * entry_count);
+        if (entries == NULL)
+        {
+            return FAT32_ERR_ALLOC_FAILED;
+        }
+        entry = &entries[entry_count - 1];
+        memset((uint8_t *)entry, 0, sizeof(FatDir_Type));
+
+        split_cluster_number(cluster_new_dir, &entry->DIR_FstClusHI, &entry->DIR_FstClusLO);
+        status = generate_sfn_alias(parent_cluster, name, length, entry->DIR_Name);
+        if (status != 0)
+        {
+            goto cleanup;
+        }
+        uint8_t chksum = fat32_sfn_checksum(entry->DIR_Name);
+        make_lfn_entries(name, length, chksum, (LDIR_Type *)entries, entry_count - 1);
+    }
+    else
+    {
+        entry_count = 1;
+        entries = fat32_alloc(sizeof(FatDir_Type));
+        if (entries == NULL)
+        {
+            return FAT32_ERR_ALLOC_FAILED;
+        }
+        // Ищем и добавляем запись в родительскую директорию
+        entry = &entries[0];
+        memset((uint8_t *)entry, 0, sizeof(FatDir_Type));
+
+        split_cluster_number(cluster_new_dir, &entry->DIR_FstClusHI, &entry->DIR_FstClusLO);
+        fat32_format_sfn(name, length, (char *)entry->DIR_Name);
+    }
+
+    Fat32_DateTime datetime = {0};
+
+    if (fat_info->device->datetime)
+        status = fat_info->device->datetime(&datetime);
+
+    entry->DIR_Attr = ATTR_DIRECTORY;
+    if (status == 0)
+    {
+        fat32_date_to_fat(&datetime.date, &entry->DIR_CrtDate);
+        fat32_time_to_fat(&datetime.time, &entry->DIR_CrtTime);
+        entry->DIR_CrtTimeTenth = 0;
+        entry->DIR_WrtDate = entry->DIR_CrtDate;
+        entry->DIR_WrtTime = entry->DIR_CrtTime;
+        entry->DIR_LstAccDate = entry->DIR_CrtDate;
+    }
+
+    // Поиск свободного места в директории
+    DirEntryPosition position;
+    status = find_free_dir_entries(parent_cluster, entry_count, &position);
+    if (status != 0)
+    {
+        status = FAT32_ERR_NO_FREE_ENTRIES;
+        goto cleanup;
+    }
+    // Записать в корневую директорию
+    status = write_dir_entries_at(&position, entries, entry_count);
+    if (status != 0)
+    {
+        // Хвост каталога в кэше уже сдвинут за незаписанные записи
+        fat32_dir_cache_invalidate(parent_cluster);
+        status = FAT32_ERR_WRITE_FAIL;
+        goto cleanup;
+    }
+    fat32_dir_cache_add(parent_cluster, fat32_name_hash(name, length), &position, entry_count);
+    fat32_dir_cache_invalidate(cluster_new_dir);
+
+    // Кластер новой папки мог принадлежать удалённому файлу: обнуляем его целиком
+    uint32_t address = (cluster_new_dir - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
+    ++dir_generation;
+    if (fat_info->device->clear(address, fat_info->secPerClus, fat_info->bytesPerSec) < 0)
+    {
+        status = FAT32_ERR_WRITE_FAIL;
+        goto cleanup;
+    }
+
+    // Создаем entries для новой папки: "." и ".." (для корневого родителя — кластер 0)
+    FatDir_Type dir_entries[2];
+    memset((uint8_t *)dir_entries, 0, sizeof(FatDir_Type) * 2);
+
+    dir_entries[0].DIR_Attr = dir_entries[1].DIR_Attr = ATTR_DIRECTORY;
+    dir_entries[0].DIR_FileSize = dir_entries[1].DIR_FileSize = 0;
+
+    memset(dir_entries[0].DIR_Name, ' ', sizeof(dir_entries[0].DIR_Name));
+    memset(dir_entries[1].DIR_Name, ' ', sizeof(dir_entries[0].DIR_Name));
+    stm_memcpy(dir_entries[0].DIR_Name, (uint8_t *)".", 1);
+    stm_memcpy(dir_entries[1].DIR_Name, (uint8_t *)"..", 2);
+
+    split_cluster_number(cluster_new_dir, &dir_entries[0].DIR_FstClusHI, &dir_entries[0].DIR_FstClusLO);
+    split_cluster_number(parent_cluster == fat_info->root_cluster ? 0 : parent_cluster,
+                         &dir_entries[1].DIR_FstClusHI, &dir_entries[1].DIR_FstClusLO);
+
+    position.cluster = cluster_new_dir;
+    position.offset = 0;
+    position.sector = 0;
+
+    status = write_dir_entries_at(&position, dir_entries, 2);
+    if (status != 0)
+    {
+        status = FAT32_ERR_WRITE_FAIL;
+        goto cleanup;
+    }
+
+cleanup:
+    if (fat32_free(entries, sizeof(LDIR_Type) * entry_count) != 0)
+    {
+        // Вывод в лог
+    }
+
+    return status;
+}
+
+/**
+ * Освобождает цепочку кластеров, проходя FAT по секторам.
+ *
+ * Записи цепочки обнуляются в буфере сектора FAT1; сектор записывается в обе копии
+ * FAT только при переходе цепочки в другой сектор. Для последовательно выделенной
+ * цепочки каждый сектор FAT читается один раз и записывается один раз в каждую копию,
+ * вместо чтения и двух записей на каждый кластер. Вторая копия получает содержимое
+ * сектора первой: копии FAT зеркальны.
+ *
+ * Цепочка считается законченной на любом значении вне диапазона кластеров данных
+ * (конец цепочки, свободная или повреждённая запись).
+ *
+ * @param cluster       [in] Первый кластер цепочки;
+ *                      [out] первый ещё не освобождённый кластер или FILE_END_TABLE_FAT32.
+ * @param sector_budget [in, out] Сколько секторов FAT можно записать (NULL — без ограничения);
+ *                      уменьшается на число записанных секторов.
+ * @param released      [out] Количество освобождённых кластеров (может быть NULL).
+ * @return 0 при успехе,
+ *         FAT32_ERR_ALLOC_FAILED — не удалось выделить буфер,
+ *         FAT32_ERR_READ_FAIL — ошибка чтения FAT,
+ *         FAT32_ERR_WRITE_FAIL — ошибка записи FAT,
+ *         FAT32_ERR_INVALID_CLUSTER_CHAIN — цепочка зациклена.
+ */
+static int release_cluster_chain(uint32_t *cluster, uint32_t *sector_budget, uint32_t *released)
+{
+    uint32_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    int status = 0;
+    uint32_t count = 0;
+    uint32_t freed_in_sector = 0;
+    uint32_t current = *cluster;
+    uint32_t loaded = current / fat_info->fat_ents_sec;
+    if (fat_info->device->read((uint8_t *)buffer, 1, fat_info->address_tabl1 + loaded, fat_info->bytesPerSec) < 0)
+    {
+        status = FAT32_ERR_READ_FAIL;
+        goto cleanup;
+    }
+
+    while (1)
+    {
+        uint32_t idx_entry = current % fat_info->fat_ents_sec;
+        uint32_t next_cluster = buffer[idx_entry] & FAT32_ENTRY_MASK;
+        if ((buffer[idx_entry] & FAT32_ENTRY_MASK) != FREE_CLUSTER)
+        {
+            ++freed_in_sector;
+        }
+        buffer[idx_entry] = FREE_CLUSTER;
+        ++count;
+
+        int chain_end = (next_cluster < 2 || next_cluster >= fat_info->cluster_count);
+        if (!chain_end && count >= fat_info->cluster_count)
+        {
+            status = FAT32_ERR_INVALID_CLUSTER_CHAIN;
+            chain_end = 1;
+        }
+        uint32_t sector = next_cluster / fat_info->fat_ents_sec;
+        if (chain_end || sector != loaded)
+        {
+            if (fat_info->device->write((uint8_t *)buffer, 1, fat_info->address_tabl1 + loaded, fat_info->bytesPerSec) < 0 ||
+                fat_info->device->write((uint8_t *)buffer, 1, fat_info->address_tabl2 + loaded, fat_info->bytesPerSec) < 0)
+            {
+                status = FAT32_ERR_WRITE_FAIL;
+                goto cleanup;
+            }
+            // Счётчик свободных кластеров меняется только после записи сектора, иначе повтор
+            // после ошибки учёл бы те же кластеры дважды
+            if (fat_info->free_count != FAT32_FREE_COUNT_UNKNOWN)
+            {
+                fat_info->free_count += freed_in_sector;
+            }
+            freed_in_sector = 0;
+            // Освобождённая часть записана: продолжение начинается со следующего кластера
+            *cluster = chain_end ? FILE_END_TABLE_FAT32 : next_cluster;
+            if (sector_budget != NULL)
+            {
+                --*sector_budget;
+            }
+            if (chain_end || (sector_budget != NULL && *sector_budget == 0))
+            {
+                break;
+            }
+            if (fat_info->device->read((uint8_t *)buffer, 1, fat_info->address_tabl1 + sector, fat_info->bytesPerSec) < 0)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+            loaded = sector;
+        }
+        current = next_cluster;
+    }
+
+cleanup:
+    if (released != NULL)
+    {
+        *released = count;
+    }
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // вывод в лог
+    }
+    return status;
+}
+
+/**
+ * Ставит цепочку в очередь отложенного освобождения (см. fat32_set_deferred_free).
+ *
+ * Если отложенное освобождение выключено или очередь заполнена, цепочка
+ * освобождается сразу.
+ *
+ * @param cluster Первый кластер цепочки.
+ * @return 0 при успехе, коды ошибок delete_entry_fat32.
+ */
+static int queue_chain_release(uint32_t cluster)
+{
+    if (cluster < 2 || cluster >= fat_info->cluster_count)
+    {
+        return FAT32_ERR_INVALID_CLUSTER;
+    }
+    if (!deferred_free_enabled || deferred_count >= FAT32_DEFERRED_FREE_SLOTS)
+    {
+        return release_cluster_chain(&cluster, NULL, NULL);
+    }
+    deferred_chains[deferred_count++] = cluster;
+    return 0;
+}
+
+int fat32_set_deferred_free(int enable)
+{
+    deferred_free_enabled = (enable != 0);
+    if (!enable && deferred_count > 0)
+    {
+        int status = fat32_free_step(0);
+        return (status > 0) ? 0 : status;
+    }
+    return 0;
+}
+
+int fat32_free_step(uint32_t max_sectors)
+{
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+
+    uint32_t budget = max_sectors;
+    while (deferred_count > 0)
+    {
+        int status = release_cluster_chain(&deferred_chains[0], (max_sectors == 0) ? NULL : &budget, NULL);
+        if (status == FAT32_ERR_READ_FAIL || status == FAT32_ERR_WRITE_FAIL || status == FAT32_ERR_ALLOC_FAILED)
+        {
+            // Цепочка остаётся в очереди: следующий шаг повторит попытку
+            return status;
+        }
+        if (status == 0 && deferred_chains[0] != FILE_END_TABLE_FAT32)
+        {
+            break;
+        }
+        // Цепочка освобождена (или повреждена и дальше не читается): слот освобождается
+        --deferred_count;
+        memmove(&deferred_chains[0], &deferred_chains[1], deferred_count * sizeof(deferred_chains[0]));
+        if (max_sectors != 0 && budget == 0)
+        {
+            break;
+        }
+    }
+    return (int)deferred_count;
+}
+
+/**
+ * @brief Удаляет цепочку кластеров, связанных с файлом или директорией в FAT32.
+ *
+ * Освобождает все кластеры, начиная с переданного `cluster_file`. Записи FAT
+ * обнуляются посекторно в памяти, каждый изменённый сектор записывается в обе копии
+ * FAT один раз (см. release_cluster_chain), поэтому удаление большого файла занимает
+ * порядка sizeFAT операций ввода-вывода, а не нескольких на каждый кластер.
+ *
+ * @param cluster_file Начальный кластер файла или директории, которую требуется удалить.
+ * @return int Код ошибки или 0 при успешном завершении:
+ *  - FAT32_ERR_FS_NOT_LOADED — если файловая система не инициализирована.
+ *  - FAT32_ERR_INVALID_CLUSTER — если передан некорректный номер кластера.
+ *  - FAT32_ERR_ALLOC_FAILED — если не удалось выделить буфер сектора.
+ *  - FAT32_ERR_READ_FAIL — если не удалось прочитать FAT.
+ *  - FAT32_ERR_WRITE_FAIL — если не удалось обновить FAT.
+ *  - FAT32_ERR_INVALID_CLUSTER_CHAIN — если цепочка повреждена (бесконечный цикл).
+ */
+int delete_entry_fat32(uint32_t cluster_file)
+{
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    if (cluster_file < 2 || cluster_file >= fat_info->cluster_count)
+    {
+        return FAT32_ERR_INVALID_CLUSTER;
+    }
+    return release_cluster_chain(&cluster_file, NULL, NULL);
+}
+
+/**
+ * @brief Рекурсивно удаляет директорию и всё её содержимое (файлы и поддиректории) в FAT32.
+ *
+ * @param cluster Кластер директории, которую необходимо удалить.
+ * @return int 0 при успехе, либо отрицательный код ошибки:
+ *  - FAT32_ERR_FS_NOT_LOADED — если файловая система не инициализирована.
+ *  - FAT32_ERR_ALLOC_FAILED — ошибка при выделении буфера.
+ *  - FAT32_ERR_READ_FAIL — ошибка чтения сектора.
+ *  - FAT32_ERR_WRITE_FAIL — ошибка записи сектора.
+ *  - FAT32_ERR_DELETE_PROTECTED — попытка удалить системный файл.
+ */
+int delete_dir_recursive_fat32(uint32_t cluster)
+{
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    fat32_dir_cache_invalidate(cluster);
+
+    FatDir_Type *entry_child;
+
+    uint32_t cluster_child;
+
+    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    uint32_t sector = 0;
+    uint32_t address = 0;
+    uint32_t idx = 0;
+    int status = 0;
+
+    while (1)
+    {
+        address = fat_info->address_region + (cluster - fat_info->root_cluster) * fat_info->secPerClus;
+
+        for (sector = 0; sector < fat_info->secPerClus; ++sector)
+        {
+            if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+            for (idx = 0; idx < fat_info->bytesPerSec; idx += sizeof(FatDir_Type))
+            {
+                entry_child = (FatDir_Type *)&buffer[idx];
+                if (entry_child->DIR_Name[0] == ENTRY_FREE_FULL_FAT32)
+                {
+                    status = 1;
+                    break;
+                }
+                else if (entry_child->DIR_Name[0] == ENTRY_FREE_FAT32)
+                {
+                    continue;
+                }
+                if ((entry_child->DIR_Attr & ATTR_LONG_NAME_MASK) != ATTR_LONG_NAME)
+                {
+                    join_cluster_number(&cluster_child, entry_child->DIR_FstClusHI, entry_child->DIR_FstClusLO);
+
+                    // "." и ".." ссылаются на саму папку и родителя
+                    if (fat32_is_special_dir(entry_child->DIR_Name) == 0)
+                    {
+                        continue;
+                    }
+
+                    if (entry_child->DIR_Attr & ATTR_DIRECTORY)
+                    {
+                        status = delete_dir_recursive_fat32(cluster_child);
+                        if (status != 0)
+                        {
+                            goto cleanup;
+                        };
+                    }
+                    else if (entry_child->DIR_Attr == ATTR_SYSTEM)
+                    {
+                        status = FAT32_ERR_DELETE_PROTECTED;
+                        goto cleanup;
+                    }
+                    status = delete_entry_fat32(cluster_child);
+                    if (status != 0)
+                    {
+                        goto cleanup;
+                    };
+                }
+                entry_child->DIR_Name[0] = ENTRY_FREE_FAT32;
+            }
+            ++dir_generation;
+            if (fat_info->device->write(buffer, 1, address + sector, fat_info->bytesPerSec) != 0)
+            {
+                status = FAT32_ERR_WRITE_FAIL;
+                goto cleanup;
+            }
+            if (status == 1)
+            {
+                status = 0;
+                goto cleanup;
+            }
+        }
+        if (get_next_cluster_fat32(&cluster) != 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+        if (cluster == FILE_END_TABLE_FAT32)
+        {
+            break;
+        }
+    }
+
+cleanup:
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // Вывод в лог
+    }
+    return status;
+}
+
+/**
+ * @brief Проверяет, пустая ли директория (не содержит файлов и папок, кроме "." и "..").
+ *
+ * @param cluster Кластер директории для проверки.
+ * @return int
+ *   0 — директория пустая,
+ *   FAT32_ERR_DIR_NOT_EMPTY — содержит записи,
+ *   <0 — код ошибки.
+ */
+int is_dir_empty_fat32(uint32_t cluster)
+{
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    int sector = 0;
+    uint32_t address = 0;
+    uint32_t idx = 2 * sizeof(FatDir_Type); // // Пропускаем первые две записи "." и ".."
+    int status = 0;
+    while (cluster != FILE_END_TABLE_FAT32)
+    {
+        address = fat_info->address_region + (cluster - fat_info->root_cluster) * fat_info->secPerClus;
+        for (sector = 0; sector < fat_info->secPerClus; ++sector)
+        {
+            if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) < 0)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+            for (; idx < fat_info->bytesPerSec; idx += sizeof(FatDir_Type))
+            {
+                if (buffer[idx] == ENTRY_FREE_FULL_FAT32)
+                {
+                    status = 0;
+                    goto cleanup;
+                }
+                if (buffer[idx] == ENTRY_FREE_FAT32)
+                {
+                    continue;
+                }
+                else
+                {
+                    status = FAT32_ERR_DIR_NOT_EMPTY;
+                    goto cleanup;
+                }
+            }
+            idx = 0;
+        }
+        status = get_next_cluster_fat32(&cluster);
+        if (status != 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+    }
+cleanup:
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // Вывод в лог
+    }
+    return status;
+}
+
+/**
+ * @brief Получить атрибут (DIR_Attr) записи в каталоге по её кластеру
+ *
+ * Функция ищет в родительском каталоге (`cluster_parent`) запись, которая
+ * указывает на `child_cluster`, и возвращает её атрибуты (`DIR_Attr`).
+ *
+ * @param cluster_parent Кластер родительского каталога
+ * @param child_cluster Кластер дочернего элемента (файла/каталога)
+ * @param attr [out] Указатель на переменную, в которую будет записан атрибут
+ * @return int Код возврата:
+ *         0 — успех,
+ *         < 0 — код ошибки (например, FAT32_ERR_FS_NOT_LOADED, FAT32_ERR_READ_FAIL, FAT32_ERR_ENTRY_NOT_FOUND)
+ */
+int get_attr_entry_fat32(uint32_t cluster_parent, uint32_t child_cluster, uint8_t *attr)
+{
+    if (attr == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+    int sector = 0;
+    uint32_t address = 0;
+    uint32_t idx = 0;
+    int status = 0;
+    uint32_t cluster = 0;
+    FatDir_Type *entry = NULL;
+
+    while (1)
+    {
+        address = fat_info->address_region + (cluster_parent - fat_info->root_cluster) * fat_info->secPerClus;
+        for (sector = 0; sector < fat_info->secPerClus; ++sector)
+        {
+            if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) != 0)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+            for (idx = 0; idx < fat_info->bytesPerSec; idx += sizeof(FatDir_Type))
+            {
+                if (buffer[idx] == ENTRY_FREE_FULL_FAT32)
+                {
+                    status = 0;
+                    goto cleanup;
+                }
+                if (buffer[idx] == ENTRY_FREE_FAT32)
+                {
+                    continue;
+                }
+                entry = (FatDir_Type *)&buffer[idx];
+                join_cluster_number(&cluster, entry->DIR_FstClusHI, entry->DIR_FstClusLO);
+                if (cluster == child_cluster)
+                {
+                    *attr = entry->DIR_Attr;
+                    status = 0;
+                    goto cleanup;
+                }
+            }
+        }
+        status = get_next_cluster_fat32(&cluster);
+        if (status != 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+        if (cluster == FILE_END_TABLE_FAT32)
+        {
+            status = FAT32_ERR_ENTRY_NOT_FOUND;
+            goto cleanup;
+        }
+    }
+
+cleanup:
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    {
+        // вывести в лог
+    }
+    return status;
+}
+
+/**
+ * @brief Помечает запись каталога (и связанные с ней LFN-записи) как удалённые
+ *
+ * Группа записей известна из результата разрешения пути, поэтому повторный поиск
+ * по имени не выполняется: помечаются entry_count записей подряд, начиная с
+ * lfn_position, в том числе если группа пересекает границу сектора или кластера.
+ *
+ * @param ref Найденная запись (LFN-группа и SFN-запись)
+ * @return int Код возврата:
+ *         0 — успешно,
+ *         < 0 — код ошибки (FAT32_ERR_READ_FAIL, FAT32_ERR_WRITE_FAIL и т.д.)
+ */
+int mark_dir_entry_deleted(const DirEntryRef *ref)
+{
+    if (ref == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    FatDir_Type *entries = fat32_alloc(fat_info->bytesPerSec);
+    if (entries == NULL)
+    {
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+
+    uint32_t entries_per_sector = fat_info->bytesPerSec / sizeof(FatDir_Type);
+    uint32_t cluster = ref->lfn_position.cluster;
+    uint32_t sector = ref->lfn_position.sector;
+    uint32_t idx = ref->lfn_position.offset;
+    uint32_t remaining = ref->entry_count;
+    uint32_t address = 0;
+    int status = 0;
+
+    while (remaining > 0)
+    {
+        address = fat_info->address_region + (cluster - fat_info->root_cluster) * fat_info->secPerClus + sector;
+        if (fat_info->device->read((uint8_t *)entries, 1, address, fat_info->bytesPerSec) != 0)
+        {
+            status = FAT32_ERR_READ_FAIL;
+            goto cleanup;
+        }
+        for (; idx < entries_per_sector && remaining > 0; ++idx, --remaining)
+        {
+            entries[idx].DIR_Name[0] = ENTRY_FREE_FAT32;
+        }
+        ++dir_generation;
+        if (fat_info->device->write((uint8_t *)entries, 1, address, fat_info->bytesPerSec) != 0)
+        {
+            status = FAT32_ERR_WRITE_FAIL;
+            goto cleanup;
+        }
+        idx = 0;
+        if (++sector == fat_info->secPerClus && remaining > 0)
+        {
+            sector = 0;
+            if (get_next_cluster_fat32(&cluster) != 0 || cluster == FILE_END_TABLE_FAT32)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+        }
+    }
+cleanup:
+    // После частичной записи индекс каталога может не соответствовать носителю
+    if (status == 0)
+    {
+        Fat32DirFreeRun hole = {ref->lfn_position, ref->entry_count};
+        fat32_dir_cache_remove(ref->parent_cluster, &ref->lfn_position);
+        fat32_dir_cache_add_hole(ref->parent_cluster, &hole);
+    }
+    else
+        fat32_dir_cache_invalidate(ref->parent_cluster);
+
+    if (fat32_free(entries, fat_info->bytesPerSec) != 0)
+    {
+        // Вывести в лог
+    }
+    return status;
+}
+
+/**
+ * @brief Удаление обычного файла по указанному пути
+ *
+ * Функция удаляет файл в файловой системе FAT32:
+ * 1. Проверяет путь и наличие FS.
+ * 2. Находит кластер файла и его родительский каталог.
+ * 3. Проверяет, что объект не является системным файлом или директорией.
+ * 4. Удаляет запись в каталоге.
+ * 5. Освобождает все кластеры, занятые файлом.
+ *
+ * @param path Абсолютный путь до файла (например, "/dir1/file.txt")
+ * @return int Код возврата:
+ *         0 — успех,
+ *         < 0 — код ошибки (например, FAT32_ERR_*)
+ */
+int delete_file_fat32(char *path)
+{
+    if (path == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+
+    int status = validate_path(path);
+    if (status != 0)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+    return delete_file_in_dir(fat_info->root_cluster, path);
+}
+
+int delete_file_at_fat32(FAT32_Dir *dir, const char *name)
+{
+    if (dir == NULL || name == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+
+    if (validate_relative_path(name) != 0)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+    return delete_file_in_dir(dir->first_cluster, name);
+}
+
+/**
+ * @brief Удаляет файл по пути относительно каталога base_cluster.
+ *
+ * Путь должен быть предварительно проверен вызывающей функцией.
+ */
+static int delete_file_in_dir(uint32_t base_cluster, const char *path)
+{
+    DirEntryRef ref;
+    int status = resolve_entry_fat32(base_cluster, path, &ref);
+    if (status != 0)
+    {
+        return FAT32_ERR_ENTRY_NOT_FOUND;
+    }
+
+    // проверка что это директория
+    uint8_t attr = ref.entry.DIR_Attr;
+    if (attr == ATTR_SYSTEM)
+    {
+        return FAT32_ERR_ENTRY_NOT_FOUND;
+    }
+    if (attr & ATTR_DIRECTORY)
+    {
+        return FAT32_ERR_IS_DIRECTORY;
+    }
+
+    uint32_t file_cluster = 0;
+    join_cluster_number(&file_cluster, ref.entry.DIR_FstClusHI, ref.entry.DIR_FstClusLO);
+
+    status = mark_dir_entry_deleted(&ref);
+    if (status != 0)
+    {
+        return FAT32_ERR_WRITE_FAIL;
+    }
+
+    status = queue_chain_release(file_cluster);
+    if (status != 0)
+    {
+        return FAT32_ERR_WRITE_FAIL;
+    }
+    return 0;
+}
+
+/**
+ * @brief Удаление директории по указанному пути
+ *
+ * В зависимости от режима удаления:
+ * - В режиме DELETE_DIR_SAFE директория удаляется только если пуста.
+ * - В режиме DELETE_DIR_RECURSIVE производится рекурсивное удаление всех вложенных файлов и поддиректорий.
+ *
+ * @param path Абсолютный путь до директории (например, "/dir1/subdir")
+ * @param mode Режим удаления:
+ *             DELETE_DIR_SAFE — только если пуста;
+ *             DELETE_DIR_RECURSIVE — рекурсивное удаление содержимого.
+ * @return int Код возврата:
+ *         0 — успех,
+ *         < 0 — ошибка (например, FAT32_ERR_*)
+ */
+int delete_dir_fat32(char *path, DeleteDirMode mode)
+{
+    if (path == NULL)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+
+    int status = validate_path(path);
+    if (status != 0)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+    return delete_dir_in_dir(fat_info->root_cluster, path, mode);
+}
+
+int delete_dir_at_fat32(FAT32_Dir *dir, const char *name, DeleteDirMode mode)
+{
+    if (dir == NULL || name == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+
+    if (validate_relative_path(name) != 0)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+    return delete_dir_in_dir(dir->first_cluster, name, mode);
+}
+
+/**
+ * @brief Удаляет каталог по пути относительно каталога base_cluster.
+ *
+ * Путь должен быть предварительно проверен вызывающей функцией.
+ */
+static int delete_dir_in_dir(uint32_t base_cluster, const char *path, DeleteDirMode mode)
+{
+    DirEntryRef ref;
+    int status = resolve_entry_fat32(base_cluster, path, &ref);
+    if (status != 0)
+    {
+        return FAT32_ERR_ENTRY_NOT_FOUND;
+    }
+
+    // проверка что это директория
+    if ((ref.entry.DIR_Attr & ATTR_DIRECTORY) == 0)
+    {
+        return FAT32_ERR_NOT_A_DIRECTORY;
+    }
+
+    uint32_t dir_cluster = 0;
+    join_cluster_number(&dir_cluster, ref.entry.DIR_FstClusHI, ref.entry.DIR_FstClusLO);
+
+    if (mode == DELETE_DIR_SAFE)
+    {
+        if (is_dir_empty_fat32(dir_cluster) != 0)
+        {
+            return FAT32_ERR_DIR_NOT_EMPTY;
+        }
+    }
+    else
+    {
+        status = delete_dir_recursive_fat32(dir_cluster);
+        if (status != 0)
+        {
+            return FAT32_ERR_DELETE_FAIL;
+        }
+    }
+
+    status = mark_dir_entry_deleted(&ref);
+    if (status != 0)
+    {
+        return FAT32_ERR_WRITE_FAIL;
+    }
+
+    fat32_dir_cache_invalidate(dir_cluster);
+    status = delete_entry_fat32(dir_cluster);
+    if (status != 0)
+    {
+        return FAT32_ERR_WRITE_FAIL;
+    }
+    return 0;
+}
+
+/**
+ * Проверяет, что каталог dir_cluster не лежит внутри каталога ancestor (и не совпадает с ним).
+ *
+ * Поднимается от dir_cluster к корню по записям "..".
+ *
+ * @return 0 — не лежит, FAT32_ERR_INVALID_PATH — лежит, иначе код ошибки чтения.
+ */
+static int check_not_inside(uint32_t dir_cluster, uint32_t ancestor)
+{
+    DirEntryPosition position = {0};
+    FatDir_Type entry;
+    for (uint32_t depth = 0; depth < fat_info->cluster_count; ++depth)
+    {
+        if (dir_cluster == ancestor)
+        {
+            return FAT32_ERR_INVALID_PATH;
+        }
+        if (dir_cluster == fat_info->root_cluster)
+        {
+            return 0;
+        }
+        position.cluster = dir_cluster;
+        position.sector = 0;
+        position.offset = 1;
+        if (read_dir_entries_at(&position, &entry, 1) != 0)
+        {
+            return FAT32_ERR_READ_FAIL;
+        }
+        join_cluster_number(&dir_cluster, entry.DIR_FstClusHI, entry.DIR_FstClusLO);
+        if (dir_cluster == 0)
+        {
+            dir_cluster = fat_info->root_cluster;
+        }
+    }
+    return FAT32_ERR_INVALID_CLUSTER_CHAIN;
+}
+
+int fat32_rename(const char *old_path, const char *new_path)
+{
+    if (old_path == NULL || new_path == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info == NULL)
+    {
+        return FAT32_ERR_FS_NOT_LOADED;
+    }
+    if (validate_path(old_path) != 0 || validate_path(new_path) != 0)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+
+    DirEntryRef old_ref;
+    int status = resolve_entry_fat32(fat_info->root_cluster, old_path, &old_ref);
+    if (status != 0 || old_ref.entry.DIR_Attr == ATTR_SYSTEM)
+    {
+        return FAT32_ERR_ENTRY_NOT_FOUND;
+    }
+    int is_dir = (old_ref.entry.DIR_Attr & ATTR_DIRECTORY) != 0;
+    uint32_t object_cluster = 0;
+    join_cluster_number(&object_cluster, old_ref.entry.DIR_FstClusHI, old_ref.entry.DIR_FstClusLO);
+
+    uint32_t new_parent = 0;
+    const char *name = NULL;
+    uint32_t length = 0;
+    status = resolve_parent_fat32(fat_info->root_cluster, new_path, &new_parent, &name, &length);
+    if (status == FAT32_ERR_INVALID_PATH || length >= MAX_NAME_SIZE)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+    if (status != 0)
+    {
+        return FAT32_ERR_DIR_NOT_FOUND;
+    }
+
+    char new_name[MAX_NAME_SIZE];
+    memcpy(new_name, name, length);
+    new_name[length] = '\0';
+    status = is_dir ? validate_fat_lfn_dir(new_name) : validate_fat_lfn_file(new_name);
+    if (status != 0)
+    {
+        return FAT32_ERR_INVALID_CHAR;
+    }
+
+    // Занятое имя допускается только у самого объекта (смена регистра)
+    DirEntryRef existing;
+    status = find_dir_entry(new_name, length, new_parent, &existing);
+    if (status == 0 && (existing.parent_cluster != old_ref.parent_cluster ||
+                        !same_entry_position(&existing.lfn_position, &old_ref.lfn_position)))
+    {
+        return FAT32_ERR_ENTRY_EXISTS;
+    }
+    if (status != 0 && status != FAT32_ERR_ENTRY_NOT_FOUND)
+    {
+        return status;
+    }
+
+    // Каталог нельзя перенести внутрь самого себя
+    if (is_dir && new_parent != old_ref.parent_cluster)
+    {
+        status = check_not_inside(new_parent, object_cluster);
         if (status != 0)
         {
-            status = FAT32_ERR_READ_FAIL;
-            goto cleanup;
+            return status;
         }
     }
-cleanup:
-    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+
+    // Новая группа записей — копия SFN-записи с новым именем; данные не перемещаются
+    FatDir_Type *entries = NULL;
+    int entry_count = 0;
+    status = build_entry_group(new_parent, new_name, length, is_dir, &old_ref.entry, &entries, &entry_count);
+    if (status != 0)
     {
-        // Вывод в лог
+        return status;
     }
-    return status;
-}
 
-/**
- * @brief Получить атрибут (DIR_Attr) записи в каталоге по её кластеру
- *
- * Функция ищет в родительском каталоге (`cluster_parent`) запись, которая
- * указывает на `child_cluster`, и возвращает её атрибуты (`DIR_Attr`).
- *
- * @param cluster_parent Кластер родительского каталога
- * @param child_cluster Кластер дочернего элемента (файла/каталога)
- * @param attr [out] Указатель на переменную, в которую будет записан атрибут
- * @return int Код возврата:
- *         0 — успех,
- *         < 0 — код ошибки (например, FAT32_ERR_FS_NOT_LOADED, FAT32_ERR_READ_FAIL, FAT32_ERR_ENTRY_NOT_FOUND)
- */
-int get_attr_entry_fat32(uint32_t cluster_parent, uint32_t child_cluster, uint8_t *attr)
-{
-    if (attr == NULL)
+    // Сначала записывается новая группа, затем удаляется старая: при сбое между ними
+    // объект доступен под обоими именами, но не теряется
+    DirEntryPosition position;
+    status = find_free_dir_entries(new_parent, entry_count, &position);
+    if (status != 0)
     {
-        return FAT32_ERR_INVALID_ARGUMENT;
+        status = FAT32_ERR_NO_FREE_ENTRIES;
+        goto cleanup;
     }
-    if (fat_info == NULL)
+    status = write_dir_entries_at(&position, entries, entry_count);
+    if (status != 0)
     {
-        return FAT32_ERR_FS_NOT_LOADED;
+        // Кэш считает занятыми записи, которые не были записаны
+        fat32_dir_cache_invalidate(new_parent);
+        status = FAT32_ERR_WRITE_FAIL;
+        goto cleanup;
     }
-    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
-    if (buffer == NULL)
+    fat32_dir_cache_add(new_parent, fat32_name_hash(new_name, length), &position, entry_count);
+
+    status = mark_dir_entry_deleted(&old_ref);
+    if (status != 0)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        goto cleanup;
     }
-    int sector = 0;
-    uint32_t address = 0;
-    uint32_t idx = 0;
-    int status = 0;
-    uint32_t cluster = 0;
-    FatDir_Type *entry = NULL;
 
-    while (1)
+    // Перенесённый каталог ссылается на нового родителя (корень — кластер 0)
+    if (is_dir && new_parent != old_ref.parent_cluster)
     {
-        address = fat_info->address_region + (cluster_parent - fat_info->root_cluster) * fat_info->secPerClus;
-        for (sector = 0; sector < fat_info->secPerClus; ++sector)
+        FatDir_Type dotdot;
+        position.cluster = object_cluster;
+        position.sector = 0;
+        position.offset = 1;
+        status = read_dir_entries_at(&position, &dotdot, 1);
+        if (status == 0)
         {
-            if (fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec) != 0)
-            {
-                status = FAT32_ERR_READ_FAIL;
-                goto cleanup;
-            }
-            for (idx = 0; idx < fat_info->bytesPerSec; idx += sizeof(FatDir_Type))
-            {
-                if (buffer[idx] == ENTRY_FREE_FULL_FAT32)
-                {
-                    status = 0;
-                    goto cleanup;
-                }
-                if (buffer[idx] == ENTRY_FREE_FAT32)
-                {
-                    continue;
-                }
-                entry = (FatDir_Type *)&buffer[idx];
-                join_cluster_number(&cluster, entry->DIR_FstClusHI, entry->DIR_FstClusLO);
-                if (cluster == child_cluster)
-                {
-                    *attr = entry->DIR_Attr;
-                    status = 0;
-                    goto cleanup;
-                }
-            }
+            split_cluster_number(new_parent == fat_info->root_cluster ? 0 : new_parent,
+                                 &dotdot.DIR_FstClusHI, &dotdot.DIR_FstClusLO);
+            status = write_dir_entries_at(&position, &dotdot, 1);
         }
-        status = get_next_cluster_fat32(&cluster);
         if (status != 0)
         {
-            status = FAT32_ERR_READ_FAIL;
-            goto cleanup;
-        }
-        if (cluster == FILE_END_TABLE_FAT32)
-        {
-            status = FAT32_ERR_ENTRY_NOT_FOUND;
-            goto cleanup;
+            status = FAT32_ERR_WRITE_FAIL;
         }
     }
 
 cleanup:
-    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+    if (fat32_free(entries, sizeof(LDIR_Type) * entry_count) != 0)
     {
-        // вывести в лог
+        // вывод в лог
     }
     return status;
 }
 
 /**
- * @brief Помечает запись каталога (и связанные с ней LFN-записи) как удалённые
+ * Дописывает данные src в конец открытого на дозапись dst посекторным копированием.
  *
- * Функция ищет запись с указанным именем в родительском кластере,
- * а затем помечает как удалёнными все связанные с ней LFN-записи и саму SFN-запись.
- * Удаление производится в обратном порядке — от SFN к началу цепочки LFN.
- *
- * @param parent_cluster Кластер родительского каталога
- * @param name Имя файла/каталога, который нужно удалить
- * @return int Код возврата:
- *         0 — успешно,
- *         < 0 — код ошибки (FAT32_ERR_ENTRY_NOT_FOUND, FAT32_ERR_READ_FAIL, FAT32_ERR_WRITE_FAIL и т.д.)
+ * Первая порция дополняет последний сектор dst, дальнейшие записи выровнены по секторам.
  */
-int mark_dir_entry_deleted(uint32_t parent_cluster, char *name)
+static int append_file_copy(FAT32_File *dst, FAT32_File *src)
 {
-    FatDir_Type *entries = fat32_alloc(fat_info->bytesPerSec / sizeof(FatDir_Type));
-    if (entries == NULL)
+    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
+    if (buffer == NULL)
     {
         return FAT32_ERR_ALLOC_FAILED;
     }
-    DirEntryPosition pos = {0};
-    int status = 0;
-    status = find_entry_by_name(name, parent_cluster, &pos);
-    if (status != 0)
-    {
-        status = FAT32_ERR_ENTRY_NOT_FOUND;
-        goto cleanup;
-    }
-    uint32_t address = fat_info->address_region + (pos.cluster - fat_info->root_cluster) * fat_info->secPerClus;
-
-    uint32_t sector = pos.sector;
-    int idx = pos.offset;
-    FatDir_Type *entry = NULL;
-    uint8_t found_sfn = 0;
 
-    for (; sector >= 0; --sector)
+    int status = 0;
+    uint32_t remaining = src->size_bytes;
+    uint32_t chunk = fat_info->bytesPerSec - dst->size_bytes % fat_info->bytesPerSec;
+    while (remaining > 0)
     {
-        if (fat_info->device->read((uint8_t *)entries, 1, address + sector, fat_info->bytesPerSec) != 0)
-        {
-            status = FAT32_ERR_READ_FAIL;
-            goto cleanup;
-        }
-        for (; idx >= 0; --idx)
+        if (chunk > remaining)
         {
-            entry = &entries[idx];
-            if ((entry->DIR_Attr & ATTR_LONG_NAME_MASK) != ATTR_LONG_NAME)
-            {
-                if (found_sfn == 1)
-                {
-                    status = 0;
-                    break;
-                }
-                else
-                {
-                    found_sfn = 1;
-                }
-            }
-            entry->DIR_Name[0] = ENTRY_FREE_FAT32;
+            chunk = remaining;
         }
-        if (fat_info->device->write((uint8_t *)entries, 1, address + sector, fat_info->bytesPerSec) != 0)
+        if (read_file_fat32(src, buffer, chunk) != (int)chunk)
         {
-            status = FAT32_ERR_WRITE_FAIL;
-            goto cleanup;
+            status = FAT32_ERR_READ_FAIL;
+            break;
         }
-        if (status == 0)
+        int written = write_file_fat32(dst, buffer, chunk);
+        if (written != (int)chunk)
         {
+            status = written < 0 ? written : FAT32_ERR_WRITE_FAIL;
             break;
         }
-
-        idx = fat_info->bytesPerSec / sizeof(FatDir_Type);
+        remaining -= chunk;
+        chunk = fat_info->bytesPerSec;
     }
-cleanup:
-    if (fat32_free(entries, fat_info->bytesPerSec / sizeof(FatDir_Type)) != 0)
+
+    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
     {
-        // Вывести в лог
+        // вывод в лог
     }
     return status;
 }
 
-/**
- * @brief Удаление обычного файла по указанному пути
- *
- * Функция удаляет файл в файловой системе FAT32:
- * 1. Проверяет путь и наличие FS.
- * 2. Находит кластер файла и его родительский каталог.
- * 3. Проверяет, что объект не является системным файлом или директорией.
- * 4. Удаляет запись в каталоге.
- * 5. Освобождает все кластеры, занятые файлом.
- *
- * @param path Абсолютный путь до файла (например, "/dir1/file.txt")
- * @return int Код возврата:
- *         0 — успех,
- *         < 0 — код ошибки (например, FAT32_ERR_*)
- */
-int delete_file_fat32(char *path)
+int fat32_concat(const char *dst_path, const char *src_path)
 {
-    if (path == NULL)
+    if (dst_path == NULL || src_path == NULL)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
@@ -2244,218 +5061,389 @@ int delete_file_fat32(char *path)
     {
         return FAT32_ERR_FS_NOT_LOADED;
     }
-
-    int status = validate_path(path);
-    if (status != 0)
+    if (validate_path(dst_path) != 0 || validate_path(src_path) != 0)
     {
         return FAT32_ERR_INVALID_PATH;
     }
-    uint32_t file_cluster;
-    status = find_directory_fat32(path, &file_cluster);
-    if (status != 0)
+
+    DirEntryRef dst_ref, src_ref;
+    if (resolve_entry_fat32(fat_info->root_cluster, dst_path, &dst_ref) != 0 || dst_ref.entry.DIR_Attr == ATTR_SYSTEM ||
+        resolve_entry_fat32(fat_info->root_cluster, src_path, &src_ref) != 0 || src_ref.entry.DIR_Attr == ATTR_SYSTEM)
     {
         return FAT32_ERR_ENTRY_NOT_FOUND;
     }
-
-    uint32_t size = strlen(path) + 1;
-    char *parent_dir_path = fat32_alloc(size);
-    if (parent_dir_path == NULL)
+    if ((dst_ref.entry.DIR_Attr & ATTR_DIRECTORY) || (src_ref.entry.DIR_Attr & ATTR_DIRECTORY))
     {
-        return FAT32_ERR_ALLOC_FAILED;
-    };
+        return FAT32_ERR_IS_DIRECTORY;
+    }
+    if (dst_ref.parent_cluster == src_ref.parent_cluster &&
+        same_entry_position(&dst_ref.position, &src_ref.position))
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
 
-    status = get_dir_path(path, parent_dir_path, size);
-    if (status != 0)
+    uint32_t dst_size = dst_ref.entry.DIR_FileSize;
+    uint32_t src_size = src_ref.entry.DIR_FileSize;
+    if (src_size > UINT32_MAX - dst_size)
     {
-        status = FAT32_ERR_INVALID_PATH;
-        goto cleanup;
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
-    uint32_t parent_cluster = 0;
-    status = find_directory_fat32(parent_dir_path, &parent_cluster);
-    if (status != 0)
+    uint32_t src_cluster = 0;
+    join_cluster_number(&src_cluster, src_ref.entry.DIR_FstClusHI, src_ref.entry.DIR_FstClusLO);
+
+    FAT32_File *dst = init_file_handle(&dst_ref, F_APPEND);
+    if (dst == NULL)
     {
-        status = FAT32_ERR_ENTRY_NOT_FOUND;
-        goto cleanup;
+        return FAT32_ERR_OPEN_FAILED;
     }
 
-    // проверка что это директория
-    uint8_t attr = 0;
-    status = get_attr_entry_fat32(parent_cluster, file_cluster, &attr);
-    if (status != 0 || attr == ATTR_SYSTEM)
+    int status = 0;
+    uint32_t cluster_bytes = (uint32_t)fat_info->secPerClus * fat_info->bytesPerSec;
+    int spliced = 0;
+    if (src_size == 0)
     {
-        status = FAT32_ERR_ENTRY_NOT_FOUND;
-        goto cleanup;
+        // Дописывать нечего: остаётся удалить src
     }
-    if (attr & ATTR_DIRECTORY || attr == ATTR_SYSTEM)
+    else if (dst_size % cluster_bytes == 0)
     {
-        status = FAT32_ERR_IS_DIRECTORY;
-        goto cleanup;
+        // Граница dst совпадает с границей кластера: цепочка src подвешивается к dst
+        // без копирования. Хвост dst за концом данных (предвыделение) освобождается.
+        uint32_t old_tail = dst->first_cluster;
+        if (dst_size == 0)
+        {
+            FatDir_Type entry;
+            status = read_directory_entry_fat32(&dst->entry_pos, &entry);
+            if (status == 0)
+            {
+                split_cluster_number(src_cluster, &entry.DIR_FstClusHI, &entry.DIR_FstClusLO);
+                status = write_dir_entries_at(&dst->entry_pos, &entry, 1);
+            }
+            if (status != 0)
+            {
+                status = FAT32_ERR_WRITE_FAIL;
+                goto cleanup;
+            }
+            dst->first_cluster = src_cluster;
+        }
+        else
+        {
+            uint32_t last_cluster = dst->position.cluster_number;
+            old_tail = last_cluster;
+            status = file_next_cluster(dst, &old_tail);
+            if (status != 0)
+            {
+                status = FAT32_ERR_READ_FAIL;
+                goto cleanup;
+            }
+            if (update_fat32(last_cluster, src_cluster) != 0)
+            {
+                status = FAT32_ERR_UPDATE_FAILED;
+                goto cleanup;
+            }
+        }
+        spliced = 1;
+        dst->size_bytes = dst_size + src_size;
+        status = flush_fat32(dst);
+        if (status == 0 && old_tail != 0 && old_tail != FILE_END_TABLE_FAT32)
+        {
+            status = queue_chain_release(old_tail);
+        }
     }
-
-    char file_name[256];
-    status = get_last_path_component(path, file_name);
-    if (status != 0)
+    else
     {
-        status = FAT32_ERR_INVALID_PATH;
-        goto cleanup;
+        // Середина кластера: данные src копируются, цепочка src освобождается
+        FAT32_File *src = init_file_handle(&src_ref, F_READ);
+        if (src == NULL)
+        {
+            status = FAT32_ERR_OPEN_FAILED;
+            goto cleanup;
+        }
+        status = append_file_copy(dst, src);
+        if (close_file_fat32(&src) != 0)
+        {
+            // вывод в лог
+        }
+        if (status != 0)
+        {
+            // dst возвращается к исходному размеру, src не изменяется
+            if (fat32_truncate(dst, dst_size) != 0)
+            {
+                // вывод в лог
+            }
+            goto cleanup;
+        }
+        status = flush_fat32(dst);
     }
-
-    status = mark_dir_entry_deleted(parent_cluster, file_name);
     if (status != 0)
     {
-        status = FAT32_ERR_WRITE_FAIL;
         goto cleanup;
     }
 
-    status = delete_entry_fat32(file_cluster);
+    // Запись src удаляется последней: при сбое до этого момента данные src остаются
+    // доступны под прежним именем (после сцепления — в общей с dst цепочке)
+    status = mark_dir_entry_deleted(&src_ref);
     if (status != 0)
     {
         status = FAT32_ERR_WRITE_FAIL;
         goto cleanup;
     }
+    if (!spliced)
+    {
+        status = queue_chain_release(src_cluster);
+    }
+
 cleanup:
-    if (fat32_free(parent_dir_path, size) != 0)
+    // Запись каталога dst уже обновлена, дескриптор освобождается без повторного flush
+    open_files_remove(dst);
+    if (fat32_free(dst, sizeof(FAT32_File)) != 0)
     {
-        // Вывести в лог
+        // вывод в лог
+    }
+    return status;
+}
+
+/**
+ * Определяет непрерывный участок цепочки кластеров, начинающийся с cluster.
+ *
+ * Записи FAT читаются посекторно в fat_buffer; номер прочитанного сектора хранится
+ * в *loaded_sector, поэтому соседние участки одного сектора FAT не перечитываются.
+ *
+ * @param cluster       Первый кластер участка.
+ * @param limit         Максимальная длина участка, кластеров (не меньше 1).
+ * @param fat_buffer    Буфер одного сектора FAT.
+ * @param loaded_sector [in/out] Сектор FAT, находящийся в буфере (UINT32_MAX — никакой).
+ * @param length        [out] Длина участка, кластеров.
+ * @param next          [out] Кластер после участка или FILE_END_TABLE_FAT32.
+ * @return 0 при успехе, FAT32_ERR_READ_FAIL или FAT32_ERR_INVALID_CLUSTER_CHAIN.
+ */
+static int chain_run_at(uint32_t cluster, uint32_t limit, uint32_t *fat_buffer, uint32_t *loaded_sector,
+                        uint32_t *length, uint32_t *next)
+{
+    *length = 0;
+    while (1)
+    {
+        uint32_t current = cluster + *length;
+        if (current < 2 || current >= fat_info->cluster_count)
+        {
+            return FAT32_ERR_INVALID_CLUSTER_CHAIN;
+        }
+        uint32_t sector = current / fat_info->fat_ents_sec;
+        if (sector != *loaded_sector)
+        {
+            if (fat_info->device->read((uint8_t *)fat_buffer, 1, fat_info->address_tabl1 + sector, fat_info->bytesPerSec) < 0)
+            {
+                *loaded_sector = UINT32_MAX;
+                return FAT32_ERR_READ_FAIL;
+            }
+            *loaded_sector = sector;
+        }
+
+        uint32_t idx = current % fat_info->fat_ents_sec;
+        uint32_t available = fat_info->fat_ents_sec - idx;
+        if (available > limit - *length)
+        {
+            available = limit - *length;
+        }
+        uint32_t run = fat32_scan_chain_run(fat_buffer + idx, available, current);
+        if (run < available)
+        {
+            // Кластер current + run входит в участок, его запись FAT — переход дальше
+            *length += run + 1;
+            *next = fat_buffer[idx + run] & FAT32_ENTRY_MASK;
+            if (*next >= FAT32_CLUSTER_EOC_MIN)
+            {
+                *next = FILE_END_TABLE_FAT32;
+            }
+            return 0;
+        }
+        *length += run;
+        if (*length == limit)
+        {
+            *next = cluster + *length;
+            return 0;
+        }
     }
-    return status;
 }
 
 /**
- * @brief Удаление директории по указанному пути
- *
- * В зависимости от режима удаления:
- * - В режиме DELETE_DIR_SAFE директория удаляется только если пуста.
- * - В режиме DELETE_DIR_RECURSIVE производится рекурсивное удаление всех вложенных файлов и поддиректорий.
+ * Копирует count секторов носителя с src_sector на dst_sector.
  *
- * @param path Абсолютный путь до директории (например, "/dir1/subdir")
- * @param mode Режим удаления:
- *             DELETE_DIR_SAFE — только если пуста;
- *             DELETE_DIR_RECURSIVE — рекурсивное удаление содержимого.
- * @return int Код возврата:
- *         0 — успех,
- *         < 0 — ошибка (например, FAT32_ERR_*)
+ * Используется обработчик копирования устройства, если он есть; иначе данные
+ * передаются через buffer порциями до buffer_sectors секторов.
  */
-int delete_dir_fat32(char *path, DeleteDirMode mode)
+static int copy_device_sectors(uint32_t dst_sector, uint32_t src_sector, uint32_t count, uint8_t *buffer,
+                               uint32_t buffer_sectors)
 {
-    if (path == NULL)
+    BlockDevice *device = fat_info->device;
+    if (device->copy != NULL)
     {
-        return FAT32_ERR_INVALID_PATH;
+        return device->copy(dst_sector, src_sector, count, fat_info->bytesPerSec) < 0 ? FAT32_ERR_WRITE_FAIL : 0;
+    }
+    while (count > 0)
+    {
+        uint32_t portion = count < buffer_sectors ? count : buffer_sectors;
+        if (device->read(buffer, portion, src_sector, fat_info->bytesPerSec) < 0)
+        {
+            return FAT32_ERR_READ_FAIL;
+        }
+        if (device->write(buffer, portion, dst_sector, fat_info->bytesPerSec) < 0)
+        {
+            return FAT32_ERR_WRITE_FAIL;
+        }
+        src_sector += portion;
+        dst_sector += portion;
+        count -= portion;
+    }
+    return 0;
+}
+
+int fat32_copy_file(const char *src_path, const char *dst_path)
+{
+    if (src_path == NULL || dst_path == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
     if (fat_info == NULL)
     {
         return FAT32_ERR_FS_NOT_LOADED;
     }
-    char *path_buff = NULL;
-    char *parent_dir_path = NULL;
-
-    uint32_t length = strlen(path);
-    if (length > 0 && path[length - 1] == '/')
-        --length;
-    path_buff = fat32_alloc(length);
-    if (path_buff == NULL)
+    if (validate_path(src_path) != 0 || validate_path(dst_path) != 0)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        return FAT32_ERR_INVALID_PATH;
     }
-    strncpy(path_buff, path, length);
 
-    int status = validate_path(path_buff);
-    if (status != 0)
+    DirEntryRef src_ref, dst_ref;
+    if (resolve_entry_fat32(fat_info->root_cluster, src_path, &src_ref) != 0 || src_ref.entry.DIR_Attr == ATTR_SYSTEM)
     {
-        status = FAT32_ERR_INVALID_PATH;
-        goto cleanup;
+        return FAT32_ERR_ENTRY_NOT_FOUND;
+    }
+    if (src_ref.entry.DIR_Attr & ATTR_DIRECTORY)
+    {
+        return FAT32_ERR_IS_DIRECTORY;
+    }
+    // Открытие dst на запись обрезает его, поэтому копия файла в самого себя запрещена
+    if (resolve_entry_fat32(fat_info->root_cluster, dst_path, &dst_ref) == 0 &&
+        dst_ref.parent_cluster == src_ref.parent_cluster &&
+        same_entry_position(&dst_ref.position, &src_ref.position))
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
 
-    uint32_t dir_cluster;
-    status = find_directory_fat32(path_buff, &dir_cluster);
+    uint32_t size = src_ref.entry.DIR_FileSize;
+    uint32_t src_cluster = 0;
+    join_cluster_number(&src_cluster, src_ref.entry.DIR_FstClusHI, src_ref.entry.DIR_FstClusLO);
 
+    FAT32_File *dst = NULL;
+    int status = open_file_in_dir(fat_info->root_cluster, dst_path, &dst, F_WRITE);
     if (status != 0)
     {
-        status = FAT32_ERR_ENTRY_NOT_FOUND;
-        goto cleanup;
+        return status;
     }
 
-    parent_dir_path = fat32_alloc(length);
-    if (parent_dir_path == NULL)
+    // Два сектора FAT (для цепочек src и dst) и буфер данных, если устройство не копирует само
+    uint8_t *buffer = NULL;
+    uint32_t buffer_sectors = 0;
+    uint32_t *fat_buffer = fat32_alloc(2 * fat_info->bytesPerSec);
+    if (fat_buffer == NULL)
     {
         status = FAT32_ERR_ALLOC_FAILED;
         goto cleanup;
-    };
-
-    status = get_dir_path(path_buff, parent_dir_path, length);
-    if (status != 0)
-    {
-        status = FAT32_ERR_INVALID_PATH;
-        goto cleanup;
     }
-    uint32_t parent_cluster = 0;
-    status = find_directory_fat32(parent_dir_path, &parent_cluster);
-    if (status != 0)
+    if (fat_info->device->copy == NULL)
     {
-        status = FAT32_ERR_ENTRY_NOT_FOUND;
-        goto cleanup;
+        // При нехватке памяти буфер уменьшается вплоть до одного сектора
+        buffer_sectors = FAT32_COPY_BUFFER_SECTORS;
+        buffer = fat32_alloc(buffer_sectors * fat_info->bytesPerSec);
+        while (buffer == NULL && buffer_sectors > 1)
+        {
+            buffer_sectors /= 2;
+            buffer = fat32_alloc(buffer_sectors * fat_info->bytesPerSec);
+        }
+        if (buffer == NULL)
+        {
+            status = FAT32_ERR_ALLOC_FAILED;
+            goto cleanup;
+        }
     }
 
-    // проверка что это директория
-    uint8_t attr = 0;
-    status = get_attr_entry_fat32(parent_cluster, dir_cluster, &attr);
-    if (status != 0 || attr != ATTR_DIRECTORY)
+    // Цепочка dst резервируется заранее: обычно это один непрерывный участок
+    status = fat32_preallocate(dst, size);
+    if (status != 0)
     {
-        status = FAT32_ERR_NOT_A_DIRECTORY;
         goto cleanup;
     }
 
-    if (mode == DELETE_DIR_SAFE)
+    uint32_t *src_fat = fat_buffer;
+    uint32_t *dst_fat = fat_buffer + fat_info->fat_ents_sec;
+    uint32_t src_loaded = UINT32_MAX, dst_loaded = UINT32_MAX;
+    uint32_t src_run = 0, dst_run = 0, src_next = 0, dst_next = 0;
+    uint32_t dst_cluster = dst->first_cluster;
+    uint32_t sectors_left = size / fat_info->bytesPerSec + (size % fat_info->bytesPerSec != 0);
+    while (sectors_left > 0)
     {
-        if (is_dir_empty_fat32(dir_cluster) != 0)
+        uint32_t clusters_left = sectors_left / fat_info->secPerClus + (sectors_left % fat_info->secPerClus != 0);
+        if (src_run == 0)
         {
-            status = FAT32_ERR_DIR_NOT_EMPTY;
-            goto cleanup;
+            status = (src_cluster == FILE_END_TABLE_FAT32) ? FAT32_ERR_CLUSTER_CHAIN_BROKEN
+                                                          : chain_run_at(src_cluster, clusters_left, src_fat, &src_loaded, &src_run, &src_next);
+        }
+        if (status == 0 && dst_run == 0)
+        {
+            status = (dst_cluster == FILE_END_TABLE_FAT32) ? FAT32_ERR_CLUSTER_CHAIN_BROKEN
+                                                          : chain_run_at(dst_cluster, clusters_left, dst_fat, &dst_loaded, &dst_run, &dst_next);
         }
-    }
-    else
-    {
-        status = delete_dir_recursive_fat32(dir_cluster);
         if (status != 0)
         {
-            status = FAT32_ERR_DELETE_FAIL;
-            goto cleanup;
+            break;
         }
-    }
 
-    char file_name[256];
-    status = get_last_path_component(path_buff, file_name);
-    if (status != 0)
-    {
-        status = FAT32_ERR_INVALID_PATH;
-        goto cleanup;
+        // Общая часть участков копируется одной серией многосекторных обращений
+        uint32_t clusters = src_run < dst_run ? src_run : dst_run;
+        uint32_t sectors = clusters * fat_info->secPerClus;
+        if (sectors > sectors_left)
+        {
+            sectors = sectors_left;
+        }
+        status = copy_device_sectors(fat_info->address_region + (dst_cluster - fat_info->root_cluster) * fat_info->secPerClus,
+                                     fat_info->address_region + (src_cluster - fat_info->root_cluster) * fat_info->secPerClus,
+                                     sectors, buffer, buffer_sectors);
+        if (status != 0)
+        {
+            break;
+        }
+        sectors_left -= sectors;
+
+        src_run -= clusters;
+        src_cluster = (src_run == 0) ? src_next : src_cluster + clusters;
+        dst_run -= clusters;
+        dst_cluster = (dst_run == 0) ? dst_next : dst_cluster + clusters;
     }
-    status = mark_dir_entry_deleted(parent_cluster, file_name);
-    if (status != 0)
+    if (status == 0)
     {
-        status = FAT32_ERR_WRITE_FAIL;
-        goto cleanup;
+        // Размер записывается в запись каталога при закрытии
+        dst->size_bytes = size;
     }
 
-    status = delete_entry_fat32(dir_cluster);
-    if (status != 0)
-    {
-        status = FAT32_ERR_WRITE_FAIL;
-    }
 cleanup:
-    if (path_buff != NULL)
+    if (status != 0)
     {
-        if (fat32_free(path_buff, length) != 0)
+        // Неполная копия не остаётся: dst пуст, зарезервированные кластеры освобождаются
+        if (fat32_truncate(dst, 0) != 0)
         {
-            // Вывести в лог
+            // вывод в лог
         }
     }
-    if (parent_dir_path != NULL)
+    if (close_file_fat32(&dst) != 0 && status == 0)
     {
-        if (fat32_free(parent_dir_path, length) != 0)
-        {
-            // Вывести в лог
-        }
+        status = FAT32_ERR_FLUSH_FAILED;
+    }
+    if (buffer != NULL && fat32_free(buffer, buffer_sectors * fat_info->bytesPerSec) != 0)
+    {
+        // вывод в лог
+    }
+    if (fat_buffer != NULL && fat32_free(fat_buffer, 2 * fat_info->bytesPerSec) != 0)
+    {
+        // вывод в лог
     }
     return status;
 }
@@ -2507,18 +5495,19 @@ cleanup:
  * @param name Имя файла (в обычном виде, например "file.txt")
  * @param length Длина строки `name`
  * @param entry Указатель на структуру FatDir_Type (запись каталога FAT32)
- * @return int 0 если имена совпадают, -1 если нет или если имя длиннее 11 символов
+ * @return int 0 если имена совпадают, -1 если нет или если имя длиннее формата 8.3
  */
-int fat32_compare_sfn(char *name, uint32_t length, const FatDir_Type *entry)
+int fat32_compare_sfn(const char *name, uint32_t length, const FatDir_Type *entry)
 {
     if (name == NULL)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
-    if (length > SHORT_NAME_SIZE)
+    // 8 символов имени, точка и 3 символа расширения
+    if (length > SHORT_NAME_SIZE + 1)
         return -1;
     char buffer[SHORT_NAME_SIZE];
-    fat32_format_sfn(name, strlen(name), buffer);
+    fat32_format_sfn(name, length, buffer);
     for (int idx = 0; idx < SHORT_NAME_SIZE; ++idx)
     {
         if (buffer[idx] != entry->DIR_Name[idx])
@@ -2544,113 +5533,138 @@ int fat32_compare_sfn(char *name, uint32_t length, const FatDir_Type *entry)
  *         FAT32_ERR_NOT_FOUND если запись не найдена,
  *         или другой код ошибки при чтении.
  */
-int find_entry_cluster_fat32(char *name, uint32_t length, uint32_t parent_cluster, uint32_t *out_cluster)
+int find_entry_cluster_fat32(const char *name, uint32_t length, uint32_t parent_cluster, uint32_t *out_cluster)
 {
-    uint8_t *buffer = fat32_alloc(fat_info->bytesPerSec);
-    if (buffer == NULL)
+    if (out_cluster == NULL)
     {
-        return FAT32_ERR_ALLOC_FAILED;
+        return FAT32_ERR_INVALID_ARGUMENT;
     }
-    uint32_t address = (parent_cluster - fat_info->root_cluster) * fat_info->secPerClus + fat_info->address_region;
-    uint32_t sector = 0, idxEntry = 0;
-    int status = 0;
-    uint16_t buffer_name[MAX_NAME_SIZE];
-
-    FatDir_Type *entry;
-    uint8_t lfn_active = 0;
-    uint8_t chksum_exp = 0;
+    DirEntryRef ref;
+    int status = find_dir_entry(name, length, parent_cluster, &ref);
+    if (status == FAT32_ERR_ENTRY_NOT_FOUND)
+    {
+        return FAT32_ERR_NOT_FOUND;
+    }
+    if (status == 0)
+    {
+        join_cluster_number(out_cluster, ref.entry.DIR_FstClusHI, ref.entry.DIR_FstClusLO);
+    }
+    return status;
+}
 
-    uint8_t idx = 0;
-    uint8_t order = 0;
+/**
+ * @brief Находит кластер записи по первым length символам пути.
+ *
+ * Компоненты пути перебираются итератором Fat32PathIter без копирования строки,
+ * каждый компонент ищется в каталоге, найденном на предыдущем шаге.
+ * Пустой путь и "/" соответствуют базовому каталогу.
+ *
+ * @param base_cluster Каталог, от которого ведётся поиск (корень для абсолютных путей).
+ * @param path        Путь (не обязательно завершённый нулём).
+ * @param length      Длина разбираемой части пути.
+ * @param out_cluster [out] Первый кластер найденной записи.
+ * @return 0 в случае успеха,
+ *         FAT32_ERR_NAME_TOO_LONG если компонент длиннее MAX_NAME_SIZE - 1,
+ *         FAT32_ERR_DIR_NOT_FOUND если какой-либо компонент не найден.
+ */
+static int resolve_path_fat32(uint32_t base_cluster, const char *path, uint32_t length, uint32_t *out_cluster)
+{
+    Fat32PathIter iter;
+    const char *name = NULL;
+    uint32_t name_length = 0;
+    uint32_t cluster = base_cluster;
+    int status = 0;
 
-    while (1)
+    fat32_path_iter_init(&iter, path, length);
+    while (fat32_path_iter_next(&iter, &name, &name_length))
     {
-        for (sector = 0; sector < fat_info->secPerClus; ++sector)
+        if (name_length >= MAX_NAME_SIZE)
         {
-            status = fat_info->device->read(buffer, 1, address + sector, fat_info->bytesPerSec);
-            if (status < 0)
-            {
-                status = FAT32_ERR_READ_FAIL;
-                goto cleanup;
-            }
-            for (idxEntry = 0; idxEntry < fat_info->bytesPerSec; idxEntry += sizeof(FatDir_Type))
-            {
-                entry = (FatDir_Type *)&buffer[idxEntry];
-                if (entry->DIR_Name[0] == ENTRY_FREE_FULL_FAT32)
-                {
-                    status = FAT32_ERR_NOT_FOUND;
-                    goto cleanup;
-                }
-                else if (entry->DIR_Name[0] == ENTRY_FREE_FAT32)
-                {
-                    if (lfn_active)
-                    {
-                        status = FAT32_ERR_NOT_FOUND;
-                        goto cleanup;
-                    }
-                    continue;
-                }
-                else if ((entry->DIR_Attr & ATTR_LONG_NAME_MASK) == ATTR_LONG_NAME)
-                {
-                    if (((LDIR_Type *)entry)->LDIR_Ord & LFN_ENTRY_LAST)
-                        chksum_exp = ((LDIR_Type *)entry)->LDIR_Chksum;
-                    if (((LDIR_Type *)entry)->LDIR_Type != 0)
-                        continue;
-                    order = ((LDIR_Type *)entry)->LDIR_Ord & ~LFN_ENTRY_LAST;
-
-                    idx = (order - 1) * MAX_SYMBOLS_ENTRY;
-                    stm_memcpy((uint8_t *)(&buffer_name[idx]), ((LDIR_Type *)entry)->LDIR_Name1, sizeof(((LDIR_Type *)entry)->LDIR_Name1));
-                    idx += sizeof(((LDIR_Type *)entry)->LDIR_Name1) / 2;
-                    stm_memcpy((uint8_t *)&buffer_name[idx], ((LDIR_Type *)entry)->LDIR_Name2, sizeof(((LDIR_Type *)entry)->LDIR_Name2));
-                    idx += sizeof(((LDIR_Type *)entry)->LDIR_Name2) / 2;
-                    stm_memcpy((uint8_t *)&buffer_name[idx], ((LDIR_Type *)entry)->LDIR_Name3, sizeof(((LDIR_Type *)entry)->LDIR_Name3));
-                    lfn_active = 1;
-                }
-                else
-                {
-                    if (lfn_active)
-                    {
-                        uint8_t chksum_calc = fat32_sfn_checksum(entry->DIR_Name);
-                        if (chksum_calc == chksum_exp)
-                        {
-                            if (fat32_compare_lfn(name, buffer_name) == 0)
-                            {
-                                join_cluster_number(out_cluster, entry->DIR_FstClusHI, entry->DIR_FstClusLO);
-                                status = 0;
-                                goto cleanup;
-                            }
-                        }
-                        lfn_active = 0;
-                        chksum_exp = 0;
-                        memset(buffer_name, 0x00, MAX_NAME_SIZE);
-                    }
-                    else if (fat32_compare_sfn(name, length, (FatDir_Type *)entry) == 0)
-                    {
-                        join_cluster_number(out_cluster, entry->DIR_FstClusHI, entry->DIR_FstClusLO);
-                        status = 0;
-                        goto cleanup;
-                    }
-                }
-            }
+            return FAT32_ERR_NAME_TOO_LONG;
+        }
+        status = find_entry_cluster_fat32(name, name_length, cluster, &cluster);
+        if (status != 0)
+        {
+            return FAT32_ERR_DIR_NOT_FOUND;
         }
     }
-    status = 1;
+    *out_cluster = cluster;
+    return 0;
+}
 
-cleanup:
-    if (fat32_free(buffer, fat_info->bytesPerSec) != 0)
+/**
+ * @brief Находит кластер родительского каталога последнего компонента пути.
+ *
+ * Относительное имя без '/' ищется непосредственно в базовом каталоге.
+ *
+ * @param base_cluster   Каталог, от которого ведётся поиск.
+ * @param path           Путь.
+ * @param parent_cluster [out] Кластер родительского каталога.
+ * @param name           [out] Указатель на последний компонент в строке path (может быть NULL).
+ * @param name_length    [out] Длина последнего компонента (может быть NULL).
+ * @return 0 в случае успеха или код ошибки.
+ */
+static int resolve_parent_fat32(uint32_t base_cluster, const char *path, uint32_t *parent_cluster, const char **name, uint32_t *name_length)
+{
+    uint32_t length = strlen(path);
+    uint32_t parent_length = 0, last_length = 0;
+    const char *last = NULL;
+    int status = fat32_path_split(path, length, &parent_length, &last, &last_length);
+    if (status == FAT32_ERR_INVALID_PATH && length > 0 && path[0] != '/')
+    {
+        parent_length = 0;
+        last = path;
+        last_length = length;
+        while (last_length > 1 && path[last_length - 1] == '/')
+            --last_length;
+        status = 0;
+    }
+    if (status != 0)
     {
-        // Вывод в лог
+        return status;
     }
+    if (name != NULL)
+        *name = last;
+    if (name_length != NULL)
+        *name_length = last_length;
+    return resolve_path_fat32(base_cluster, path, parent_length, parent_cluster);
+}
 
-    return status;
+/**
+ * @brief Разрешает путь за один проход по его компонентам.
+ *
+ * Находит родительский каталог последнего компонента и его запись. Если последний
+ * компонент отсутствует, возвращается FAT32_ERR_ENTRY_NOT_FOUND, а ref->parent_cluster
+ * содержит найденный родительский каталог (например, для создания файла).
+ *
+ * @param base_cluster Каталог, от которого ведётся поиск.
+ * @param path Путь.
+ * @param ref  [out] Родительский каталог, положение группы записей и копия SFN-записи.
+ * @return 0 — запись найдена,
+ *         FAT32_ERR_ENTRY_NOT_FOUND — родитель найден, записи нет,
+ *         FAT32_ERR_DIR_NOT_FOUND / FAT32_ERR_INVALID_PATH — путь к родителю не разрешён.
+ */
+static int resolve_entry_fat32(uint32_t base_cluster, const char *path, DirEntryRef *ref)
+{
+    const char *name = NULL;
+    uint32_t name_length = 0;
+    int status = resolve_parent_fat32(base_cluster, path, &ref->parent_cluster, &name, &name_length);
+    if (status != 0)
+    {
+        return status;
+    }
+    if (name_length >= MAX_NAME_SIZE)
+    {
+        return FAT32_ERR_INVALID_PATH;
+    }
+    return find_dir_entry(name, name_length, ref->parent_cluster, ref);
 }
 
 /**
  * @brief Находит кластер директории по заданному пути в файловой системе FAT32.
  *
- * Функция разбивает путь на компоненты (поддиректории),
- * затем последовательно ищет каждый компонент в файловой системе,
- * начиная с корневого кластера.
+ * Функция последовательно ищет каждый компонент пути,
+ * начиная с корневого кластера. Путь не копируется и память не выделяется.
  *
  * @param path Строка с путем к директории (например, "/folder/subfolder").
  * @param out_cluster Указатель на переменную, куда будет записан номер кластера найденной директории.
@@ -2658,76 +5672,24 @@ cleanup:
  */
 int find_directory_fat32(char *path, uint32_t *out_cluster)
 {
-    int status = 0;
-    char *pathToDir = NULL;
-    char (*directories)[MAX_NAME_SIZE] = NULL;
     if (path == NULL || out_cluster == NULL)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
-
-    pathToDir = fat32_alloc(strlen(path) + 1);
-    if (pathToDir == NULL)
-    {
-        return FAT32_ERR_ALLOC_FAILED;
-    }
-    stm_memcpy(pathToDir, path, strlen(path) + 1);
-
-    if (strcmp(path, "/") == 0)
-    {
-        *out_cluster = fat_info->root_cluster;
-        status = 0;
-        goto cleanup;
-    }
-
-    status = validate_path(pathToDir);
-    if (status != 0)
+    if (fat_info == NULL)
     {
-        status = FAT32_ERR_INVALID_PATH;
-        goto cleanup;
+        return FAT32_ERR_FS_NOT_LOADED;
     }
 
-    uint32_t depth = fat32_path_depth(pathToDir);
-    directories = fat32_alloc(depth * MAX_NAME_SIZE);
-    if (directories == NULL)
+    if (validate_path(path) != 0)
     {
-        status = FAT32_ERR_ALLOC_FAILED;
-        goto cleanup;
+        return FAT32_ERR_INVALID_PATH;
     }
 
-    memset(directories, 0, depth * MAX_NAME_SIZE);
-
-    status = fat32_parse_path(pathToDir, directories);
-    if (status < 0)
+    int status = resolve_path_fat32(fat_info->root_cluster, path, strlen(path), out_cluster);
+    if (status == FAT32_ERR_NAME_TOO_LONG)
     {
         status = FAT32_ERR_INVALID_PATH;
-        goto cleanup;
-    }
-
-    *out_cluster = fat_info->root_cluster;
-    for (int idxDir = 0; idxDir < depth; ++idxDir)
-    {
-        status = find_entry_cluster_fat32(directories[idxDir], strlen(directories[idxDir]), *out_cluster, out_cluster);
-        if (status != 0)
-        {
-            status = FAT32_ERR_DIR_NOT_FOUND;
-            goto cleanup;
-        }
-    }
-cleanup:
-    if (pathToDir != NULL)
-    {
-        if (fat32_free(pathToDir, strlen(path) + 1) != 0)
-        {
-            // вывод в лог
-        }
-    }
-    if (directories != NULL)
-    {
-        if (fat32_free(directories, depth * MAX_NAME_SIZE) != 0)
-        {
-            // вывод в лог
-        }
     }
     return status;
 }
@@ -2758,6 +5720,11 @@ int formatted_fat32(BlockDevice *device, uint64_t capacity)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
+    fat32_dir_cache_reset();
+    // Дескрипторы, открытые до перемонтирования, тому больше не принадлежат
+    open_files = NULL;
+    // Таблица FAT строится заново, поэтому отложенные цепочки просто отбрасываются
+    deferred_count = 0;
     int status = 0;
     // Загрузить данные MBR
     MBR_Type mbr_data = {0};
@@ -2811,8 +5778,8 @@ int formatted_fat32(BlockDevice *device, uint64_t capacity)
     mbr_data.BS_DrvNum = 0x80;
     mbr_data.BS_BootSig = 0x29;
     mbr_data.BS_VolID = 345;
-    stm_memcpy(mbr_data.BS_VolLab, "STM32F407", sizeof(mbr_data.BS_VolLab));
-    stm_memcpy(mbr_data.BS_FilSysType, "FAT32 ", sizeof(mbr_data.BS_FilSysType));
+    stm_memcpy(mbr_data.BS_VolLab, "STM32F407  ", sizeof(mbr_data.BS_VolLab));
+    stm_memcpy(mbr_data.BS_FilSysType, "FAT32   ", sizeof(mbr_data.BS_FilSysType));
     mbr_data.Signature_word = WORD_SIGNATURE;
 
     FAT32_LOG_INFO(
@@ -2934,13 +5901,22 @@ int formatted_fat32(BlockDevice *device, uint64_t capacity)
 
     uint32_t data_addr = tabl2_addr + mbr_data.BPB_FATSz32;
 
-    status = device->write((uint8_t *)&dir, 1, (data_addr + (2 - mbr_data.BPB_RootClus) * mbr_data.BPB_SecPerClus), mbr_data.BPB_BytsPerSec);
+    // Кластеры корневого каталога и MYDIR должны начинаться с нулевых записей (конец каталога)
+    status = device->clear(data_addr, 2 * mbr_data.BPB_SecPerClus, mbr_data.BPB_BytsPerSec);
     if (status < 0)
     {
         return FAT32_ERR_WRITE_FAIL;
     }
     uint8_t buffer_data[512] = {0};
 
+    stm_memcpy(buffer_data, (uint8_t *)&dir, sizeof(dir));
+    status = device->write(buffer_data, 1, (data_addr + (2 - mbr_data.BPB_RootClus) * mbr_data.BPB_SecPerClus), mbr_data.BPB_BytsPerSec);
+    if (status < 0)
+    {
+        return FAT32_ERR_WRITE_FAIL;
+    }
+    memset(buffer_data, 0, sizeof(buffer_data));
+
     FatDir_Type dir1 = {
         .DIR_Attr = ATTR_DIRECTORY,
         .DIR_FileSize = 0,
@@ -2978,6 +5954,18 @@ void init_fat_layout_info(MBR_Type *mbr_data)
     fat_info->secPerClus = mbr_data->BPB_SecPerClus;
     fat_info->fat_ents_sec = mbr_data->BPB_BytsPerSec / 4;
     fat_info->sizeFAT = mbr_data->BPB_FATSz32;
+    fat_info->free_count = FAT32_FREE_COUNT_UNKNOWN;
+
+    // Количество кластеров ограничено и размером области данных, и размером FAT
+    uint32_t fat_entries = fat_info->sizeFAT * fat_info->fat_ents_sec;
+    uint32_t system_sectors = mbr_data->BPB_RsvdSecCnt + mbr_data->BPB_NumFATs * mbr_data->BPB_FATSz32;
+    fat_info->cluster_count = fat_entries;
+    if (mbr_data->BPB_TotSec32 > system_sectors && fat_info->secPerClus != 0)
+    {
+        uint32_t data_clusters = (mbr_data->BPB_TotSec32 - system_sectors) / fat_info->secPerClus + 2;
+        if (data_clusters < fat_entries)
+            fat_info->cluster_count = data_clusters;
+    }
     // Вычисляем адреса таблиц FAT
     fat_info->address_tabl1 = mbr_data->BPB_HiddSec + mbr_data->BPB_RsvdSecCnt;
     fat_info->address_tabl2 += fat_info->address_tabl1 + fat_info->sizeFAT;
@@ -2986,11 +5974,38 @@ void init_fat_layout_info(MBR_Type *mbr_data)
 }
 
 int mount_fat32(BlockDevice *device)
+{
+    return mount_fat32_ex(device, NULL);
+}
+
+int mount_fat32_ex(BlockDevice *device, const Fat32AllocPolicy *policy)
 {
     if (device == NULL)
     {
         return FAT32_ERR_INVALID_ARGUMENT;
     }
+    if (policy == NULL)
+    {
+        policy = &fat32_policy_first_fit;
+    }
+    if (policy->find_runs == NULL)
+    {
+        return FAT32_ERR_INVALID_ARGUMENT;
+    }
+    if (fat_info != NULL && deferred_count > 0)
+    {
+        // Отложенные цепочки принадлежат ещё смонтированному тому: они освобождаются до смены
+        // fat_info, а при ошибке том остаётся смонтированным, и очередь сохраняется для повтора
+        int status = fat32_free_step(0);
+        if (status < 0)
+        {
+            return status;
+        }
+    }
+    deferred_count = 0;
+    fat32_dir_cache_reset();
+    // Дескрипторы, открытые до перемонтирования, тому больше не принадлежат
+    open_files = NULL;
 
     fat_info = fat32_alloc(sizeof(FatLayoutInfo));
     if (fat_info == NULL)
@@ -2999,6 +6014,11 @@ int mount_fat32(BlockDevice *device)
         return FAT32_ERR_ALLOC_FAILED;
     }
     fat_info->device = device;
+    fat_info->alloc_policy = policy;
+    if (policy->reset != NULL)
+    {
+        policy->reset();
+    }
 
     if (device->block_size < 512)
     {
@@ -0,0 +1,88 @@
+#include <stddef.h>
+#include "fat32/fat32_alloc_policy.h"
+
+/** Курсор next-fit: кластер, следующий за последним выделенным */
+static uint32_t next_fit_cursor = 2;
+
+/** Граница занятой области для политики locality */
+static uint32_t locality_frontier = 2;
+
+/** Возвращает кластер, следующий за последним участком выделения */
+static uint32_t alloc_end(const Fat32ClusterAlloc *alloc)
+{
+    const Fat32ClusterRun *last = &alloc->runs[alloc->run_count - 1];
+    return last->first + last->count;
+}
+
+static int first_fit_find_runs(uint32_t goal, uint32_t count, Fat32ClusterAlloc *alloc)
+{
+    (void)goal;
+    return fat32_find_free_runs(2, count, alloc);
+}
+
+static void next_fit_reset(void)
+{
+    next_fit_cursor = 2;
+}
+
+static int next_fit_find_runs(uint32_t goal, uint32_t count, Fat32ClusterAlloc *alloc)
+{
+    (void)goal;
+    int status = fat32_find_free_runs(next_fit_cursor, count, alloc);
+    if (status == 0)
+    {
+        next_fit_cursor = alloc_end(alloc);
+    }
+    return status;
+}
+
+static int best_fit_find_runs(uint32_t goal, uint32_t count, Fat32ClusterAlloc *alloc)
+{
+    (void)goal;
+    int status = fat32_find_contiguous_run(count, 0, &alloc->runs[0]);
+    if (status == FAT32_ERR_NOT_FOUND)
+    {
+        return fat32_find_free_runs(2, count, alloc);
+    }
+    if (status != 0)
+    {
+        return status;
+    }
+    alloc->run_count = 1;
+    alloc->total = count;
+    return 0;
+}
+
+static void locality_reset(void)
+{
+    locality_frontier = 2;
+}
+
+static int locality_find_runs(uint32_t goal, uint32_t count, Fat32ClusterAlloc *alloc)
+{
+    if (goal != 0)
+    {
+        int status = fat32_cluster_is_free(goal + 1);
+        if (status < 0)
+        {
+            return status;
+        }
+        if (status == 1)
+        {
+            return fat32_find_free_runs(goal + 1, count, alloc);
+        }
+    }
+
+    // Новый участок открывается на границе, за ним остаётся окно для роста этого же файла
+    int status = fat32_find_free_runs(locality_frontier, count, alloc);
+    if (status == 0)
+    {
+        locality_frontier = alloc_end(alloc) + FAT32_ALLOC_LOCALITY_WINDOW;
+    }
+    return status;
+}
+
+const Fat32AllocPolicy fat32_policy_first_fit = {"first-fit", NULL, first_fit_find_runs};
+const Fat32AllocPolicy fat32_policy_next_fit = {"next-fit", next_fit_reset, next_fit_find_runs};
+const Fat32AllocPolicy fat32_policy_best_fit = {"best-fit", NULL, best_fit_find_runs};
+const Fat32AllocPolicy fat32_policy_locality = {"locality", locality_reset, locality_find_runs};
@@ -0,0 +1,520 @@
+#include "fat32/fat32_dir_cache.h"
+#include <string.h>
+#include "fat32/fat32_alloc.h"
+#include "fat32/file_utils.h"
+
+// Начальная ёмкость индекса (степень двойки)
+#define DIR_INDEX_MIN_CAPACITY 64
+
+// Специальные значения поля hash
+#define DIR_INDEX_EMPTY 0
+#define DIR_INDEX_DELETED 1
+
+// Количество бит фильтра Блума на одно имя
+#define DIR_BLOOM_HASHES 3
+// Наибольшее количество имён в фильтре: около 8 бит на имя (~3% ложных совпадений)
+#define DIR_BLOOM_MAX_NAMES (FAT32_DIR_CACHE_BLOOM_BITS / 8)
+
+#if (FAT32_DIR_CACHE_BLOOM_BITS & (FAT32_DIR_CACHE_BLOOM_BITS - 1)) != 0 || FAT32_DIR_CACHE_BLOOM_BITS < 32
+#error "FAT32_DIR_CACHE_BLOOM_BITS must be a power of two, at least 32"
+#endif
+
+typedef enum
+{
+    DIR_SLOT_NONE = 0, // индекс не строился
+    DIR_SLOT_BUILDING, // идёт построение
+    DIR_SLOT_READY,    // индекс построен и поддерживается
+    DIR_SLOT_OVERSIZED // каталог не помещается в бюджет
+} DirSlotState;
+
+typedef enum
+{
+    DIR_BLOOM_NONE = 0, // фильтр не заполнен
+    DIR_BLOOM_BUILDING, // идёт заполнение
+    DIR_BLOOM_READY,    // фильтр заполнен и поддерживается
+    DIR_BLOOM_FULL      // имён слишком много, фильтр ничего не отсекает
+} DirBloomState;
+
+typedef struct
+{
+    uint32_t cluster;   // первый кластер каталога (0 — слот свободен)
+    uint32_t last_used; // отметка времени последнего использования для LRU
+    Fat32DirIndexEntry *table;
+    uint32_t capacity; // количество ячеек table (степень двойки)
+    uint32_t used;     // занятые и удалённые ячейки
+    uint8_t state;
+    uint8_t free_known; // хвост и «дыры» каталога известны
+    uint8_t hole_count;
+    uint32_t last_cluster;
+    Fat32DirFreeRun tail;
+    Fat32DirFreeRun holes[FAT32_DIR_CACHE_HOLES];
+    uint8_t sfn_basis[11]; // основа короткого имени для подсказки хвоста
+    uint32_t sfn_next;     // первый заведомо свободный хвост (0 — подсказки нет)
+    uint8_t bloom_state;
+    uint32_t bloom_count; // количество добавленных в фильтр имён
+    uint32_t bloom[FAT32_DIR_CACHE_BLOOM_BITS / 32];
+} DirCacheSlot;
+
+static DirCacheSlot slots[FAT32_DIR_CACHE_SLOTS];
+static uint32_t cache_budget = FAT32_DIR_CACHE_DEFAULT_BUDGET;
+static uint32_t cache_memory = 0;
+static uint32_t cache_tick = 0;
+
+uint32_t fat32_name_hash(const char *name, uint32_t length)
+{
+    // FNV-1a по символам, приведённым к верхнему регистру так же, как при сравнении имён
+    uint32_t hash = 2166136261u;
+    for (uint32_t idx = 0; idx < length;)
+    {
+        uint32_t c = (uint8_t)name[idx];
+        if (c < 0x80)
+        {
+            if (c >= 'a' && c <= 'z')
+                c -= 'a' - 'A';
+            ++idx;
+        }
+        else
+        {
+            idx += fat32_utf8_upcase_char(name + idx, length - idx, &c);
+            hash ^= c >> 8;
+            hash *= 16777619u;
+        }
+        hash ^= c & 0xFF;
+        hash *= 16777619u;
+    }
+    if (hash <= DIR_INDEX_DELETED)
+        hash += 2;
+    return hash;
+}
+
+static void slot_free_table(DirCacheSlot *slot)
+{
+    if (slot->table != NULL)
+    {
+        fat32_free(slot->table, slot->capacity * sizeof(Fat32DirIndexEntry));
+        cache_memory -= slot->capacity * sizeof(Fat32DirIndexEntry);
+    }
+    slot->table = NULL;
+    slot->capacity = 0;
+    slot->used = 0;
+}
+
+static void slot_release(DirCacheSlot *slot)
+{
+    slot_free_table(slot);
+    memset(slot, 0, sizeof(DirCacheSlot));
+}
+
+static DirCacheSlot *slot_find(uint32_t dir_cluster)
+{
+    for (uint32_t idx = 0; idx < FAT32_DIR_CACHE_SLOTS; ++idx)
+    {
+        if (slots[idx].cluster == dir_cluster && dir_cluster != 0)
+        {
+            slots[idx].last_used = ++cache_tick;
+            return &slots[idx];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Возвращает слот каталога, при необходимости занимая свободный или вытесняя
+ * наименее давно использованный.
+ */
+static DirCacheSlot *slot_acquire(uint32_t dir_cluster)
+{
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot != NULL)
+        return slot;
+
+    DirCacheSlot *victim = &slots[0];
+    for (uint32_t idx = 0; idx < FAT32_DIR_CACHE_SLOTS; ++idx)
+    {
+        if (slots[idx].cluster == 0)
+        {
+            victim = &slots[idx];
+            break;
+        }
+        if (slots[idx].last_used < victim->last_used)
+            victim = &slots[idx];
+    }
+    slot_release(victim);
+    victim->cluster = dir_cluster;
+    victim->last_used = ++cache_tick;
+    return victim;
+}
+
+/**
+ * Освобождает индексы других каталогов (начиная с наименее давно использованных),
+ * пока в бюджете не появится bytes свободных байт.
+ */
+static int reserve_memory(const DirCacheSlot *owner, uint32_t bytes)
+{
+    if (bytes > cache_budget)
+        return -1;
+
+    while (cache_memory + bytes > cache_budget)
+    {
+        DirCacheSlot *victim = NULL;
+        for (uint32_t idx = 0; idx < FAT32_DIR_CACHE_SLOTS; ++idx)
+        {
+            if (&slots[idx] == owner || slots[idx].table == NULL)
+                continue;
+            if (victim == NULL || slots[idx].last_used < victim->last_used)
+                victim = &slots[idx];
+        }
+        if (victim == NULL)
+            return -1;
+        slot_free_table(victim);
+        victim->state = DIR_SLOT_NONE;
+    }
+    return 0;
+}
+
+static void table_insert(Fat32DirIndexEntry *table, uint32_t capacity, const Fat32DirIndexEntry *item)
+{
+    uint32_t mask = capacity - 1;
+    uint32_t idx = item->hash & mask;
+    while (table[idx].hash > DIR_INDEX_DELETED)
+        idx = (idx + 1) & mask;
+    table[idx] = *item;
+}
+
+/**
+ * Перестраивает таблицу слота с новой ёмкостью; удалённые ячейки при этом исчезают.
+ */
+static int slot_resize(DirCacheSlot *slot, uint32_t capacity)
+{
+    uint32_t bytes = capacity * sizeof(Fat32DirIndexEntry);
+    uint32_t old_bytes = slot->capacity * sizeof(Fat32DirIndexEntry);
+    if (reserve_memory(slot, bytes) != 0)
+        return -1;
+
+    Fat32DirIndexEntry *table = fat32_alloc(bytes);
+    if (table == NULL)
+        return -1;
+    cache_memory += bytes;
+
+    uint32_t used = 0;
+    for (uint32_t idx = 0; idx < slot->capacity; ++idx)
+    {
+        if (slot->table[idx].hash > DIR_INDEX_DELETED)
+        {
+            table_insert(table, capacity, &slot->table[idx]);
+            ++used;
+        }
+    }
+    if (slot->table != NULL)
+    {
+        fat32_free(slot->table, old_bytes);
+        cache_memory -= old_bytes;
+    }
+    slot->table = table;
+    slot->capacity = capacity;
+    slot->used = used;
+    return 0;
+}
+
+void fat32_dir_cache_set_budget(uint32_t bytes)
+{
+    cache_budget = bytes;
+    reserve_memory(NULL, 0);
+    // Каталоги, не помещавшиеся в прежний бюджет, могут поместиться в новый
+    for (uint32_t idx = 0; idx < FAT32_DIR_CACHE_SLOTS; ++idx)
+    {
+        if (slots[idx].state == DIR_SLOT_OVERSIZED)
+            slots[idx].state = DIR_SLOT_NONE;
+    }
+}
+
+void fat32_dir_cache_reset(void)
+{
+    for (uint32_t idx = 0; idx < FAT32_DIR_CACHE_SLOTS; ++idx)
+    {
+        slot_release(&slots[idx]);
+    }
+    cache_tick = 0;
+}
+
+int fat32_dir_cache_ready(uint32_t dir_cluster)
+{
+    if (cache_budget == 0)
+        return -1;
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || slot->state == DIR_SLOT_NONE)
+        return 0;
+    if (slot->state == DIR_SLOT_READY)
+        return 1;
+    return -1;
+}
+
+int fat32_dir_cache_build_begin(uint32_t dir_cluster)
+{
+    if (cache_budget == 0 || dir_cluster == 0)
+        return FAT32_ERR_ALLOC_FAILED;
+
+    DirCacheSlot *slot = slot_acquire(dir_cluster);
+    slot_free_table(slot);
+    if (slot_resize(slot, DIR_INDEX_MIN_CAPACITY) != 0)
+    {
+        slot->state = DIR_SLOT_OVERSIZED;
+        return FAT32_ERR_ALLOC_FAILED;
+    }
+    slot->state = DIR_SLOT_BUILDING;
+    return 0;
+}
+
+void fat32_dir_cache_build_end(uint32_t dir_cluster, int status)
+{
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || slot->state != DIR_SLOT_BUILDING)
+        return;
+    if (status != 0)
+    {
+        slot_free_table(slot);
+        slot->state = DIR_SLOT_NONE;
+        return;
+    }
+    slot->state = DIR_SLOT_READY;
+}
+
+/**
+ * Перебирает биты фильтра Блума для хеша имени (двойное хеширование).
+ *
+ * @return 1, если все биты установлены (при set — после их установки).
+ */
+static int bloom_probe(DirCacheSlot *slot, uint32_t hash, int set)
+{
+    uint32_t step = ((hash >> 16) | (hash << 16)) * 0x9E3779B1u | 1u;
+    for (uint32_t idx = 0; idx < DIR_BLOOM_HASHES; ++idx)
+    {
+        uint32_t bit = (hash + idx * step) & (FAT32_DIR_CACHE_BLOOM_BITS - 1);
+        if (set)
+            slot->bloom[bit / 32] |= (uint32_t)1 << (bit % 32);
+        else if ((slot->bloom[bit / 32] & ((uint32_t)1 << (bit % 32))) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+static void bloom_add(DirCacheSlot *slot, uint32_t hash)
+{
+    if (slot->bloom_state != DIR_BLOOM_READY && slot->bloom_state != DIR_BLOOM_BUILDING)
+        return;
+    if (slot->bloom_count >= DIR_BLOOM_MAX_NAMES)
+    {
+        slot->bloom_state = DIR_BLOOM_FULL;
+        return;
+    }
+    bloom_probe(slot, hash, 1);
+    ++slot->bloom_count;
+}
+
+void fat32_dir_cache_filter_begin(uint32_t dir_cluster)
+{
+    if (dir_cluster == 0)
+        return;
+    DirCacheSlot *slot = slot_acquire(dir_cluster);
+    memset(slot->bloom, 0, sizeof(slot->bloom));
+    slot->bloom_count = 0;
+    slot->bloom_state = DIR_BLOOM_BUILDING;
+}
+
+void fat32_dir_cache_filter_end(uint32_t dir_cluster, int status)
+{
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || slot->bloom_state != DIR_BLOOM_BUILDING)
+        return;
+    slot->bloom_state = (status == 0) ? DIR_BLOOM_READY : DIR_BLOOM_NONE;
+}
+
+int fat32_dir_cache_filter_test(uint32_t dir_cluster, uint32_t hash)
+{
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || slot->bloom_state == DIR_BLOOM_NONE || slot->bloom_state == DIR_BLOOM_BUILDING)
+        return FAT32_ERR_NOT_FOUND;
+    if (slot->bloom_state == DIR_BLOOM_FULL)
+        return 1;
+    return bloom_probe(slot, hash, 0);
+}
+
+void fat32_dir_cache_add(uint32_t dir_cluster, uint32_t hash, const DirEntryPosition *position, uint16_t entry_count)
+{
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || position == NULL)
+        return;
+    bloom_add(slot, hash);
+    if (slot->state != DIR_SLOT_READY && slot->state != DIR_SLOT_BUILDING)
+        return;
+
+    // Заполнение не более 3/4: при превышении таблица удваивается
+    if ((slot->used + 1) * 4 > slot->capacity * 3)
+    {
+        if (slot_resize(slot, slot->capacity * 2) != 0)
+        {
+            slot_free_table(slot);
+            slot->state = DIR_SLOT_OVERSIZED;
+            return;
+        }
+    }
+
+    Fat32DirIndexEntry item;
+    item.hash = hash;
+    item.cluster = position->cluster;
+    item.sector = (uint8_t)position->sector;
+    item.offset = (uint8_t)position->offset;
+    item.count = (uint8_t)entry_count;
+    item.reserved = 0;
+    table_insert(slot->table, slot->capacity, &item);
+    ++slot->used;
+}
+
+int fat32_dir_cache_find(uint32_t dir_cluster, uint32_t hash, uint32_t *cursor, DirEntryPosition *position, uint16_t *entry_count)
+{
+    if (cursor == NULL || position == NULL || entry_count == NULL)
+        return FAT32_ERR_INVALID_ARGUMENT;
+
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || slot->state != DIR_SLOT_READY)
+        return FAT32_ERR_NOT_FOUND;
+
+    // cursor хранит количество уже просмотренных ячеек цепочки пробирования
+    uint32_t mask = slot->capacity - 1;
+    while (*cursor < slot->capacity)
+    {
+        uint32_t idx = (hash + *cursor) & mask;
+        ++*cursor;
+        if (slot->table[idx].hash == DIR_INDEX_EMPTY)
+            break;
+        if (slot->table[idx].hash == hash)
+        {
+            position->cluster = slot->table[idx].cluster;
+            position->sector = slot->table[idx].sector;
+            position->offset = slot->table[idx].offset;
+            *entry_count = slot->table[idx].count;
+            return 1;
+        }
+    }
+    *cursor = slot->capacity;
+    return 0;
+}
+
+void fat32_dir_cache_remove(uint32_t dir_cluster, const DirEntryPosition *position)
+{
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || position == NULL || slot->table == NULL)
+        return;
+
+    for (uint32_t idx = 0; idx < slot->capacity; ++idx)
+    {
+        Fat32DirIndexEntry *item = &slot->table[idx];
+        if (item->hash > DIR_INDEX_DELETED && item->cluster == position->cluster &&
+            item->sector == position->sector && item->offset == position->offset)
+        {
+            item->hash = DIR_INDEX_DELETED;
+            return;
+        }
+    }
+}
+
+void fat32_dir_cache_invalidate(uint32_t dir_cluster)
+{
+    for (uint32_t idx = 0; idx < FAT32_DIR_CACHE_SLOTS; ++idx)
+    {
+        if (slots[idx].cluster == dir_cluster && dir_cluster != 0)
+        {
+            slot_release(&slots[idx]);
+        }
+    }
+}
+
+void fat32_dir_cache_set_tail(uint32_t dir_cluster, const Fat32DirFreeRun *tail, uint32_t last_cluster)
+{
+    if (dir_cluster == 0 || tail == NULL)
+        return;
+
+    DirCacheSlot *slot = slot_acquire(dir_cluster);
+    if (!slot->free_known)
+    {
+        slot->hole_count = 0;
+        slot->free_known = 1;
+    }
+    slot->tail = *tail;
+    slot->last_cluster = last_cluster;
+}
+
+int fat32_dir_cache_get_tail(uint32_t dir_cluster, Fat32DirFreeRun *tail, uint32_t *last_cluster)
+{
+    if (tail == NULL || last_cluster == NULL)
+        return FAT32_ERR_INVALID_ARGUMENT;
+
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || !slot->free_known)
+        return FAT32_ERR_NOT_FOUND;
+    *tail = slot->tail;
+    *last_cluster = slot->last_cluster;
+    return 0;
+}
+
+void fat32_dir_cache_add_hole(uint32_t dir_cluster, const Fat32DirFreeRun *hole)
+{
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || !slot->free_known || hole == NULL || hole->count == 0)
+        return;
+
+    if (slot->hole_count < FAT32_DIR_CACHE_HOLES)
+    {
+        slot->holes[slot->hole_count++] = *hole;
+        return;
+    }
+    uint32_t shortest = 0;
+    for (uint32_t idx = 1; idx < slot->hole_count; ++idx)
+    {
+        if (slot->holes[idx].count < slot->holes[shortest].count)
+            shortest = idx;
+    }
+    if (slot->holes[shortest].count < hole->count)
+        slot->holes[shortest] = *hole;
+}
+
+int fat32_dir_cache_take_hole(uint32_t dir_cluster, uint32_t entry_count, Fat32DirFreeRun *hole)
+{
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || !slot->free_known || hole == NULL)
+        return 0;
+
+    // Лучшее совпадение: самая короткая из подходящих «дыр»
+    uint32_t best = slot->hole_count;
+    for (uint32_t idx = 0; idx < slot->hole_count; ++idx)
+    {
+        if (slot->holes[idx].count >= entry_count &&
+            (best == slot->hole_count || slot->holes[idx].count < slot->holes[best].count))
+            best = idx;
+    }
+    if (best == slot->hole_count)
+        return 0;
+
+    *hole = slot->holes[best];
+    slot->holes[best] = slot->holes[--slot->hole_count];
+    return 1;
+}
+
+int fat32_dir_cache_take_sfn_tail(uint32_t dir_cluster, const uint8_t basis[11], uint32_t *number)
+{
+    DirCacheSlot *slot = slot_find(dir_cluster);
+    if (slot == NULL || basis == NULL || number == NULL || slot->sfn_next == 0 ||
+        memcmp(slot->sfn_basis, basis, sizeof(slot->sfn_basis)) != 0)
+        return 0;
+    *number = slot->sfn_next++;
+    return 1;
+}
+
+void fat32_dir_cache_set_sfn_tail(uint32_t dir_cluster, const uint8_t basis[11], uint32_t next)
+{
+    if (dir_cluster == 0 || basis == NULL)
+        return;
+    DirCacheSlot *slot = slot_acquire(dir_cluster);
+    memcpy(slot->sfn_basis, basis, sizeof(slot->sfn_basis));
+    slot->sfn_next = next;
+}
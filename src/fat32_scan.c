@@ -0,0 +1,335 @@
+#include "fat32/fat32_scan.h"
+
+#if !defined(FAT32_SCAN_SCALAR)
+#if defined(__AVX2__)
+#define FAT32_SCAN_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define FAT32_SCAN_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define FAT32_SCAN_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+/*
+ * Каждая векторная реализация предоставляет:
+ *   SCAN_LANES            - количество записей FAT в одном векторе;
+ *   scan_splat(v)         - вектор из одинаковых значений v;
+ *   scan_sequence(first)  - вектор first, first + 1, ..., first + SCAN_LANES - 1;
+ *   scan_vec_eq(a, b)     - битовая маска позиций a[i] == b[i];
+ *   scan_vec_and(v, m)    - поразрядное И каждой позиции с m;
+ *   scan_block_eq(p, exp) - битовая маска записей p[i] & FAT32_ENTRY_MASK == exp[i];
+ *   scan_dir_lanes(p, ..) - первый байт имени и атрибут SCAN_LANES записей каталога.
+ */
+#if defined(FAT32_SCAN_AVX2)
+
+#define SCAN_LANES 8
+#define SCAN_FULL_MASK 0xFFu
+typedef __m256i scan_vec_t;
+
+static inline scan_vec_t scan_splat(uint32_t value)
+{
+    return _mm256_set1_epi32((int)value);
+}
+
+static inline scan_vec_t scan_sequence(uint32_t first)
+{
+    return _mm256_add_epi32(_mm256_set1_epi32((int)first), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+static inline uint32_t scan_vec_eq(scan_vec_t value, scan_vec_t expected)
+{
+    return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(value, expected)));
+}
+
+static inline scan_vec_t scan_vec_and(scan_vec_t value, uint32_t mask)
+{
+    return _mm256_and_si256(value, _mm256_set1_epi32((int)mask));
+}
+
+static inline uint32_t scan_block_eq(const uint32_t *entries, scan_vec_t expected)
+{
+    __m256i value = _mm256_loadu_si256((const __m256i *)entries);
+    return scan_vec_eq(scan_vec_and(value, FAT32_ENTRY_MASK), expected);
+}
+
+// Первый байт имени и атрибут SCAN_LANES записей каталога (по одной записи в каждой позиции)
+static inline void scan_dir_lanes(const uint8_t *entries, scan_vec_t *name, scan_vec_t *attr)
+{
+    const __m256i offsets = _mm256_setr_epi32(0, 8, 16, 24, 32, 40, 48, 56);
+    __m256i word0 = _mm256_i32gather_epi32((const int *)entries, offsets, 4);
+    __m256i word2 = _mm256_i32gather_epi32((const int *)entries, _mm256_add_epi32(offsets, _mm256_set1_epi32(2)), 4);
+    *name = scan_vec_and(word0, 0xFF);
+    *attr = _mm256_srli_epi32(word2, 24);
+}
+
+#elif defined(FAT32_SCAN_SSE2)
+
+#define SCAN_LANES 4
+#define SCAN_FULL_MASK 0xFu
+typedef __m128i scan_vec_t;
+
+static inline scan_vec_t scan_splat(uint32_t value)
+{
+    return _mm_set1_epi32((int)value);
+}
+
+static inline scan_vec_t scan_sequence(uint32_t first)
+{
+    return _mm_add_epi32(_mm_set1_epi32((int)first), _mm_setr_epi32(0, 1, 2, 3));
+}
+
+static inline uint32_t scan_vec_eq(scan_vec_t value, scan_vec_t expected)
+{
+    return (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(value, expected)));
+}
+
+static inline scan_vec_t scan_vec_and(scan_vec_t value, uint32_t mask)
+{
+    return _mm_and_si128(value, _mm_set1_epi32((int)mask));
+}
+
+static inline uint32_t scan_block_eq(const uint32_t *entries, scan_vec_t expected)
+{
+    __m128i value = _mm_loadu_si128((const __m128i *)entries);
+    return scan_vec_eq(scan_vec_and(value, FAT32_ENTRY_MASK), expected);
+}
+
+// Транспонирование: слова 0 и 2 четырёх записей собираются в два вектора
+static inline void scan_dir_lanes(const uint8_t *entries, scan_vec_t *name, scan_vec_t *attr)
+{
+    __m128i e0 = _mm_loadu_si128((const __m128i *)(entries + 0));
+    __m128i e1 = _mm_loadu_si128((const __m128i *)(entries + 32));
+    __m128i e2 = _mm_loadu_si128((const __m128i *)(entries + 64));
+    __m128i e3 = _mm_loadu_si128((const __m128i *)(entries + 96));
+    __m128i word0 = _mm_unpacklo_epi64(_mm_unpacklo_epi32(e0, e1), _mm_unpacklo_epi32(e2, e3));
+    __m128i word2 = _mm_unpacklo_epi64(_mm_unpackhi_epi32(e0, e1), _mm_unpackhi_epi32(e2, e3));
+    *name = scan_vec_and(word0, 0xFF);
+    *attr = _mm_srli_epi32(word2, 24);
+}
+
+#elif defined(FAT32_SCAN_NEON)
+
+#define SCAN_LANES 4
+#define SCAN_FULL_MASK 0xFu
+typedef uint32x4_t scan_vec_t;
+
+static inline scan_vec_t scan_splat(uint32_t value)
+{
+    return vdupq_n_u32(value);
+}
+
+static inline scan_vec_t scan_sequence(uint32_t first)
+{
+    const uint32_t offsets[4] = {0, 1, 2, 3};
+    return vaddq_u32(vdupq_n_u32(first), vld1q_u32(offsets));
+}
+
+static inline uint32_t scan_vec_eq(scan_vec_t value, scan_vec_t expected)
+{
+    const uint32_t weights[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(vceqq_u32(value, expected), vld1q_u32(weights)));
+}
+
+static inline scan_vec_t scan_vec_and(scan_vec_t value, uint32_t mask)
+{
+    return vandq_u32(value, vdupq_n_u32(mask));
+}
+
+static inline uint32_t scan_block_eq(const uint32_t *entries, scan_vec_t expected)
+{
+    return scan_vec_eq(scan_vec_and(vld1q_u32(entries), FAT32_ENTRY_MASK), expected);
+}
+
+// Транспонирование: слова 0 и 2 четырёх записей собираются в два вектора
+static inline void scan_dir_lanes(const uint8_t *entries, scan_vec_t *name, scan_vec_t *attr)
+{
+    uint32x4_t e0 = vreinterpretq_u32_u8(vld1q_u8(entries + 0));
+    uint32x4_t e1 = vreinterpretq_u32_u8(vld1q_u8(entries + 32));
+    uint32x4_t e2 = vreinterpretq_u32_u8(vld1q_u8(entries + 64));
+    uint32x4_t e3 = vreinterpretq_u32_u8(vld1q_u8(entries + 96));
+    uint32x4x2_t z01 = vzipq_u32(e0, e1);
+    uint32x4x2_t z23 = vzipq_u32(e2, e3);
+    uint32x4_t word0 = vcombine_u32(vget_low_u32(z01.val[0]), vget_low_u32(z23.val[0]));
+    uint32x4_t word2 = vcombine_u32(vget_low_u32(z01.val[1]), vget_low_u32(z23.val[1]));
+    *name = scan_vec_and(word0, 0xFF);
+    *attr = vshrq_n_u32(word2, 24);
+}
+
+#endif
+
+uint32_t fat32_scan_find_free(const uint32_t *entries, uint32_t count)
+{
+    uint32_t idx = 0;
+    if (entries == NULL)
+        return count;
+#if defined(SCAN_LANES)
+    const scan_vec_t zero = scan_splat(FREE_CLUSTER);
+    for (; idx + SCAN_LANES <= count; idx += SCAN_LANES)
+    {
+        uint32_t bits = scan_block_eq(&entries[idx], zero);
+        if (bits != 0)
+            return idx + __builtin_ctz(bits);
+    }
+#endif
+    for (; idx < count; ++idx)
+    {
+        if ((entries[idx] & FAT32_ENTRY_MASK) == FREE_CLUSTER)
+            return idx;
+    }
+    return count;
+}
+
+uint32_t fat32_scan_find_used(const uint32_t *entries, uint32_t count)
+{
+    uint32_t idx = 0;
+    if (entries == NULL)
+        return count;
+#if defined(SCAN_LANES)
+    const scan_vec_t zero = scan_splat(FREE_CLUSTER);
+    for (; idx + SCAN_LANES <= count; idx += SCAN_LANES)
+    {
+        uint32_t bits = scan_block_eq(&entries[idx], zero);
+        if (bits != SCAN_FULL_MASK)
+            return idx + __builtin_ctz(~bits);
+    }
+#endif
+    for (; idx < count; ++idx)
+    {
+        if ((entries[idx] & FAT32_ENTRY_MASK) != FREE_CLUSTER)
+            return idx;
+    }
+    return count;
+}
+
+uint32_t fat32_scan_count_free(const uint32_t *entries, uint32_t count)
+{
+    uint32_t idx = 0;
+    uint32_t free_count = 0;
+    if (entries == NULL)
+        return 0;
+#if defined(SCAN_LANES)
+    const scan_vec_t zero = scan_splat(FREE_CLUSTER);
+    for (; idx + SCAN_LANES <= count; idx += SCAN_LANES)
+    {
+        free_count += __builtin_popcount(scan_block_eq(&entries[idx], zero));
+    }
+#endif
+    for (; idx < count; ++idx)
+    {
+        if ((entries[idx] & FAT32_ENTRY_MASK) == FREE_CLUSTER)
+            ++free_count;
+    }
+    return free_count;
+}
+
+uint32_t fat32_scan_free_run(const uint32_t *entries, uint32_t count, uint32_t *run_length)
+{
+    uint32_t start = fat32_scan_find_free(entries, count);
+    if (run_length != NULL)
+    {
+        *run_length = (start < count) ? fat32_scan_find_used(entries + start, count - start) : 0;
+    }
+    return start;
+}
+
+uint32_t fat32_scan_chain_run(const uint32_t *entries, uint32_t count, uint32_t first_cluster)
+{
+    uint32_t idx = 0;
+    if (entries == NULL)
+        return 0;
+#if defined(SCAN_LANES)
+    for (; idx + SCAN_LANES <= count; idx += SCAN_LANES)
+    {
+        uint32_t bits = scan_block_eq(&entries[idx], scan_sequence(first_cluster + idx + 1));
+        if (bits != SCAN_FULL_MASK)
+            return idx + __builtin_ctz(~bits);
+    }
+#endif
+    for (; idx < count; ++idx)
+    {
+        if ((entries[idx] & FAT32_ENTRY_MASK) != first_cluster + idx + 1)
+            return idx;
+    }
+    return count;
+}
+
+// Смещения полей в 32-байтной записи каталога
+#define DIR_ENTRY_SIZE 32
+#define DIR_ATTR_OFFSET 11
+#define DIR_ATTR_TYPE_MASK 0x3F
+
+/**
+ * Скалярная классификация одной записи, используется для хвоста группы и без SIMD.
+ */
+static void scan_dir_entry_scalar(const uint8_t *entry, uint32_t bit, uint8_t lfn_ord, uint8_t sfn_first, Fat32DirScanMask *mask)
+{
+    uint8_t name = entry[0];
+    uint8_t attr = entry[DIR_ATTR_OFFSET];
+    if (name == ENTRY_FREE_FULL_FAT32)
+    {
+        mask->end |= bit;
+    }
+    else if (name == ENTRY_FREE_FAT32)
+    {
+        mask->deleted |= bit;
+    }
+    else if ((attr & DIR_ATTR_TYPE_MASK) == ATTR_LONG_NAME)
+    {
+        mask->lfn |= bit;
+        if (lfn_ord != 0 && name == lfn_ord)
+            mask->candidates |= bit;
+    }
+    else if ((attr & ATTR_VOLUME_ID) == 0)
+    {
+        mask->sfn |= bit;
+        if (sfn_first != 0 && name == sfn_first)
+            mask->candidates |= bit;
+    }
+}
+
+void fat32_scan_dir_entries(const uint8_t *entries, uint32_t count, uint8_t lfn_ord, uint8_t sfn_first, Fat32DirScanMask *mask)
+{
+    if (mask == NULL)
+        return;
+    mask->end = mask->deleted = mask->lfn = mask->sfn = mask->candidates = 0;
+    if (entries == NULL)
+        return;
+    if (count > FAT32_SCAN_DIR_GROUP)
+        count = FAT32_SCAN_DIR_GROUP;
+
+    uint32_t idx = 0;
+#if defined(SCAN_LANES)
+    const scan_vec_t zero = scan_splat(ENTRY_FREE_FULL_FAT32);
+    const scan_vec_t deleted = scan_splat(ENTRY_FREE_FAT32);
+    const scan_vec_t long_name = scan_splat(ATTR_LONG_NAME);
+    const scan_vec_t volume = scan_splat(ATTR_VOLUME_ID);
+    // Нулевой ожидаемый символ не совпадает ни с одной действующей записью
+    const scan_vec_t ord = scan_splat(lfn_ord != 0 ? lfn_ord : 0x100);
+    const scan_vec_t first = scan_splat(sfn_first != 0 ? sfn_first : 0x100);
+    scan_vec_t name, attr;
+
+    for (; idx + SCAN_LANES <= count; idx += SCAN_LANES)
+    {
+        scan_dir_lanes(entries + idx * DIR_ENTRY_SIZE, &name, &attr);
+        uint32_t end = scan_vec_eq(name, zero);
+        uint32_t del = scan_vec_eq(name, deleted);
+        uint32_t live = ~(end | del) & SCAN_FULL_MASK;
+        uint32_t lfn = scan_vec_eq(scan_vec_and(attr, DIR_ATTR_TYPE_MASK), long_name) & live;
+        uint32_t sfn = ~scan_vec_eq(scan_vec_and(attr, ATTR_VOLUME_ID), volume) & live & ~lfn;
+        uint32_t cand = (scan_vec_eq(name, ord) & lfn) | (scan_vec_eq(name, first) & sfn);
+
+        mask->end |= end << idx;
+        mask->deleted |= del << idx;
+        mask->lfn |= lfn << idx;
+        mask->sfn |= (sfn & SCAN_FULL_MASK) << idx;
+        mask->candidates |= cand << idx;
+    }
+#endif
+    for (; idx < count; ++idx)
+    {
+        scan_dir_entry_scalar(entries + idx * DIR_ENTRY_SIZE, (uint32_t)1 << idx, lfn_ord, sfn_first, mask);
+    }
+}
@@ -5,6 +5,159 @@
 #include "fat32/fat32_alloc.h"
 #include "fat32/log_fat32.h"
 
+#if !defined(FAT32_SCAN_SCALAR)
+#if defined(__SSE2__)
+#define FAT32_UTF_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define FAT32_UTF_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+// Размер блока быстрого пути ASCII при перекодировании имён
+#define UTF_ASCII_BLOCK 16
+
+/**
+ * Расширяет блок из UTF_ASCII_BLOCK байт до UTF-16, если все байты — ASCII.
+ *
+ * @return 1 — блок перекодирован, 0 — в блоке есть не-ASCII байты (dst не изменён).
+ */
+static inline int ascii_block_widen(const uint8_t *src, uint16_t *dst)
+{
+#if defined(FAT32_UTF_SSE2)
+    __m128i bytes = _mm_loadu_si128((const __m128i *)src);
+    if (_mm_movemask_epi8(bytes) != 0)
+        return 0;
+    __m128i zero = _mm_setzero_si128();
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi8(bytes, zero));
+    _mm_storeu_si128((__m128i *)(dst + 8), _mm_unpackhi_epi8(bytes, zero));
+    return 1;
+#elif defined(FAT32_UTF_NEON)
+    uint8x16_t bytes = vld1q_u8(src);
+    if (vmaxvq_u8(bytes) >= 0x80)
+        return 0;
+    vst1q_u16(dst, vmovl_u8(vget_low_u8(bytes)));
+    vst1q_u16(dst + 8, vmovl_u8(vget_high_u8(bytes)));
+    return 1;
+#else
+    uint64_t words[2];
+    memcpy(words, src, sizeof(words));
+    if (((words[0] | words[1]) & 0x8080808080808080ull) != 0)
+        return 0;
+    for (int idx = 0; idx < UTF_ASCII_BLOCK; ++idx)
+        dst[idx] = src[idx];
+    return 1;
+#endif
+}
+
+/**
+ * Сужает блок из UTF_ASCII_BLOCK символов UTF-16 до байтов, если все символы —
+ * ASCII без завершающего нуля.
+ *
+ * @return 1 — блок перекодирован, 0 — в блоке есть не-ASCII символ или 0 (dst не изменён).
+ */
+static inline int ascii_block_narrow(const uint16_t *src, uint8_t *dst)
+{
+#if defined(FAT32_UTF_SSE2)
+    __m128i low = _mm_loadu_si128((const __m128i *)src);
+    __m128i high = _mm_loadu_si128((const __m128i *)(src + 8));
+    __m128i zero = _mm_setzero_si128();
+    __m128i over = _mm_and_si128(_mm_or_si128(low, high), _mm_set1_epi16((short)0xFF80));
+    __m128i nul = _mm_or_si128(_mm_cmpeq_epi16(low, zero), _mm_cmpeq_epi16(high, zero));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(over, zero)) != 0xFFFF || _mm_movemask_epi8(nul) != 0)
+        return 0;
+    _mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(low, high));
+    return 1;
+#elif defined(FAT32_UTF_NEON)
+    uint16x8_t low = vld1q_u16(src);
+    uint16x8_t high = vld1q_u16(src + 8);
+    if (vmaxvq_u16(vmaxq_u16(low, high)) >= 0x80 || vminvq_u16(vminq_u16(low, high)) == 0)
+        return 0;
+    vst1q_u8(dst, vcombine_u8(vmovn_u16(low), vmovn_u16(high)));
+    return 1;
+#else
+    for (int idx = 0; idx < UTF_ASCII_BLOCK; ++idx)
+    {
+        if (src[idx] == 0 || src[idx] >= 0x80)
+            return 0;
+    }
+    for (int idx = 0; idx < UTF_ASCII_BLOCK; ++idx)
+        dst[idx] = (uint8_t)src[idx];
+    return 1;
+#endif
+}
+
+/**
+ * Декодирует один символ UTF-8.
+ *
+ * Отвергаются обрывы последовательности, избыточные (overlong) формы,
+ * суррогаты и значения больше U+10FFFF.
+ *
+ * @param text Начало последовательности.
+ * @param available Количество доступных байт.
+ * @param code_point [out] Кодовая точка.
+ * @return Длина последовательности (1..4) или 0, если она некорректна.
+ */
+static uint8_t utf8_decode(const uint8_t *text, uint32_t available, uint32_t *code_point)
+{
+    static const uint32_t min_value[5] = {0, 0, 0x80, 0x800, 0x10000};
+    uint8_t first = text[0];
+    uint8_t length = 0;
+    uint32_t value = 0;
+
+    if (first < 0x80)
+    {
+        *code_point = first;
+        return 1;
+    }
+    if ((first & 0xE0) == 0xC0)
+    {
+        length = 2;
+        value = first & 0x1F;
+    }
+    else if ((first & 0xF0) == 0xE0)
+    {
+        length = 3;
+        value = first & 0x0F;
+    }
+    else if ((first & 0xF8) == 0xF0)
+    {
+        length = 4;
+        value = first & 0x07;
+    }
+    else
+    {
+        return 0;
+    }
+    if (length > available)
+        return 0;
+    for (uint8_t idx = 1; idx < length; ++idx)
+    {
+        if ((text[idx] & 0xC0) != 0x80)
+            return 0;
+        value = (value << 6) | (text[idx] & 0x3F);
+    }
+    if (value < min_value[length] || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF))
+        return 0;
+    *code_point = value;
+    return length;
+}
+
+/**
+ * Проверяет не-ASCII символ имени: допустима только корректная последовательность UTF-8.
+ *
+ * @return Длина последовательности или 0.
+ */
+static uint8_t utf8_name_char(const char *text)
+{
+    uint32_t code_point = 0;
+    uint32_t available = 0;
+    while (available < 4 && text[available] != '\0')
+        ++available;
+    return utf8_decode((const uint8_t *)text, available, &code_point);
+}
+
 
 /**
  * Проверяет, что сегмент пути или имени файла содержит только допустимые символы.
@@ -21,6 +174,15 @@ int is_valid_segment(const char *seg, int allow_dot)
 
     for (int i = 0; seg[i]; i++)
     {
+        if ((unsigned char)seg[i] >= 0x80)
+        {
+            // Символы вне ASCII допустимы в длинных именах в кодировке UTF-8
+            uint8_t length = utf8_name_char(&seg[i]);
+            if (length == 0)
+                return -1;
+            i += length - 1;
+            continue;
+        }
         if (!(isalnum((unsigned char)seg[i]) || seg[i] == '-' || seg[i] == '_' || (allow_dot && seg[i] == '.')))
         {
             return -1;
@@ -59,8 +221,21 @@ int validate_path(const char *path)
 {
     if (!path || *path != '/')
         return 0;
+    // Корневой каталог
+    if (path[1] == '\0')
+        return 0;
 
-    const char *p = path + 1;
+    return validate_relative_path(path + 1);
+}
+
+int validate_relative_path(const char *path)
+{
+    if (!path)
+        return FAT_ERR_NULL;
+    if (*path == '\0')
+        return FAT_ERR_EMPTY;
+
+    const char *p = path;
     char segment[256];
     int len = 0;
     int status = 0;
@@ -151,10 +326,18 @@ int validate_fat_lfn_file(const char *name)
     if (ext_len > 5 || ext_len == 0)
         return -2;
 
-    // Проверка допустимых символов в имени и расширении (A-Z, a-z, 0-9, _, -)
+    // Проверка допустимых символов в имени и расширении (A-Z, a-z, 0-9, _, -, UTF-8)
     for (int i = 0; i < name_len; i++)
     {
         char c = name[i];
+        if ((unsigned char)c >= 0x80)
+        {
+            uint8_t length = utf8_name_char(&name[i]);
+            if (length == 0 || i + length > name_len)
+                return -3;
+            i += length - 1;
+            continue;
+        }
         if (!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
               (c >= '0' && c <= '9') || c == '_' || c == '-'))
             return -3;
@@ -206,6 +389,14 @@ int validate_fat_lfn_dir(const char *name)
     for (int i = 0; i < len; i++)
     {
         char c = name[i];
+        if ((unsigned char)c >= 0x80)
+        {
+            uint8_t length = utf8_name_char(&name[i]);
+            if (length == 0)
+                return -3;
+            i += length - 1;
+            continue;
+        }
         if (!((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
               (c >= '0' && c <= '9') || c == '_' || c == '-'))
             return -3;
@@ -214,75 +405,99 @@ int validate_fat_lfn_dir(const char *name)
     return 0;
 }
 
+void fat32_path_iter_init(Fat32PathIter *iter, const char *path, uint32_t length)
+{
+    if (iter == NULL)
+        return;
+    iter->cursor = path;
+    iter->end = (path != NULL) ? path + length : NULL;
+}
+
+int fat32_path_iter_next(Fat32PathIter *iter, const char **name, uint32_t *length)
+{
+    if (iter == NULL || iter->cursor == NULL)
+        return 0;
+
+    const char *p = iter->cursor;
+    while (p < iter->end && *p == '/')
+        ++p;
+    if (p >= iter->end || *p == '\0')
+    {
+        iter->cursor = iter->end;
+        return 0;
+    }
+
+    const char *start = p;
+    while (p < iter->end && *p != '/' && *p != '\0')
+        ++p;
+
+    iter->cursor = p;
+    if (name != NULL)
+        *name = start;
+    if (length != NULL)
+        *length = p - start;
+    return 1;
+}
+
+int fat32_path_split(const char *path, uint32_t length, uint32_t *parent_length, const char **name, uint32_t *name_length)
+{
+    if (path == NULL || parent_length == NULL || name == NULL || name_length == NULL)
+        return FAT32_ERR_INVALID_ARGUMENT;
+
+    // Завершающие '/' не относятся к имени
+    while (length > 1 && path[length - 1] == '/')
+        --length;
+
+    uint32_t idx = length;
+    while (idx > 0 && path[idx - 1] != '/')
+        --idx;
+
+    if (idx == 0 || idx == length)
+        return FAT32_ERR_INVALID_PATH;
+
+    *parent_length = idx;
+    *name = path + idx;
+    *name_length = length - idx;
+    return 0;
+}
+
 int fat32_path_depth(const char *path)
 {
     if (path == NULL)
         return FAT32_ERR_INVALID_ARGUMENT;
-    uint32_t len = strlen(path);
-    char *buff = fat32_alloc(len + 1);
-    if (buff == NULL)
-    {
-        return FAT32_ERR_ALLOC_FAILED;
-    }
-    memcpy(buff, path, len + 1);
-    char *token = strtok(buff, "/");
+
+    Fat32PathIter iter;
+    fat32_path_iter_init(&iter, path, strlen(path));
     int depth = 0;
-    while (token != NULL)
+    while (fat32_path_iter_next(&iter, NULL, NULL))
     {
         ++depth;
-        token = strtok(NULL, "/");
-    }
-    if (fat32_free(buff, len + 1) != 0)
-    {
-        FAT32_LOG_ERROR("Failed to free memory region at %p, size %d", (void *)buff, len + 1);
     }
     return depth;
 }
 
-
 int fat32_parse_path(const char *path, char (*name_files)[MAX_NAME_SIZE])
 {
     if (path == NULL || name_files == NULL)
         return FAT32_ERR_INVALID_ARGUMENT;
 
-    int status = 0;
-    const size_t path_len = strlen(path);
-    char *buff = fat32_alloc(path_len + 1);
-    if (buff == NULL)
-    {
-        status = FAT32_ERR_ALLOC_FAILED;
-        goto cleanup;
-    }
-
-    memcpy(buff, path, path_len);
-    buff[path_len] = '\0';
-
-    char *token = strtok(buff, "/");
+    Fat32PathIter iter;
+    const char *token = NULL;
+    uint32_t token_len = 0;
     int idxWord = 0;
-    size_t token_len = 0;
 
-    while (token != NULL)
+    fat32_path_iter_init(&iter, path, strlen(path));
+    while (fat32_path_iter_next(&iter, &token, &token_len))
     {
-        token_len = strlen(token);
         if (token_len >= MAX_NAME_SIZE)
         {
-            status = FAT32_ERR_NAME_TOO_LONG;
-            goto cleanup;
+            return FAT32_ERR_NAME_TOO_LONG;
         }
-        memcpy(name_files[idxWord++], token, token_len + 1);
-        token = strtok(NULL, "/");
+        memcpy(name_files[idxWord], token, token_len);
+        name_files[idxWord][token_len] = '\0';
+        ++idxWord;
     }
-
-cleanup:
-    if (buff != NULL)
-    {
-        if (fat32_free(buff, path_len + 1) != 0)
-        {
-            FAT32_LOG_ERROR("Failed to free path buffer at %p", (void *)buff);
-        }
-    }
-
-    return (status == 0) ? idxWord : status;
+    return idxWord;
 }
 
 char *fat32_find_last_char(char *text, char symbol)
@@ -314,15 +529,15 @@ void fat32_format_sfn(const char *input, uint16_t length, char output[11])
     for (idx = 0; idx < 11; ++idx)
         output[idx] = ' ';
 
-    for (idx = 0; idx < 8 && input[idx] != '.' && idx < length; ++idx)
+    for (idx = 0; idx < 8 && idx < length && input[idx] != '.'; ++idx)
     {
-        output[idx] = toupper(input[idx]);
+        output[idx] = toupper((unsigned char)input[idx]);
     }
-    if (input[idx] == '.' && idx < length)
+    if (idx < length && input[idx] == '.')
     {
-        for (int j = 8; j < 11; ++j)
+        for (int j = 8; j < 11 && ++idx < length; ++j)
         {
-            output[j] = toupper(input[++idx]);
+            output[j] = toupper((unsigned char)input[idx]);
         }
     }
 }
@@ -337,55 +552,248 @@ int fat32_is_special_dir(const uint8_t dir_name[11])
     return -1;
 }
 
-int fat32_compare_lfn(const char *name_ascii, const uint16_t *name_unicode)
+/*
+ * Таблица верхнего регистра BMP: латиница (включая расширения A и Additional),
+ * греческий, кириллица, армянский и полноширинная латиница. delta != 0 — символ
+ * диапазона переводится сдвигом, delta == 0 — диапазон из пар «заглавная, строчная»,
+ * начинающийся с заглавной.
+ */
+typedef struct
 {
-    uint8_t buffer[MAX_NAME_SIZE];
-    memset(buffer, 0, MAX_NAME_SIZE);
-    fat32_utf16le_to_ascii(name_unicode, (char *)buffer);
-    uint32_t length = strlen(name_ascii);
-    if (length != strlen((const char *)buffer))
+    uint16_t first;
+    uint16_t last;
+    int16_t delta;
+} UpcaseRange;
+
+static const UpcaseRange upcase_ranges[] = {
+    {0x00E0, 0x00F6, -32}, {0x00F8, 0x00FE, -32}, {0x00FF, 0x00FF, 121}, {0x0100, 0x012F, 0},
+    {0x0132, 0x0137, 0},   {0x0139, 0x0148, 0},   {0x014A, 0x0177, 0},   {0x0179, 0x017E, 0},
+    {0x03AC, 0x03AC, -38}, {0x03AD, 0x03AF, -37}, {0x03B1, 0x03C1, -32}, {0x03C2, 0x03C2, -31},
+    {0x03C3, 0x03CB, -32}, {0x03CC, 0x03CC, -64}, {0x03CD, 0x03CE, -63}, {0x0430, 0x044F, -32},
+    {0x0450, 0x045F, -80}, {0x0460, 0x0481, 0},   {0x048A, 0x04BF, 0},   {0x04C1, 0x04CE, 0},
+    {0x04CF, 0x04CF, -15}, {0x04D0, 0x052F, 0},   {0x0561, 0x0586, -48}, {0x1E00, 0x1E95, 0},
+    {0x1EA0, 0x1EFF, 0},   {0xFF41, 0xFF5A, -32},
+};
+
+uint16_t fat32_upcase(uint16_t c)
+{
+    if (c < 0x80)
+        return (c >= 'a' && c <= 'z') ? (uint16_t)(c - ('a' - 'A')) : c;
+    for (uint32_t idx = 0; idx < sizeof(upcase_ranges) / sizeof(upcase_ranges[0]); ++idx)
     {
-        return -1;
+        const UpcaseRange *range = &upcase_ranges[idx];
+        if (c < range->first)
+            break;
+        if (c > range->last)
+            continue;
+        if (range->delta != 0)
+            return (uint16_t)(c + range->delta);
+        return ((c - range->first) & 1) ? (uint16_t)(c - 1) : c;
     }
+    return c;
+}
+
+uint8_t fat32_utf8_upcase_char(const char *text, uint32_t available, uint32_t *upper)
+{
+    uint32_t code_point = 0;
+    uint8_t length = utf8_decode((const uint8_t *)text, available, &code_point);
+    if (length == 0)
+    {
+        // Некорректный байт учитывается как есть
+        *upper = (uint8_t)text[0];
+        return 1;
+    }
+    *upper = (code_point <= 0xFFFF) ? fat32_upcase((uint16_t)code_point) : code_point;
+    return length;
+}
+
+/**
+ * Сравнивает два символа UTF-16 без учёта регистра (fat32_upcase).
+ *
+ * @return 0 если символы совпадают, иначе != 0
+ */
+static int lfn_char_differs(uint16_t c, uint16_t unicode)
+{
+    if (unicode == c)
+        return 0;
+    return fat32_upcase(c) != fat32_upcase(unicode);
+}
 
-    for (int idx = 0; idx < length; ++idx)
+int fat32_compare_lfn(const char *name_ascii, uint32_t length, const uint16_t *name_unicode)
+{
+    for (uint32_t idx = 0; idx < length; ++idx)
     {
-        if (name_ascii[idx] != buffer[idx])
+        if (lfn_char_differs((uint8_t)name_ascii[idx], name_unicode[idx]))
         {
             return -1;
         }
     }
+    // Имя в LFN завершается нулём, если не занимает последнюю запись целиком
+    if (length < MAX_NAME_SIZE && name_unicode[length] != 0x0000 && name_unicode[length] != 0xFFFF)
+    {
+        return -1;
+    }
     return 0;
 }
 
-void fat32_generate_sfn_from_lfn(const char *name, uint32_t length, uint8_t buffer[11])
+int fat32_compare_lfn_fragment(const uint16_t *name, uint32_t length, const LDIR_Type *entry)
 {
-    if (name == NULL || buffer == NULL)
+    uint8_t order = entry->LDIR_Ord & ~LFN_ENTRY_LAST;
+    if (order == 0 || order > (MAX_NAME_SIZE + LFN_NAME_LENGTH - 1) / LFN_NAME_LENGTH)
+        return -1;
+
+    // Символы фрагмента лежат в трёх полях записи подряд, по 2 байта (little-endian)
+    const uint8_t *fields[3] = {entry->LDIR_Name1, entry->LDIR_Name2, entry->LDIR_Name3};
+    const uint8_t counts[3] = {sizeof(entry->LDIR_Name1) / 2, sizeof(entry->LDIR_Name2) / 2, sizeof(entry->LDIR_Name3) / 2};
+    uint32_t position = (order - 1) * LFN_NAME_LENGTH;
+
+    if (position >= length)
+        return -1;
+
+    for (uint8_t field = 0; field < 3; ++field)
     {
-        return;
+        for (uint8_t idx = 0; idx < counts[field]; ++idx, ++position)
+        {
+            uint16_t unicode = fields[field][idx * 2] | (uint16_t)(fields[field][idx * 2 + 1] << 8);
+            if (position < length)
+            {
+                if (lfn_char_differs(name[position], unicode))
+                    return -1;
+            }
+            else
+            {
+                // Имя кончается в последнем фрагменте завершающим нулём
+                return ((entry->LDIR_Ord & LFN_ENTRY_LAST) != 0 && unicode == 0x0000) ? 0 : -1;
+            }
+        }
     }
+    // Последний фрагмент заполнен целиком: имя должно кончаться ровно на нём
+    return ((entry->LDIR_Ord & LFN_ENTRY_LAST) != 0 && position < length) ? -1 : 0;
+}
 
-    memset(buffer, ' ', SHORT_NAME_SIZE);
-    char *dot = fat32_find_last_char(name, '.');
-
-    uint16_t ext_len = (dot != NULL ? (name + length) - dot : 0);
-    uint16_t base_len = (dot != NULL ? (length - (dot - name + 1)) : 0);
-    uint16_t idx = 0;
+/**
+ * Приводит символ длинного имени к символу короткого имени.
+ *
+ * @return Символ в верхнем регистре, '_' для недопустимых в SFN символов,
+ *         0 для символов, которые в SFN пропускаются (пробел, точка, байты
+ *         продолжения UTF-8).
+ */
+static uint8_t sfn_char(uint8_t c)
+{
+    if (c == ' ' || c == '.')
+        return 0;
+    // Символ UTF-8 вне ASCII заменяется одним '_' по его первому байту
+    if (c >= 0x80)
+        return (c >= 0xC0) ? '_' : 0;
+    if (c >= 'a' && c <= 'z')
+        return c - ('a' - 'A');
+    if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+        return c;
+    if (c < 0x80 && strchr("$%'-_@~`!(){}^#&", c) != NULL)
+        return c;
+    return '_';
+}
 
-    for (idx = 0; idx < LFN_SHORT_NAME && idx < base_len; ++idx)
+uint8_t fat32_sfn_basis(const char *name, uint32_t length, uint8_t buffer[11])
+{
+    if (name == NULL || buffer == NULL)
     {
-        if (!(isalpha(buffer[idx]) || isdigit(buffer[idx])))
-            buffer[idx] = toupper(name[idx]);
+        return 0;
     }
-    buffer[6] = '~';
-    buffer[7] = '1';
-    if (dot != NULL && ext_len > 0)
+    memset(buffer, ' ', SHORT_NAME_SIZE);
+
+    // Ведущие точки не начинают расширение
+    uint32_t start = 0;
+    while (start < length && name[start] == '.')
+        ++start;
+    uint32_t dot = length;
+    for (uint32_t idx = length; idx > start; --idx)
     {
-        for (idx = 0; idx < 3 && idx < ext_len; ++idx)
+        if (name[idx - 1] == '.')
         {
-            buffer[8 + idx] = toupper(dot[1 + idx]);
+            dot = idx - 1;
+            break;
         }
     }
+
+    uint8_t base_len = 0;
+    for (uint32_t idx = start; idx < dot && base_len < 8; ++idx)
+    {
+        uint8_t c = sfn_char((uint8_t)name[idx]);
+        if (c != 0)
+            buffer[base_len++] = c;
+    }
+    if (base_len == 0)
+    {
+        buffer[base_len++] = '_';
+    }
+
+    uint8_t ext_len = 0;
+    for (uint32_t idx = dot + 1; idx < length && ext_len < 3; ++idx)
+    {
+        uint8_t c = sfn_char((uint8_t)name[idx]);
+        if (c != 0)
+            buffer[8 + ext_len++] = c;
+    }
+    return base_len;
+}
+
+void fat32_sfn_set_tail(uint8_t buffer[11], uint8_t base_len, uint32_t number)
+{
+    char digits[8];
+    uint8_t count = 0;
+    do
+    {
+        digits[count++] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0 && count < 7);
+
+    uint8_t prefix = base_len;
+    if (prefix > 7 - count)
+        prefix = 7 - count;
+    buffer[prefix++] = '~';
+    while (count > 0)
+        buffer[prefix++] = digits[--count];
+    while (prefix < 8)
+        buffer[prefix++] = ' ';
+}
+
+uint32_t fat32_sfn_tail_number(const uint8_t sfn[11], const uint8_t basis[11], uint8_t base_len)
+{
+    if (memcmp(&sfn[8], &basis[8], 3) != 0)
+        return 0;
+
+    uint8_t tilde = 0;
+    while (tilde < 8 && sfn[tilde] != '~')
+        ++tilde;
+    if (tilde == 0 || tilde >= 7 || tilde > base_len || memcmp(sfn, basis, tilde) != 0)
+        return 0;
+
+    uint32_t number = 0;
+    uint8_t idx = tilde + 1;
+    for (; idx < 8 && sfn[idx] >= '0' && sfn[idx] <= '9'; ++idx)
+        number = number * 10 + (sfn[idx] - '0');
+    uint8_t count = idx - tilde - 1;
+    if (count == 0 || sfn[tilde + 1] == '0')
+        return 0;
+    for (; idx < 8; ++idx)
+    {
+        if (sfn[idx] != ' ')
+            return 0;
+    }
+    // Префикс обрезается, только чтобы уместить хвост
+    uint8_t expected = base_len < 7 - count ? base_len : 7 - count;
+    return tilde == expected ? number : 0;
+}
+
+void fat32_generate_sfn_from_lfn(const char *name, uint32_t length, uint8_t buffer[11])
+{
+    if (name == NULL || buffer == NULL)
+    {
+        return;
+    }
+    uint8_t base_len = fat32_sfn_basis(name, length, buffer);
+    fat32_sfn_set_tail(buffer, base_len, 1);
 }
 
 uint8_t fat32_sfn_checksum(const uint8_t *pFcbName)
@@ -402,6 +810,116 @@ uint8_t fat32_sfn_checksum(const uint8_t *pFcbName)
 }
 
 
+int fat32_utf8_to_utf16le(const char *utf8, uint32_t length, uint16_t *utf16, uint32_t capacity)
+{
+    if (utf8 == NULL)
+        return FAT_ERR_NULL;
+
+    const uint8_t *text = (const uint8_t *)utf8;
+    uint16_t block[UTF_ASCII_BLOCK];
+    uint32_t count = 0;
+    uint32_t idx = 0;
+
+    while (idx < length)
+    {
+        // Быстрый путь: блок ASCII перекодируется целиком
+        if (idx + UTF_ASCII_BLOCK <= length && count + UTF_ASCII_BLOCK <= capacity &&
+            ascii_block_widen(&text[idx], utf16 != NULL ? &utf16[count] : block))
+        {
+            idx += UTF_ASCII_BLOCK;
+            count += UTF_ASCII_BLOCK;
+            continue;
+        }
+
+        uint32_t code_point = 0;
+        uint8_t size = utf8_decode(&text[idx], length - idx, &code_point);
+        if (size == 0)
+            return FAT_ERR_INVALID_CHAR;
+        uint32_t units = (code_point >= 0x10000) ? 2 : 1;
+        if (count + units > capacity)
+            return FAT_ERR_TOO_LONG;
+        if (utf16 != NULL)
+        {
+            if (units == 2)
+            {
+                code_point -= 0x10000;
+                utf16[count] = 0xD800 | (code_point >> 10);
+                utf16[count + 1] = 0xDC00 | (code_point & 0x3FF);
+            }
+            else
+            {
+                utf16[count] = (uint16_t)code_point;
+            }
+        }
+        count += units;
+        idx += size;
+    }
+    return (int)count;
+}
+
+int fat32_utf16le_to_utf8(const uint16_t *utf16, uint32_t count, char *utf8, uint32_t capacity)
+{
+    if (utf16 == NULL || utf8 == NULL || capacity == 0)
+        return FAT_ERR_NULL;
+
+    uint8_t *text = (uint8_t *)utf8;
+    uint32_t size = 0;
+    uint32_t idx = 0;
+
+    while (idx < count && utf16[idx] != 0x0000 && utf16[idx] != 0xFFFF)
+    {
+        if (idx + UTF_ASCII_BLOCK <= count && size + UTF_ASCII_BLOCK < capacity &&
+            ascii_block_narrow(&utf16[idx], &text[size]))
+        {
+            idx += UTF_ASCII_BLOCK;
+            size += UTF_ASCII_BLOCK;
+            continue;
+        }
+
+        uint32_t code_point = utf16[idx++];
+        if (code_point >= 0xD800 && code_point <= 0xDBFF && idx < count &&
+            utf16[idx] >= 0xDC00 && utf16[idx] <= 0xDFFF)
+        {
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (utf16[idx++] - 0xDC00);
+        }
+        else if (code_point >= 0xD800 && code_point <= 0xDFFF)
+        {
+            // Одиночный суррогат не представим в UTF-8
+            code_point = '?';
+        }
+
+        uint32_t bytes = (code_point < 0x80) ? 1 : (code_point < 0x800) ? 2 : (code_point < 0x10000) ? 3 : 4;
+        if (size + bytes >= capacity)
+        {
+            text[size] = '\0';
+            return FAT_ERR_TOO_LONG;
+        }
+        switch (bytes)
+        {
+        case 1:
+            text[size++] = (uint8_t)code_point;
+            break;
+        case 2:
+            text[size++] = 0xC0 | (code_point >> 6);
+            text[size++] = 0x80 | (code_point & 0x3F);
+            break;
+        case 3:
+            text[size++] = 0xE0 | (code_point >> 12);
+            text[size++] = 0x80 | ((code_point >> 6) & 0x3F);
+            text[size++] = 0x80 | (code_point & 0x3F);
+            break;
+        default:
+            text[size++] = 0xF0 | (code_point >> 18);
+            text[size++] = 0x80 | ((code_point >> 12) & 0x3F);
+            text[size++] = 0x80 | ((code_point >> 6) & 0x3F);
+            text[size++] = 0x80 | (code_point & 0x3F);
+            break;
+        }
+    }
+    text[size] = '\0';
+    return (int)size;
+}
+
 void fat32_ascii_to_utf16le(const char *ascii_str, uint8_t *utf16le_buf)
 {
     while (*ascii_str)
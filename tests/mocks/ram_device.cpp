@@ -0,0 +1,85 @@
+#include "ram_device.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+// Носитель хранится участками: незаписанные участки читаются как нули
+static const uint32_t RAM_DEVICE_CHUNK = 64 * 1024;
+static uint8_t *chunks[RAM_DEVICE_CAPACITY / RAM_DEVICE_CHUNK];
+
+static uint8_t *chunk_at(uint64_t offset, bool create)
+{
+    uint64_t idx = offset / RAM_DEVICE_CHUNK;
+    if (idx >= sizeof(chunks) / sizeof(chunks[0]))
+        return NULL;
+    if (chunks[idx] == NULL)
+    {
+        if (!create)
+            return NULL;
+        chunks[idx] = (uint8_t *)calloc(1, RAM_DEVICE_CHUNK);
+        if (chunks[idx] == NULL)
+            return NULL;
+    }
+    return chunks[idx] + offset % RAM_DEVICE_CHUNK;
+}
+
+static int read_ram(uint8_t *buffer, uint32_t count, uint32_t sector, uint32_t sector_size)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t *data = chunk_at((uint64_t)(sector + i) * sector_size, false);
+        if (data != NULL)
+            memcpy(buffer + i * sector_size, data, sector_size);
+        else
+            memset(buffer + i * sector_size, 0, sector_size);
+    }
+    return 0;
+}
+
+static int write_ram(const uint8_t *buffer, uint32_t count, uint32_t sector, uint32_t sector_size)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t *data = chunk_at((uint64_t)(sector + i) * sector_size, true);
+        if (data == NULL)
+            return -1;
+        memcpy(data, buffer + i * sector_size, sector_size);
+    }
+    return 0;
+}
+
+static int clear_ram(uint32_t sector, uint32_t count, uint32_t sector_size)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t *data = chunk_at((uint64_t)(sector + i) * sector_size, false);
+        if (data != NULL)
+            memset(data, 0, sector_size);
+    }
+    return 0;
+}
+
+static BlockDevice device;
+
+void ram_device_init()
+{
+    ram_device_deinit();
+    memset(&device, 0, sizeof(device));
+    device.read = read_ram;
+    device.write = write_ram;
+    device.clear = clear_ram;
+    device.block_size = RAM_DEVICE_SECTOR_SIZE;
+}
+
+void ram_device_deinit()
+{
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+    {
+        free(chunks[i]);
+        chunks[i] = NULL;
+    }
+}
+
+BlockDevice *ram_device()
+{
+    return &device;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+extern "C"
+{
+#include "fat32/block_device.h"
+}
+
+// Минимальный объём, который принимает formatted_fat32; память выделяется только под записанные участки
+const uint64_t RAM_DEVICE_CAPACITY = 2048ULL * 1024 * 1024;
+const uint32_t RAM_DEVICE_SECTOR_SIZE = 512;
+
+void ram_device_init();
+void ram_device_deinit();
+
+BlockDevice *ram_device();
@@ -1,170 +1,1132 @@
-#include "CppUTest/TestHarness.h"           // Основной заголовок
-#include "CppUTest/CommandLineTestRunner.h" // Для запуска
-#include "mock_device.hpp"
-
+#include "CppUTest/TestHarness.h" // Основной заголовок
+#include "ram_device.hpp"
 
 extern "C"
 {
-#include "FAT.h"
-#include "SD.h"
+#include "fat32/FAT32.h"
+#include "fat32/fat32_alloc.h"
+#include "fat32/fat32_dir_cache.h"
+#include <stdio.h>
+#include <string.h>
 }
 
+// Каждый тест работает на свежеотформатированном томе в памяти
 TEST_GROUP(FAT32Tests){
     void setup(){
-        mock_device_init();
+        ram_device_init();
+fat32_allocator_init(NULL);
+fat32_dir_cache_reset();
+fat32_dir_cache_set_budget(FAT32_DIR_CACHE_DEFAULT_BUDGET);
+CHECK_EQUAL(0, formatted_fat32(ram_device(), RAM_DEVICE_CAPACITY));
+CHECK_EQUAL(0, mount_fat32(ram_device()));
+CHECK_EQUAL(0, fat32_set_deferred_free(0));
 }
 void teardown()
 {
-    mock_device_deinit();
+    fat32_set_deferred_free(0);
+    fat32_dir_cache_set_budget(FAT32_DIR_CACHE_DEFAULT_BUDGET);
+    fat32_dir_cache_reset();
+    ram_device_deinit();
 }
 }
 ;
 
-TEST(FAT32_TESTS, CreateFile_Success)
+TEST(FAT32Tests, CreateFileInFolder)
 {
-    // Инициализация мока устройства
-    mock_device_init();
-
-    BlockDevice device = {
-        .write = write_device,
-        .read =  read_device,
-        .clear = clear_device,
-    };
-    read_device
-
-    // Монтируем тестовый том (загружаем в память заранее подготовленный образ)
-    int status = mount_fat32();
-    CHECK_EQUAL(status, 0);
+    char dir_path[] = "/folder";
+    char path[] = "/folder/newfile.txt";
+    CHECK_EQUAL(0, mkdir_fat32(dir_path));
 
     // Пытаемся создать файл
     FAT32_File *file = NULL;
-    status = open_file_fat32("/folder/newfile.txt", &file, FILE_Mode::F_WRITE);
+    int status = open_file_fat32(path, &file, FILE_Mode::F_WRITE);
     CHECK_EQUAL(status, 0);
 
     // Проверяем, что запись файла появилась в каталоге
-    // (например, читаем директорию и ищем имя)
-    status = path_exists_fat32("/folder/newfile.txt");
+    status = path_exists_fat32(path);
     CHECK_EQUAL(status, 0);
 
     CHECK_EQUAL(0, flush_fat32(file));
-    CHECK_EQUAL(0, close_file_fat32(file));
-
-    // Очистка мока
-    mock_device_deinit();
+    CHECK_EQUAL(0, close_file_fat32(&file));
 }
 
 TEST(FAT32Tests, FormatThenMountSuccess)
 {
-    int status = fat32_format();
+    int status = formatted_fat32(ram_device(), RAM_DEVICE_CAPACITY);
     CHECK_EQUAL(0, status);
 
-    status = fat32_mount();
+    status = mount_fat32(ram_device());
     CHECK_EQUAL(0, status);
 }
 
 TEST(FAT32Tests, CreateFileSuccessfully)
 {
-    int status = fat32_format();
-    CHECK_EQUAL(0, status);
-
-    status = fat32_mount();
-    CHECK_EQUAL(0, status);
-
+    char path[] = "/HELLO.TXT";
     FAT32_File *file = NULL;
-    status = open_file_fat32("/", file, FILE_Mode::F_WRITE);
+    int status = open_file_fat32(path, &file, FILE_Mode::F_WRITE);
     CHECK_EQUAL(status, 0);
 
     CHECK_EQUAL(0, flush_fat32(file));
-    CHECK_EQUAL(0, close_file_fat32(file));
-
-    // можно дополнительно проверить, что файл присутствует:
-    // например, fat32_find_entry("/HELLO.TXT") == true
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, path_exists_fat32(path));
 }
 
 TEST(FAT32Tests, CreateDirectory)
 {
-    CHECK_EQUAL(0, mkdir_fat32("/mydir"));
-    CHECK(path_exists_fat32("/mydir"));
+    char path[] = "/mydir";
+    CHECK_EQUAL(0, mkdir_fat32(path));
+    CHECK_EQUAL(0, path_exists_fat32(path));
 }
 
 TEST(FAT32Tests, CreateAndDeleteFile)
 {
+    char path[] = "/file.txt";
     FAT32_File *file = NULL;
-    CHECK_EQUAL(0, open_file_fat32("/file.txt", file, FILE_Mode::F_WRITE));
-    CHECK(path_exists_fat32("/file.txt"));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, FILE_Mode::F_WRITE));
+    CHECK_EQUAL(0, path_exists_fat32(path));
     CHECK_EQUAL(0, flush_fat32(file));
-    CHECK_EQUAL(0, close_file_fat32(file));
+    CHECK_EQUAL(0, close_file_fat32(&file));
 
-    CHECK_EQUAL(0, delete_file_fat32("/file.txt"));
-    CHECK(!path_exists_fat32("/file.txt"));
+    CHECK_EQUAL(0, delete_file_fat32(path));
+    CHECK_EQUAL(1, path_exists_fat32(path));
 }
 
 TEST(FAT32Tests, CreateAndDeleteEmptyDirectory)
 {
-    CHECK_EQUAL(0, mkdir_fat32("/emptydir"));
-    CHECK(path_exists_fat32("/emptydir"));
+    char path[] = "/emptydir";
+    CHECK_EQUAL(0, mkdir_fat32(path));
+    CHECK_EQUAL(0, path_exists_fat32(path));
 
-    CHECK_EQUAL(0, delete_dir_fat32("/emptydir", DELETE_DIR_SAFE));
-    CHECK(!path_exists_fat32("/emptydir"));
+    CHECK_EQUAL(0, delete_dir_fat32(path, DELETE_DIR_SAFE));
+    CHECK_EQUAL(1, path_exists_fat32(path));
 }
 
 TEST(FAT32Tests, RecursiveDeleteNonEmptyDirectory)
 {
-    CHECK_EQUAL(0, mkdir_fat32("/parent"));
+    char dir_path[] = "/parent";
+    char path[] = "/parent/child.txt";
+    CHECK_EQUAL(0, mkdir_fat32(dir_path));
     FAT32_File *file = NULL;
-    CHECK_EQUAL(0, open_file_fat32("/parent/child.txt", file, FILE_Mode::F_WRITE));
-    CHECK(path_exists_fat32("/parent/child.txt"));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, FILE_Mode::F_WRITE));
+    CHECK_EQUAL(0, path_exists_fat32(path));
     CHECK_EQUAL(0, flush_fat32(file));
-    CHECK_EQUAL(0, close_file_fat32(file));
+    CHECK_EQUAL(0, close_file_fat32(&file));
 
-    CHECK_EQUAL(0, delete_dir_fat32("/parent", DELETE_DIR_RECURSIVE)); // должно удалить рекурсивно
-    CHECK(!path_exists_fat32("/parent"));
+    CHECK_EQUAL(0, delete_dir_fat32(dir_path, DELETE_DIR_RECURSIVE)); // должно удалить рекурсивно
+    CHECK_EQUAL(1, path_exists_fat32(dir_path));
 }
 
 TEST(FAT32Tests, WriteToFile)
 {
+    char path[] = "/write.txt";
     const char *data = "Hello FAT32";
     FAT32_File *file = NULL;
-    CHECK_EQUAL(0, open_file_fat32("/write.txt"), file, FILE_Mode::F_WRITE);
-    CHECK_EQUAL(0, write_file_fat32(file, data, strlen(data)));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, FILE_Mode::F_WRITE));
+    CHECK_EQUAL((int)strlen(data), write_file_fat32(file, (uint8_t *)data, strlen(data)));
 
     CHECK_EQUAL(0, flush_fat32(file));
-    CHECK_EQUAL(0, close_file_fat32(file));
+    CHECK_EQUAL(0, close_file_fat32(&file));
 
     char buffer[64] = {0};
-    CHECK_EQUAL(0, open_file_fat32("/write.txt"), file, FILE_Mode::F_READ);
-    CHECK_EQUAL(0, read_file_fat32(, buffer, strlen(data)));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, FILE_Mode::F_READ));
+    CHECK_EQUAL((int)strlen(data), read_file_fat32(file, (uint8_t *)buffer, strlen(data)));
     STRCMP_EQUAL(data, buffer);
-    CHECK_EQUAL(0, flush_fat32(file));
-    CHECK_EQUAL(0, close_file_fat32(file));
+    CHECK_EQUAL(0, close_file_fat32(&file));
 }
 
 TEST(FAT32Tests, AppendToFile)
 {
+    char path[] = "/append.txt";
     const char *part1 = "Hello ";
     const char *part2 = "World!";
-    CHECK_EQUAL(0, open_file_fat32("/append.txt"), file, FILE_Mode::F_WRITE);
-    CHECK_EQUAL(0, fat32_write_file("/append.txt", part1, strlen(part1)));
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, open_file_fat32(path, &file, FILE_Mode::F_WRITE));
+    CHECK_EQUAL((int)strlen(part1), write_file_fat32(file, (uint8_t *)part1, strlen(part1)));
     CHECK_EQUAL(0, flush_fat32(file));
-    CHECK_EQUAL(0, close_file_fat32(file));
+    CHECK_EQUAL(0, close_file_fat32(&file));
 
-    CHECK_EQUAL(0, open_file_fat32("/append.txt"), file, FILE_Mode::F_APPEND);
-    CHECK_EQUAL(0, fat32_write_file("/append.txt", part2, strlen(part2)));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, FILE_Mode::F_APPEND));
+    CHECK_EQUAL((int)strlen(part2), write_file_fat32(file, (uint8_t *)part2, strlen(part2)));
     CHECK_EQUAL(0, flush_fat32(file));
-    CHECK_EQUAL(0, close_file_fat32(file));
+    CHECK_EQUAL(0, close_file_fat32(&file));
 
     char buffer[64] = {0};
-    CHECK_EQUAL(0, open_file_fat32("/append.txt"), file, FILE_Mode::F_READ);
-    CHECK_EQUAL(0, read_file_fat32("/append.txt", buffer, sizeof(part1) + srtlen(part2)));
-    CHECK_EQUAL(0, flush_fat32(file));
-    CHECK_EQUAL(0, close_file_fat32(file));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, FILE_Mode::F_READ));
+    CHECK_EQUAL((int)(strlen(part1) + strlen(part2)), read_file_fat32(file, (uint8_t *)buffer, sizeof(buffer) - 1));
+    CHECK_EQUAL(0, close_file_fat32(&file));
     STRCMP_EQUAL("Hello World!", buffer);
 }
 
 TEST(FAT32Tests, ReadNonExistentFileFails)
 {
-    char buffer[32];
-    CHECK_EQUAL(0, open_file_fat32("/no_such_file.txt"), file, FILE_Mode::F_READ);
-    int status = read_file_fat32("/no_such_file.txt", buffer, sizeof(buffer));
+    char path[] = "/no_such_file.txt";
+    uint8_t buffer[32];
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, open_file_fat32(path, &file, FILE_Mode::F_READ));
+    int status = read_file_fat32(file, buffer, sizeof(buffer));
     CHECK(status >= 0);
-}
\ No newline at end of file
+    CHECK_EQUAL(0, close_file_fat32(&file));
+}
+
+TEST(FAT32Tests, CountFreeClustersTracksWriteAndDelete)
+{
+    char path[] = "/count.bin";
+    FAT32_File *file = NULL;
+    FatLayoutInfo layout;
+    uint32_t free_count = 0;
+
+    // После форматирования заняты кластеры корневого каталога и каталога MYDIR
+    CHECK_EQUAL(0, fat32_get_layout(&layout));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_count));
+    uint32_t formatted_free = layout.cluster_count - 2 - 2;
+    CHECK_EQUAL(formatted_free, free_count);
+
+    // Файл из 10 полных кластеров и одного неполного
+    uint32_t cluster_size = layout.secPerClus * layout.bytesPerSec;
+    uint8_t data[512];
+    memset(data, 0x26, sizeof(data));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    for (uint32_t written = 0; written < cluster_size * 10 + 1; written += sizeof(data))
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_count));
+    CHECK_EQUAL(formatted_free - 11, free_count);
+
+    // Значение совпадает с полным подсчётом по FAT после перемонтирования
+    CHECK_EQUAL(0, mount_fat32(ram_device()));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_count));
+    CHECK_EQUAL(formatted_free - 11, free_count);
+
+    CHECK_EQUAL(0, delete_file_fat32(path));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_count));
+    CHECK_EQUAL(formatted_free, free_count);
+}
+
+TEST(FAT32Tests, OpenAndDeleteLongNameFile)
+{
+    // Имя занимает несколько LFN-записей, группа может пересекать границу сектора
+    char path[] = "/long_file_name_crossing_sectors.txt";
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_READ));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, delete_file_fat32(path));
+    CHECK_EQUAL(1, path_exists_fat32(path));
+}
+
+TEST(FAT32Tests, NonAsciiNamesIgnoreCase)
+{
+    // Регистр не учитывается и для символов вне ASCII: второй файл не создаётся
+    char path[] = "/Привет_Ünïcode.txt";
+    char other_case[] = "/пРИВЕТ_üNÏCODE.TXT";
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    CHECK_EQUAL(5, write_file_fat32(file, (uint8_t *)"hello", 5));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, path_exists_fat32(other_case));
+    CHECK_EQUAL(0, open_file_fat32(other_case, &file, F_READ));
+    CHECK_EQUAL(5u, file->size_bytes);
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, delete_file_fat32(other_case));
+    CHECK_EQUAL(1, path_exists_fat32(path));
+}
+
+TEST(FAT32Tests, DirectoryHandleRelativeOperations)
+{
+    char dir_path[] = "/hot";
+    CHECK_EQUAL(0, mkdir_fat32(dir_path));
+
+    FAT32_Dir *dir = NULL;
+    CHECK_EQUAL(0, fat32_opendir(dir_path, &dir));
+
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "data.txt", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, path_exists_at_fat32(dir, "data.txt"));
+
+    CHECK_EQUAL(0, mkdir_at_fat32(dir, "sub"));
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "sub/inner.txt", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(FAT32_ERR_INVALID_PATH, open_file_at_fat32(dir, "/data.txt", &file, F_READ));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, open_file_at_fat32(NULL, "data.txt", &file, F_READ));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, mkdir_at_fat32(NULL, "sub"));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, path_exists_at_fat32(dir, NULL));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, delete_file_at_fat32(NULL, "data.txt"));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, delete_dir_at_fat32(NULL, "sub", DELETE_DIR_SAFE));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, delete_dir_at_fat32(dir, NULL, DELETE_DIR_SAFE));
+    CHECK_EQUAL(0, delete_file_at_fat32(dir, "data.txt"));
+    CHECK_EQUAL(1, path_exists_at_fat32(dir, "data.txt"));
+    CHECK_EQUAL(0, delete_dir_at_fat32(dir, "sub", DELETE_DIR_RECURSIVE));
+
+    CHECK_EQUAL(0, fat32_closedir(&dir));
+    CHECK(dir == NULL);
+}
+
+TEST(FAT32Tests, ReadDirectoryEntries)
+{
+    char dir_path[] = "/listing";
+    CHECK_EQUAL(0, mkdir_fat32(dir_path));
+
+    FAT32_Dir *dir = NULL;
+    CHECK_EQUAL(0, fat32_opendir(dir_path, &dir));
+
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "long_entry_name.txt", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "SHORT.TXT", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, mkdir_at_fat32(dir, "SUB"));
+
+    FAT32_DirInfo info;
+    CHECK_EQUAL(1, fat32_readdir(dir, &info));
+    STRCMP_EQUAL("long_entry_name.txt", info.name);
+    CHECK_EQUAL(1, fat32_readdir(dir, &info));
+    STRCMP_EQUAL("SHORT.TXT", info.name);
+    CHECK_EQUAL(1, fat32_readdir(dir, &info));
+    STRCMP_EQUAL("SUB", info.name);
+    CHECK(info.attr & ATTR_DIRECTORY);
+    CHECK_EQUAL(0, fat32_readdir(dir, &info));
+    CHECK_EQUAL(0, fat32_readdir(dir, &info));
+
+    CHECK_EQUAL(0, fat32_closedir(&dir));
+}
+
+TEST(FAT32Tests, ReadDirectorySeesChangesBetweenCalls)
+{
+    char dir_path[] = "/changing";
+    CHECK_EQUAL(0, mkdir_fat32(dir_path));
+
+    FAT32_Dir *dir = NULL;
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, fat32_opendir(dir_path, &dir));
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "A.TXT", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "B.TXT", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    // Сектор уже в буфере дескриптора: удаление B и создание C между вызовами должны быть видны
+    FAT32_DirInfo info;
+    CHECK_EQUAL(1, fat32_readdir(dir, &info));
+    STRCMP_EQUAL("A.TXT", info.name);
+    CHECK_EQUAL(0, delete_file_at_fat32(dir, "B.TXT"));
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "C.TXT", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(1, fat32_readdir(dir, &info));
+    STRCMP_EQUAL("C.TXT", info.name);
+    CHECK_EQUAL(0, fat32_readdir(dir, &info));
+
+    CHECK_EQUAL(0, fat32_closedir(&dir));
+}
+
+TEST(FAT32Tests, StatDirectorySubtree)
+{
+    char dir_path[] = "/tree";
+    char sub_path[] = "/tree/sub";
+    char file_path[] = "/tree/sub/leaf.txt";
+    CHECK_EQUAL(0, mkdir_fat32(dir_path));
+    CHECK_EQUAL(0, mkdir_fat32(sub_path));
+
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, open_file_fat32(file_path, &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    FAT32_StatEntry entries[4];
+    uint32_t count = 0;
+    CHECK_EQUAL(0, fat32_stat_dir(dir_path, entries, 4, &count, 0));
+    CHECK_EQUAL(1, count);
+    STRCMP_EQUAL("sub", entries[0].info.name);
+    CHECK_EQUAL(FAT32_STAT_NO_PARENT, entries[0].parent);
+
+    CHECK_EQUAL(0, fat32_stat_dir(dir_path, entries, 4, &count, 1));
+    CHECK_EQUAL(2, count);
+    STRCMP_EQUAL("leaf.txt", entries[1].info.name);
+    CHECK_EQUAL(0, entries[1].parent);
+
+    CHECK_EQUAL(FAT32_ERR_BUFFER_TOO_SMALL, fat32_stat_dir(dir_path, entries, 1, &count, 1));
+    CHECK_EQUAL(1, count);
+}
+
+TEST(FAT32Tests, ResumeDirectoryScan)
+{
+    char dir_path[] = "/resume";
+    CHECK_EQUAL(0, mkdir_fat32(dir_path));
+
+    FAT32_Dir *dir = NULL;
+    CHECK_EQUAL(0, fat32_opendir(dir_path, &dir));
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "first.txt", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "second.txt", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    FAT32_DirInfo info;
+    FAT32_DirPos pos;
+    CHECK_EQUAL(1, fat32_readdir(dir, &info));
+    STRCMP_EQUAL("first.txt", info.name);
+    CHECK_EQUAL(0, fat32_telldir(dir, &pos));
+    CHECK_EQUAL(0, fat32_closedir(&dir));
+
+    // Продолжение сканирования новым дескриптором
+    CHECK_EQUAL(0, fat32_opendir(dir_path, &dir));
+    CHECK_EQUAL(0, fat32_seekdir(dir, &pos));
+    CHECK_EQUAL(1, fat32_readdir(dir, &info));
+    STRCMP_EQUAL("second.txt", info.name);
+    CHECK_EQUAL(0, fat32_readdir(dir, &info));
+
+    CHECK_EQUAL(0, fat32_rewinddir(dir));
+    CHECK_EQUAL(1, fat32_readdir(dir, &info));
+    STRCMP_EQUAL("first.txt", info.name);
+    CHECK_EQUAL(0, fat32_closedir(&dir));
+}
+
+// Отказ записи в диапазон секторов носителя; остальные записи выполняются как обычно
+static fs_write_t ram_write = NULL;
+static uint32_t failing_first = 0, failing_count = 0;
+
+static int write_failing_range(const uint8_t *buffer, uint32_t size, uint32_t start_sector, uint32_t sector_size)
+{
+    if (start_sector < failing_first + failing_count && start_sector + size > failing_first)
+        return -1;
+    return ram_write(buffer, size, start_sector, sector_size);
+}
+
+static void fail_writes(uint32_t first, uint32_t count)
+{
+    failing_first = first;
+    failing_count = count;
+    ram_write = ram_device()->write;
+    ram_device()->write = write_failing_range;
+}
+
+static void restore_writes()
+{
+    ram_device()->write = ram_write;
+}
+
+// Отказ записи в первый кластер корневого каталога; FAT и данные файлов пишутся как обычно
+static void fail_root_writes()
+{
+    FatLayoutInfo layout;
+    CHECK_EQUAL(0, fat32_get_layout(&layout));
+    fail_writes(layout.address_region, layout.secPerClus);
+}
+
+TEST(FAT32Tests, FailedEntryWriteKeepsDirectoryConsistent)
+{
+    char path_a[] = "/A.TXT";
+    char path_b[] = "/B.TXT";
+    char path_c[] = "/C.TXT";
+    char path_g[] = "/G.TXT";
+    char dir_d[] = "/D";
+    char dir_e[] = "/E";
+    FAT32_File *file = NULL;
+    CHECK_EQUAL(0, open_file_fat32(path_a, &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    // Группа записей не записалась: следующая должна лечь до маркера конца каталога.
+    // Перемонтирование сбрасывает кэш, и имя ищется сканированием каталога
+    fail_root_writes();
+    int status = open_file_fat32(path_b, &file, F_WRITE);
+    restore_writes();
+    CHECK(status < 0);
+    CHECK_EQUAL(0, open_file_fat32(path_c, &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, mount_fat32(ram_device()));
+    CHECK_EQUAL(0, path_exists_fat32(path_c));
+
+    fail_root_writes();
+    status = mkdir_fat32(dir_d);
+    restore_writes();
+    CHECK(status < 0);
+    CHECK_EQUAL(0, mkdir_fat32(dir_e));
+    CHECK_EQUAL(0, mount_fat32(ram_device()));
+    CHECK_EQUAL(0, path_exists_fat32(dir_e));
+
+    fail_root_writes();
+    status = fat32_rename(path_c, "/F.TXT");
+    restore_writes();
+    CHECK(status < 0);
+    CHECK_EQUAL(0, fat32_rename(path_c, path_g));
+    CHECK_EQUAL(0, mount_fat32(ram_device()));
+    CHECK_EQUAL(0, path_exists_fat32(path_g));
+    CHECK_EQUAL(1, path_exists_fat32(path_c));
+    CHECK_EQUAL(0, path_exists_fat32(path_a));
+}
+
+TEST(FAT32Tests, CompactDirectory)
+{
+    char dir_path[] = "/compact";
+    CHECK_EQUAL(0, mkdir_fat32(dir_path));
+
+    FAT32_Dir *dir = NULL;
+    FAT32_File *file = NULL;
+    char name[32];
+    CHECK_EQUAL(0, fat32_opendir(dir_path, &dir));
+    for (int i = 0; i < 200; i++)
+    {
+        sprintf(name, "rotating_log_%03d.txt", i);
+        CHECK_EQUAL(0, open_file_at_fat32(dir, name, &file, F_WRITE));
+        CHECK_EQUAL(0, close_file_fat32(&file));
+    }
+    for (int i = 0; i < 200; i++)
+    {
+        if (i % 10 != 0)
+        {
+            sprintf(name, "rotating_log_%03d.txt", i);
+            CHECK_EQUAL(0, delete_file_at_fat32(dir, name));
+        }
+    }
+
+    uint32_t released = 0;
+    CHECK_EQUAL(0, fat32_compact_dir(dir, &released));
+    CHECK(released > 0);
+
+    // Живые записи сохранили порядок и остались доступны по имени
+    FAT32_DirInfo info;
+    for (int i = 0; i < 200; i += 10)
+    {
+        sprintf(name, "rotating_log_%03d.txt", i);
+        CHECK_EQUAL(1, fat32_readdir(dir, &info));
+        STRCMP_EQUAL(name, info.name);
+        CHECK_EQUAL(0, path_exists_at_fat32(dir, name));
+    }
+    CHECK_EQUAL(0, fat32_readdir(dir, &info));
+
+    CHECK_EQUAL(0, fat32_compact_dir(dir, &released));
+    CHECK_EQUAL(0u, released);
+    CHECK_EQUAL(0, fat32_closedir(&dir));
+}
+
+TEST(FAT32Tests, CompactDirectoryWithOpenFile)
+{
+    char dir_path[] = "/online";
+    CHECK_EQUAL(0, mkdir_fat32(dir_path));
+
+    FAT32_Dir *dir = NULL;
+    FAT32_File *file = NULL;
+    FAT32_File *open_file = NULL;
+    char name[32];
+    CHECK_EQUAL(0, fat32_opendir(dir_path, &dir));
+    for (int i = 0; i < 40; i++)
+    {
+        sprintf(name, "segment_%02d.bin", i);
+        CHECK_EQUAL(0, open_file_at_fat32(dir, name, &file, F_WRITE));
+        CHECK_EQUAL(0, close_file_fat32(&file));
+    }
+    for (int i = 0; i < 30; i++)
+    {
+        sprintf(name, "segment_%02d.bin", i);
+        CHECK_EQUAL(0, delete_file_at_fat32(dir, name));
+    }
+
+    // Файл открыт на запись во время уплотнения: его запись каталога переезжает
+    const char *data = "written after compaction";
+    CHECK_EQUAL(0, open_file_at_fat32(dir, "segment_35.bin", &open_file, F_APPEND));
+    CHECK_EQUAL(0, fat32_compact_dir(dir, NULL));
+    CHECK_EQUAL((int)strlen(data), write_file_fat32(open_file, (uint8_t *)data, strlen(data)));
+    CHECK_EQUAL(0, close_file_fat32(&open_file));
+
+    // Размер попал в запись самого файла, соседние записи не изменились
+    FAT32_DirInfo info;
+    for (int i = 30; i < 40; i++)
+    {
+        sprintf(name, "segment_%02d.bin", i);
+        CHECK_EQUAL(1, fat32_readdir(dir, &info));
+        STRCMP_EQUAL(name, info.name);
+        CHECK_EQUAL(i == 35 ? strlen(data) : 0u, info.size);
+    }
+    CHECK_EQUAL(0, fat32_readdir(dir, &info));
+    CHECK_EQUAL(0, fat32_closedir(&dir));
+}
+
+TEST(FAT32Tests, AllocateClusterChain)
+{
+    char path[] = "/prealloc.bin";
+    FAT32_File *file = NULL;
+    Fat32ClusterAlloc alloc;
+    uint32_t free_before = 0, free_after = 0;
+
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, fat32_allocate_clusters(0, 0, &alloc));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, fat32_allocate_clusters(1, 4, &alloc));
+
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+    CHECK_EQUAL(0, fat32_allocate_clusters(file->first_cluster, 16, &alloc));
+    CHECK_EQUAL(16u, alloc.total);
+    CHECK(alloc.run_count >= 1);
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before - 16, free_after);
+
+    // Запись идёт по присоединённой цепочке и новых кластеров не выделяет
+    uint8_t data[8192];
+    for (uint32_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 31 + 7);
+    CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before - 16, free_after);
+
+    uint8_t buffer[sizeof(data)];
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_READ));
+    CHECK_EQUAL((int)sizeof(buffer), read_file_fat32(file, buffer, sizeof(buffer)));
+    MEMCMP_EQUAL(data, buffer, sizeof(data));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, delete_file_fat32(path));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before + 1, free_after);
+}
+
+TEST(FAT32Tests, PreallocateFile)
+{
+    char path[] = "/record.bin";
+    FAT32_File *file = NULL;
+    uint32_t free_before = 0, free_after = 0;
+    const uint32_t reserve = 64 * 1024;
+
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, fat32_preallocate(NULL, reserve));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+    CHECK_EQUAL(0, fat32_preallocate(file, reserve));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK(free_after < free_before);
+    uint32_t reserved = free_before - free_after;
+
+    // Резерв — один непрерывный участок; размер файла не меняется
+    CHECK_EQUAL(1u, file->extents.run_count);
+    CHECK_EQUAL(reserved, file->extents.total);
+    CHECK_EQUAL(0u, file->size_bytes);
+
+    // Повторный вызов с меньшим объёмом ничего не выделяет
+    CHECK_EQUAL(0, fat32_preallocate(file, reserve / 2));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before - reserved, free_after);
+
+    uint8_t data[4096];
+    for (uint32_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 13 + 5);
+    for (uint32_t written = 0; written < reserve; written += sizeof(data))
+    {
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+        CHECK_EQUAL(written + sizeof(data), file->size_bytes);
+    }
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before - reserved, free_after);
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    uint8_t buffer[sizeof(data)];
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_READ));
+    CHECK_EQUAL(0, seek_file_fat32(file, reserve - sizeof(buffer), F_SEEK_SET));
+    CHECK_EQUAL((int)sizeof(buffer), read_file_fat32(file, buffer, sizeof(buffer)));
+    MEMCMP_EQUAL(data, buffer, sizeof(data));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    // Объём больше свободного места не выделяется и цепочку не меняет
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_APPEND));
+    CHECK_EQUAL(FAT32_ERR_DISK_FULL, fat32_preallocate(file, 0xFFFFFFFFu));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, delete_file_fat32(path));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before + 1, free_after);
+}
+
+TEST(FAT32Tests, DelayedAllocation)
+{
+    char path_a[] = "/log_a.txt";
+    char path_b[] = "/log_b.txt";
+    FAT32_File *file_a = NULL;
+    FAT32_File *file_b = NULL;
+    uint32_t free_before = 0, free_after = 0;
+
+    CHECK_EQUAL(0, open_file_fat32(path_a, &file_a, F_WRITE));
+    CHECK_EQUAL(0, open_file_fat32(path_b, &file_b, F_WRITE));
+    CHECK_EQUAL(0, fat32_set_delayed_alloc(file_a, 16 * 1024));
+    CHECK_EQUAL(0, fat32_set_delayed_alloc(file_b, 16 * 1024));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+
+    // Попеременные короткие записи двух журналов остаются в буферах
+    char line[64];
+    uint32_t length_a = 0, length_b = 0;
+    for (int i = 0; i < 100; i++)
+    {
+        int n = sprintf(line, "a %03d: sensor sample\n", i);
+        CHECK_EQUAL(n, write_file_fat32(file_a, (uint8_t *)line, n));
+        length_a += n;
+        n = sprintf(line, "b %03d: other sample\n", i);
+        CHECK_EQUAL(n, write_file_fat32(file_b, (uint8_t *)line, n));
+        length_b += n;
+    }
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before, free_after);
+    CHECK_EQUAL(length_a, tell_fat32(file_a));
+
+    // Сброс записывает данные и размер
+    CHECK_EQUAL(0, flush_fat32(file_a));
+    CHECK_EQUAL(length_a, file_a->size_bytes);
+    CHECK_EQUAL(0, close_file_fat32(&file_a));
+    CHECK_EQUAL(0, close_file_fat32(&file_b));
+
+    char expected[64];
+    char buffer[4096];
+    CHECK_EQUAL(0, open_file_fat32(path_b, &file_b, F_READ));
+    CHECK_EQUAL((int)length_b, read_file_fat32(file_b, (uint8_t *)buffer, sizeof(buffer)));
+    int n = sprintf(expected, "b %03d: other sample\n", 57);
+    MEMCMP_EQUAL(expected, buffer + 57 * n, n);
+    CHECK_EQUAL(0, close_file_fat32(&file_b));
+
+    // Файл только для чтения отложенное выделение не поддерживает
+    CHECK_EQUAL(0, open_file_fat32(path_a, &file_a, F_READ));
+    CHECK_EQUAL(FAT32_ERR_INVALID_FILE_MODE, fat32_set_delayed_alloc(file_a, 4096));
+    CHECK_EQUAL(0, close_file_fat32(&file_a));
+
+    CHECK_EQUAL(0, delete_file_fat32(path_a));
+    CHECK_EQUAL(0, delete_file_fat32(path_b));
+}
+
+TEST(FAT32Tests, DelayedAllocationRetryAfterFailedDrain)
+{
+    char path[] = "/retry.bin";
+    FAT32_File *file = NULL;
+    FatLayoutInfo layout;
+    uint8_t head[1000], tail[4000];
+    memset(head, 'A', sizeof(head));
+    memset(tail, 'B', sizeof(tail));
+
+    CHECK_EQUAL(0, fat32_get_layout(&layout));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    CHECK_EQUAL(0, fat32_set_delayed_alloc(file, 4096));
+    CHECK_EQUAL((int)sizeof(head), write_file_fat32(file, head, sizeof(head)));
+
+    // Буфер заполняется, но сбросить его на носитель не удаётся: вызов не принимает ничего
+    fail_writes(layout.address_region, 0xFFFFFFFF - layout.address_region);
+    int status = write_file_fat32(file, tail, sizeof(tail));
+    restore_writes();
+    CHECK(status < 0);
+    CHECK_EQUAL(sizeof(head), tell_fat32(file));
+
+    // Повтор записывает данные один раз
+    CHECK_EQUAL((int)sizeof(tail), write_file_fat32(file, tail, sizeof(tail)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    uint8_t buffer[8192];
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_READ));
+    CHECK_EQUAL((int)(sizeof(head) + sizeof(tail)), read_file_fat32(file, buffer, sizeof(buffer)));
+    MEMCMP_EQUAL(head, buffer, sizeof(head));
+    MEMCMP_EQUAL(tail, buffer + sizeof(head), sizeof(tail));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+}
+
+TEST(FAT32Tests, AllocationPolicies)
+{
+    char path[] = "/policy.bin";
+    FAT32_File *file = NULL;
+    Fat32ClusterAlloc first, second;
+
+    // Политика без поиска участков не принимается
+    BlockDevice device = {};
+    Fat32AllocPolicy broken = {"broken", NULL, NULL};
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, mount_fat32_ex(NULL, &fat32_policy_locality));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, mount_fat32_ex(&device, &broken));
+
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    uint32_t cluster = file->first_cluster;
+    CHECK_EQUAL(0, fat32_cluster_is_free(cluster));
+    CHECK_EQUAL(0, fat32_cluster_is_free(1));
+
+    // Поиск только находит участки, FAT не меняется
+    CHECK_EQUAL(0, fat32_policy_first_fit.find_runs(cluster, 4, &first));
+    CHECK_EQUAL(4u, first.total);
+    CHECK_EQUAL(1, fat32_cluster_is_free(first.runs[0].first));
+
+    // next-fit продолжает с места, где закончился предыдущий поиск
+    fat32_policy_next_fit.reset();
+    CHECK_EQUAL(0, fat32_policy_next_fit.find_runs(0, 4, &first));
+    CHECK_EQUAL(0, fat32_policy_next_fit.find_runs(0, 4, &second));
+    const Fat32ClusterRun *last = &first.runs[first.run_count - 1];
+    CHECK(second.runs[0].first >= last->first + last->count);
+
+    // locality продолжает файл сразу за его последним кластером
+    CHECK_EQUAL(1, fat32_cluster_is_free(cluster + 1));
+    CHECK_EQUAL(0, fat32_policy_locality.find_runs(cluster, 1, &first));
+    CHECK_EQUAL(cluster + 1, first.runs[0].first);
+
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, delete_file_fat32(path));
+}
+
+// Число непрерывных участков цепочки кластеров; FAT читается с устройства (0 — ошибка чтения)
+static uint32_t chain_fragments(const FatLayoutInfo *layout, uint32_t cluster)
+{
+    uint8_t sector[RAM_DEVICE_SECTOR_SIZE];
+    uint32_t fragments = 1;
+    while (true)
+    {
+        uint32_t offset = cluster * sizeof(uint32_t);
+        if (ram_device()->read(sector, 1, layout->address_tabl1 + offset / layout->bytesPerSec, layout->bytesPerSec) != 0)
+            return 0;
+        uint32_t next = 0;
+        memcpy(&next, sector + offset % layout->bytesPerSec, sizeof(next));
+        next &= 0x0FFFFFFF;
+        if (next >= 0x0FFFFFF8)
+            return fragments;
+        if (next != cluster + 1)
+            fragments++;
+        cluster = next;
+    }
+}
+
+TEST(FAT32Tests, LocalityKeepsInterleavedFilesContiguous)
+{
+    const Fat32AllocPolicy *policies[] = {&fat32_policy_locality, &fat32_policy_first_fit};
+    char path_a[] = "/a.bin";
+    char path_b[] = "/b.bin";
+    static uint8_t data[32 * 1024];
+    uint32_t fragments[2][2] = {};
+    memset(data, 0x4D, sizeof(data));
+
+    // Два файла дописываются попеременно по кластеру за раз
+    for (int p = 0; p < 2; p++)
+    {
+        CHECK_EQUAL(0, formatted_fat32(ram_device(), RAM_DEVICE_CAPACITY));
+        CHECK_EQUAL(0, mount_fat32_ex(ram_device(), policies[p]));
+        FatLayoutInfo layout;
+        CHECK_EQUAL(0, fat32_get_layout(&layout));
+        uint32_t cluster_size = layout.secPerClus * layout.bytesPerSec;
+        CHECK(cluster_size <= sizeof(data));
+
+        FAT32_File *a = NULL, *b = NULL;
+        CHECK_EQUAL(0, open_file_fat32(path_a, &a, F_WRITE));
+        CHECK_EQUAL(0, open_file_fat32(path_b, &b, F_WRITE));
+        uint32_t first_a = a->first_cluster, first_b = b->first_cluster;
+        for (int i = 0; i < 16; i++)
+        {
+            CHECK_EQUAL((int)cluster_size, write_file_fat32(a, data, cluster_size));
+            CHECK_EQUAL((int)cluster_size, write_file_fat32(b, data, cluster_size));
+        }
+        CHECK_EQUAL(0, close_file_fat32(&a));
+        CHECK_EQUAL(0, close_file_fat32(&b));
+        fragments[p][0] = chain_fragments(&layout, first_a);
+        fragments[p][1] = chain_fragments(&layout, first_b);
+    }
+
+    // locality оставляет каждому файлу окно для роста, first-fit чередует их кластеры
+    CHECK_EQUAL(1u, fragments[0][0]);
+    CHECK_EQUAL(1u, fragments[0][1]);
+    CHECK(fragments[1][0] > 1);
+    CHECK(fragments[1][1] > 1);
+}
+
+TEST(FAT32Tests, DeleteReleasesWholeChain)
+{
+    char path[] = "/chain.bin";
+    FAT32_File *file = NULL;
+    uint32_t free_before = 0, free_after = 0;
+
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    uint32_t first_cluster = file->first_cluster;
+    uint8_t data[4096];
+    memset(data, 0x3C, sizeof(data));
+    for (int i = 0; i < 64; i++)
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    // Перезапись обрезает цепочку до первого кластера
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before - 1, free_after);
+
+    CHECK_EQUAL(0, delete_file_fat32(path));
+    CHECK_EQUAL(1, fat32_cluster_is_free(first_cluster));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before, free_after);
+}
+
+TEST(FAT32Tests, DeferredFree)
+{
+    char path[] = "/deferred.bin";
+    FAT32_File *file = NULL;
+    uint32_t free_before = 0, free_after = 0;
+
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    uint8_t data[4096];
+    memset(data, 0x6B, sizeof(data));
+    for (int i = 0; i < 256; i++)
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    uint32_t used = free_before - free_after;
+
+    // Запись каталога удаляется сразу, кластеры — по шагам
+    CHECK_EQUAL(0, fat32_set_deferred_free(1));
+    CHECK_EQUAL(0, delete_file_fat32(path));
+    CHECK(path_exists_fat32(path) != 0);
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before - used, free_after);
+
+    int steps = 0;
+    while (fat32_free_step(1) > 0)
+        steps++;
+    CHECK(steps > 0);
+    CHECK_EQUAL(0, fat32_free_step(1));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before, free_after);
+    CHECK_EQUAL(0, fat32_set_deferred_free(0));
+}
+
+TEST(FAT32Tests, RemountDrainsDeferredFree)
+{
+    char path[] = "/remount.bin";
+    FAT32_File *file = NULL;
+    uint32_t free_before = 0, free_after = 0;
+
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    uint8_t data[4096];
+    memset(data, 0x3C, sizeof(data));
+    for (int i = 0; i < 64; i++)
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    // Очередь не пуста в момент перемонтирования: цепочка не должна потеряться
+    CHECK_EQUAL(0, fat32_set_deferred_free(1));
+    CHECK_EQUAL(0, delete_file_fat32(path));
+    CHECK_EQUAL(0, mount_fat32(ram_device()));
+    CHECK_EQUAL(0, fat32_free_step(0));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before, free_after);
+    CHECK_EQUAL(0, fat32_set_deferred_free(0));
+}
+
+TEST(FAT32Tests, RemountKeepsDeferredFreeOnWriteFailure)
+{
+    char path[] = "/remount.bin";
+    FAT32_File *file = NULL;
+    FatLayoutInfo layout;
+    uint32_t free_before = 0, free_after = 0;
+
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    uint8_t data[4096];
+    memset(data, 0x5A, sizeof(data));
+    for (int i = 0; i < 16; i++)
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, fat32_set_deferred_free(1));
+    CHECK_EQUAL(0, delete_file_fat32(path));
+
+    // Записи в FAT не проходят: монтирование отказывает, очередь остаётся для повтора
+    CHECK_EQUAL(0, fat32_get_layout(&layout));
+    fail_writes(layout.address_tabl1, layout.address_region - layout.address_tabl1);
+    CHECK(mount_fat32(ram_device()) < 0);
+    restore_writes();
+
+    CHECK_EQUAL(0, fat32_free_step(0));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before, free_after);
+    CHECK_EQUAL(0, fat32_set_deferred_free(0));
+}
+
+TEST(FAT32Tests, TruncateFile)
+{
+    char path[] = "/rotate.log";
+    FAT32_File *file = NULL;
+    uint32_t free_before = 0, free_after = 0;
+
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    uint8_t data[4096];
+    for (uint32_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 17 + 3);
+    for (int i = 0; i < 16; i++)
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+
+    // Файл не растёт; хвост цепочки освобождается, позиция переносится в новый конец
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, fat32_truncate(file, 16 * sizeof(data) + 1));
+    CHECK_EQUAL(0, fat32_truncate(file, sizeof(data) + 100));
+    CHECK_EQUAL(sizeof(data) + 100, file->size_bytes);
+    CHECK_EQUAL(sizeof(data) + 100, tell_fat32(file));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before - 2, free_after);
+    CHECK_EQUAL(100, write_file_fat32(file, data, 100));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    uint8_t buffer[sizeof(data) + 200];
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_READ));
+    CHECK_EQUAL((int)(sizeof(data) + 200), read_file_fat32(file, buffer, sizeof(buffer)));
+    MEMCMP_EQUAL(data, buffer, sizeof(data));
+    MEMCMP_EQUAL(data, buffer + sizeof(data) + 100, 100);
+    CHECK_EQUAL(FAT32_ERR_INVALID_FILE_MODE, fat32_truncate(file, 0));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_APPEND));
+    CHECK_EQUAL(0, fat32_truncate(file, 0));
+    CHECK_EQUAL(0u, file->size_bytes);
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before - 1, free_after);
+
+    CHECK_EQUAL(0, delete_file_fat32(path));
+}
+
+TEST(FAT32Tests, TruncateWritesSizeBeforeCuttingChain)
+{
+    char path[] = "/cut.log";
+    FAT32_File *file = NULL, *reader = NULL;
+    FatLayoutInfo layout;
+    uint32_t free_before = 0, free_after = 0;
+
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_WRITE));
+    uint8_t data[4096];
+    memset(data, 0x6B, sizeof(data));
+    for (int i = 0; i < 4; i++)
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, open_file_fat32(path, &file, F_APPEND));
+
+    // Отказ записи FAT: размер уже записан, цепочка не обрезана
+    CHECK_EQUAL(0, fat32_get_layout(&layout));
+    fail_writes(layout.address_tabl1, layout.address_region - layout.address_tabl1);
+    CHECK(fat32_truncate(file, 100) < 0);
+    restore_writes();
+
+    CHECK_EQUAL(0, open_file_fat32(path, &reader, F_READ));
+    CHECK_EQUAL(100u, reader->size_bytes);
+    CHECK_EQUAL(0, close_file_fat32(&reader));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, delete_file_fat32(path));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before, free_after);
+}
+
+TEST(FAT32Tests, RenameAndMove)
+{
+    FAT32_File *file = NULL;
+    const char text[] = "rotation sample";
+    char buffer[32];
+
+    CHECK_EQUAL(0, mkdir_fat32("/rot"));
+    CHECK_EQUAL(0, mkdir_fat32("/arc"));
+    CHECK_EQUAL(0, open_file_fat32("/rot/current.log", &file, F_WRITE));
+    CHECK_EQUAL((int)sizeof(text), write_file_fat32(file, (uint8_t *)text, sizeof(text)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    // Переименование в каталоге и перенос в другой каталог
+    CHECK_EQUAL(0, fat32_rename("/rot/current.log", "/rot/rotated_0001.log"));
+    CHECK(path_exists_fat32("/rot/current.log") != 0);
+    CHECK_EQUAL(0, fat32_rename("/rot/rotated_0001.log", "/arc/R1.LOG"));
+    CHECK_EQUAL(0, open_file_fat32("/arc/R1.LOG", &file, F_READ));
+    CHECK_EQUAL((int)sizeof(text), read_file_fat32(file, (uint8_t *)buffer, sizeof(buffer)));
+    MEMCMP_EQUAL(text, buffer, sizeof(text));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(FAT32_ERR_ENTRY_NOT_FOUND, fat32_rename("/rot/missing.log", "/rot/other.log"));
+    CHECK_EQUAL(0, open_file_fat32("/arc/taken.log", &file, F_WRITE));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(FAT32_ERR_ENTRY_EXISTS, fat32_rename("/arc/R1.LOG", "/arc/taken.log"));
+    CHECK_EQUAL(0, mkdir_fat32("/arc/old"));
+
+    // Папка переносится вместе с содержимым, но не внутрь самой себя
+    CHECK_EQUAL(FAT32_ERR_INVALID_PATH, fat32_rename("/arc", "/arc/old/arc"));
+    CHECK_EQUAL(0, fat32_rename("/arc", "/rot/archive"));
+    CHECK_EQUAL(0, path_exists_fat32("/rot/archive/R1.LOG"));
+    CHECK_EQUAL(0, path_exists_fat32("/rot/archive/old"));
+
+    CHECK_EQUAL(0, delete_dir_fat32("/rot", DELETE_DIR_RECURSIVE));
+}
+
+TEST(FAT32Tests, ConcatSegments)
+{
+    FAT32_File *file = NULL;
+    uint32_t free_before = 0, free_after = 0;
+    uint8_t data[4096];
+    for (uint32_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 13 + 5);
+
+    // 64 КБ кратны любому размеру кластера: цепочка сегмента подвешивается без копирования
+    CHECK_EQUAL(0, open_file_fat32("/daily.log", &file, F_WRITE));
+    for (int i = 0; i < 16; i++)
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, open_file_fat32("/hour_01.log", &file, F_WRITE));
+    CHECK_EQUAL(3000, write_file_fat32(file, data, 3000));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_before));
+    CHECK_EQUAL(0, fat32_concat("/daily.log", "/hour_01.log"));
+    CHECK_EQUAL(0, count_free_clusters_fat32(&free_after));
+    CHECK_EQUAL(free_before, free_after);
+    CHECK(path_exists_fat32("/hour_01.log") != 0);
+
+    // Невыровненный конец: данные сегмента копируются
+    CHECK_EQUAL(0, open_file_fat32("/hour_02.log", &file, F_WRITE));
+    CHECK_EQUAL(1000, write_file_fat32(file, data + 100, 1000));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, fat32_concat("/daily.log", "/hour_02.log"));
+
+    uint8_t buffer[4000];
+    CHECK_EQUAL(0, open_file_fat32("/daily.log", &file, F_READ));
+    CHECK_EQUAL(16 * sizeof(data) + 4000, file->size_bytes);
+    CHECK_EQUAL(0, seek_file_fat32(file, 16 * sizeof(data), F_SEEK_SET));
+    CHECK_EQUAL(4000, read_file_fat32(file, buffer, sizeof(buffer)));
+    MEMCMP_EQUAL(data, buffer, 3000);
+    MEMCMP_EQUAL(data + 100, buffer + 3000, 1000);
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    CHECK_EQUAL(FAT32_ERR_ENTRY_NOT_FOUND, fat32_concat("/daily.log", "/hour_02.log"));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, fat32_concat("/daily.log", "/daily.log"));
+    CHECK_EQUAL(0, delete_file_fat32("/daily.log"));
+}
+
+TEST(FAT32Tests, CopyFile)
+{
+    FAT32_File *file = NULL;
+    uint8_t data[4096];
+    for (uint32_t i = 0; i < sizeof(data); i++)
+        data[i] = (uint8_t)(i * 29 + 1);
+
+    CHECK_EQUAL(0, open_file_fat32("/source.bin", &file, F_WRITE));
+    for (int i = 0; i < 20; i++)
+        CHECK_EQUAL((int)sizeof(data), write_file_fat32(file, data, sizeof(data)));
+    CHECK_EQUAL(100, write_file_fat32(file, data, 100));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+    CHECK_EQUAL(0, open_file_fat32("/copy.bin", &file, F_WRITE));
+    CHECK_EQUAL(1000, write_file_fat32(file, data, 1000));
+    CHECK_EQUAL(0, close_file_fat32(&file));
+
+    // Существующий файл назначения перезаписывается
+    CHECK_EQUAL(0, fat32_copy_file("/source.bin", "/copy.bin"));
+    CHECK_EQUAL(FAT32_ERR_INVALID_ARGUMENT, fat32_copy_file("/source.bin", "/source.bin"));
+    CHECK_EQUAL(FAT32_ERR_ENTRY_NOT_FOUND, fat32_copy_file("/missing.bin", "/copy.bin"));
+
+    const char *paths[] = {"/source.bin", "/copy.bin"};
+    uint8_t buffer[sizeof(data)];
+    for (int p = 0; p < 2; p++)
+    {
+        CHECK_EQUAL(0, open_file_fat32((char *)paths[p], &file, F_READ));
+        CHECK_EQUAL(20 * sizeof(data) + 100, file->size_bytes);
+        for (int i = 0; i < 20; i++)
+        {
+            CHECK_EQUAL((int)sizeof(data), read_file_fat32(file, buffer, sizeof(buffer)));
+            MEMCMP_EQUAL(data, buffer, sizeof(data));
+        }
+        CHECK_EQUAL(100, read_file_fat32(file, buffer, sizeof(buffer)));
+        MEMCMP_EQUAL(data, buffer, 100);
+        CHECK_EQUAL(0, close_file_fat32(&file));
+    }
+
+    CHECK_EQUAL(0, delete_file_fat32("/source.bin"));
+    CHECK_EQUAL(0, delete_file_fat32("/copy.bin"));
+}
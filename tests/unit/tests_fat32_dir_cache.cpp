@@ -0,0 +1,203 @@
+#include "CppUTest/TestHarness.h" // Основной заголовок
+
+extern "C"
+{
+#include "fat32/fat32_alloc.h"
+#include "fat32/fat32_dir_cache.h"
+#include <stdio.h>
+#include <string.h>
+}
+
+TEST_GROUP(FatDirCacheTests){
+    void setup(){
+        fat32_allocator_init(NULL);
+fat32_dir_cache_reset();
+fat32_dir_cache_set_budget(64 * 1024);
+}
+void teardown()
+{
+    fat32_dir_cache_set_budget(0);
+    fat32_dir_cache_reset();
+}
+}
+;
+
+static void make_position(DirEntryPosition *position, uint32_t cluster, uint32_t sector, uint32_t offset)
+{
+    position->cluster = cluster;
+    position->sector = sector;
+    position->offset = offset;
+}
+
+TEST(FatDirCacheTests, NameHashIgnoresCase)
+{
+    CHECK_EQUAL(fat32_name_hash("Report.TXT", 10), fat32_name_hash("report.txt", 10));
+    CHECK(fat32_name_hash("report.txt", 10) != fat32_name_hash("report.txu", 10));
+    CHECK(fat32_name_hash("", 0) > 1);
+    CHECK_EQUAL(fat32_name_hash("Журнал.log", strlen("Журнал.log")), fat32_name_hash("ЖУРНАЛ.LOG", strlen("ЖУРНАЛ.LOG")));
+    CHECK(fat32_name_hash("журнал.log", strlen("журнал.log")) != fat32_name_hash("журнан.log", strlen("журнан.log")));
+}
+
+TEST(FatDirCacheTests, AddFindRemove)
+{
+    const uint32_t dir = 10;
+    CHECK_EQUAL(0, fat32_dir_cache_ready(dir));
+    CHECK_EQUAL(0, fat32_dir_cache_build_begin(dir));
+
+    DirEntryPosition position;
+    char name[32];
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        sprintf(name, "file_%u.bin", i);
+        make_position(&position, 100 + i / 128, (i / 16) % 8, i % 16);
+        fat32_dir_cache_add(dir, fat32_name_hash(name, strlen(name)), &position, 2);
+    }
+    fat32_dir_cache_build_end(dir, 0);
+    CHECK_EQUAL(1, fat32_dir_cache_ready(dir));
+
+    uint32_t cursor = 0;
+    uint16_t count = 0;
+    sprintf(name, "FILE_%u.BIN", 321u);
+    uint32_t hash = fat32_name_hash(name, strlen(name));
+    CHECK_EQUAL(1, fat32_dir_cache_find(dir, hash, &cursor, &position, &count));
+    CHECK_EQUAL(100 + 321 / 128, position.cluster);
+    CHECK_EQUAL((321 / 16) % 8, position.sector);
+    CHECK_EQUAL(321 % 16, position.offset);
+    CHECK_EQUAL(2, count);
+
+    fat32_dir_cache_remove(dir, &position);
+    cursor = 0;
+    CHECK_EQUAL(0, fat32_dir_cache_find(dir, hash, &cursor, &position, &count));
+
+    // Другие каталоги индекса не имеют
+    cursor = 0;
+    CHECK_EQUAL(FAT32_ERR_NOT_FOUND, fat32_dir_cache_find(dir + 1, hash, &cursor, &position, &count));
+
+    fat32_dir_cache_invalidate(dir);
+    CHECK_EQUAL(0, fat32_dir_cache_ready(dir));
+}
+
+TEST(FatDirCacheTests, BudgetEvictsLeastRecentlyUsed)
+{
+    DirEntryPosition position;
+    make_position(&position, 5, 0, 0);
+
+    // Бюджет на два минимальных индекса
+    fat32_dir_cache_set_budget(2 * 64 * sizeof(Fat32DirIndexEntry));
+    CHECK_EQUAL(0, fat32_dir_cache_build_begin(20));
+    fat32_dir_cache_build_end(20, 0);
+    CHECK_EQUAL(0, fat32_dir_cache_build_begin(21));
+    fat32_dir_cache_build_end(21, 0);
+
+    // Обращение к 20 делает вытесняемым каталог 21
+    CHECK_EQUAL(1, fat32_dir_cache_ready(20));
+    CHECK_EQUAL(0, fat32_dir_cache_build_begin(22));
+    fat32_dir_cache_build_end(22, 0);
+    CHECK_EQUAL(1, fat32_dir_cache_ready(20));
+    CHECK_EQUAL(0, fat32_dir_cache_ready(21));
+    CHECK_EQUAL(1, fat32_dir_cache_ready(22));
+
+    // Каталог, не помещающийся в бюджет, помечается и больше не индексируется
+    CHECK_EQUAL(0, fat32_dir_cache_build_begin(23));
+    for (uint32_t i = 0; i < 200; i++)
+    {
+        position.offset = i % 16;
+        position.sector = i / 16;
+        fat32_dir_cache_add(23, 1000 + i, &position, 1);
+    }
+    fat32_dir_cache_build_end(23, 0);
+    CHECK_EQUAL(-1, fat32_dir_cache_ready(23));
+
+    fat32_dir_cache_set_budget(0);
+    CHECK_EQUAL(-1, fat32_dir_cache_ready(20));
+}
+
+TEST(FatDirCacheTests, FreeSpaceTailAndHoles)
+{
+    const uint32_t dir = 30;
+    Fat32DirFreeRun run;
+    uint32_t last_cluster = 0;
+
+    // Свободное место неизвестно: «дыры» не запоминаются
+    make_position(&run.position, 30, 0, 4);
+    run.count = 3;
+    fat32_dir_cache_add_hole(dir, &run);
+    CHECK_EQUAL(FAT32_ERR_NOT_FOUND, fat32_dir_cache_get_tail(dir, &run, &last_cluster));
+
+    make_position(&run.position, 31, 2, 5);
+    run.count = 100;
+    fat32_dir_cache_set_tail(dir, &run, 31);
+
+    for (uint32_t i = 0; i < FAT32_DIR_CACHE_HOLES + 2; i++)
+    {
+        make_position(&run.position, 30, i, 0);
+        run.count = i + 1;
+        fat32_dir_cache_add_hole(dir, &run);
+    }
+
+    // Выбирается самая короткая подходящая; самые короткие вытеснены
+    CHECK_EQUAL(1, fat32_dir_cache_take_hole(dir, 2, &run));
+    CHECK_EQUAL(3u, run.count);
+    CHECK_EQUAL(2u, run.position.sector);
+    CHECK_EQUAL(1, fat32_dir_cache_take_hole(dir, 2, &run));
+    CHECK_EQUAL(4u, run.count);
+    CHECK_EQUAL(0, fat32_dir_cache_take_hole(dir, FAT32_DIR_CACHE_HOLES + 3, &run));
+
+    CHECK_EQUAL(0, fat32_dir_cache_get_tail(dir, &run, &last_cluster));
+    CHECK_EQUAL(31u, last_cluster);
+    CHECK_EQUAL(100u, run.count);
+    CHECK_EQUAL(5u, run.position.offset);
+
+    fat32_dir_cache_invalidate(dir);
+    CHECK_EQUAL(FAT32_ERR_NOT_FOUND, fat32_dir_cache_get_tail(dir, &run, &last_cluster));
+}
+
+TEST(FatDirCacheTests, FilterRejectsAbsentNames)
+{
+    const uint32_t dir = 40;
+    DirEntryPosition position;
+    char name[32];
+    make_position(&position, 40, 0, 0);
+
+    // Фильтр не зависит от бюджета индексов
+    fat32_dir_cache_set_budget(0);
+    CHECK_EQUAL(FAT32_ERR_NOT_FOUND, fat32_dir_cache_filter_test(dir, 1234));
+    fat32_dir_cache_filter_begin(dir);
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        sprintf(name, "IMG_%04u.JPG", i);
+        fat32_dir_cache_add(dir, fat32_name_hash(name, strlen(name)), &position, 2);
+    }
+    CHECK_EQUAL(FAT32_ERR_NOT_FOUND, fat32_dir_cache_filter_test(dir, 1234));
+    fat32_dir_cache_filter_end(dir, 0);
+
+    uint32_t rejected = 0;
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        sprintf(name, "img_%04u.jpg", i);
+        int present = fat32_dir_cache_filter_test(dir, fat32_name_hash(name, strlen(name)));
+        if (i < 100)
+            CHECK_EQUAL(1, present);
+        else if (present == 0)
+            rejected++;
+    }
+    CHECK(rejected > 850);
+
+    // Добавленное после заполнения имя сразу видно фильтру
+    uint32_t hash = fat32_name_hash("new_file.txt", 12);
+    fat32_dir_cache_add(dir, hash, &position, 2);
+    CHECK_EQUAL(1, fat32_dir_cache_filter_test(dir, hash));
+
+    // Прерванное заполнение и переполненный фильтр ничего не отсекают
+    fat32_dir_cache_filter_begin(dir + 1);
+    fat32_dir_cache_filter_end(dir + 1, -1);
+    CHECK_EQUAL(FAT32_ERR_NOT_FOUND, fat32_dir_cache_filter_test(dir + 1, hash));
+    fat32_dir_cache_filter_begin(dir + 2);
+    for (uint32_t i = 0; i <= FAT32_DIR_CACHE_BLOOM_BITS / 8; i++)
+        fat32_dir_cache_add(dir + 2, 1000 + i, &position, 1);
+    fat32_dir_cache_filter_end(dir + 2, 0);
+    CHECK_EQUAL(1, fat32_dir_cache_filter_test(dir + 2, hash));
+
+    fat32_dir_cache_invalidate(dir);
+    CHECK_EQUAL(FAT32_ERR_NOT_FOUND, fat32_dir_cache_filter_test(dir, hash));
+}
@@ -0,0 +1,88 @@
+#include "CppUTest/TestHarness.h" // Основной заголовок
+
+extern "C"
+{
+#include "fat32/fat32_scan.h"
+#include <string.h>
+}
+
+TEST_GROUP(FatScanTests){
+    void setup(){} void teardown(){}};
+
+TEST(FatScanTests, FindFreeSkipsReservedBits)
+{
+    uint32_t entries[37];
+    for (int i = 0; i < 37; i++)
+        entries[i] = i + 3;
+    entries[20] = 0xF0000000; // старшие биты зарезервированы, запись свободна
+    CHECK_EQUAL(20, fat32_scan_find_free(entries, 37));
+    CHECK_EQUAL(20, fat32_scan_find_free(entries, 21));
+    CHECK_EQUAL(20, fat32_scan_find_free(entries, 20));
+}
+
+TEST(FatScanTests, CountFreeMatchesScalar)
+{
+    uint32_t entries[101];
+    uint32_t expected = 0;
+    for (int i = 0; i < 101; i++)
+    {
+        entries[i] = (i % 3 == 0) ? 0 : FAT32_CLUSTER_END;
+        if (entries[i] == 0)
+            ++expected;
+    }
+    CHECK_EQUAL(expected, fat32_scan_count_free(entries, 101));
+}
+
+TEST(FatScanTests, FreeRunLength)
+{
+    uint32_t entries[40] = {0};
+    for (int i = 0; i < 40; i++)
+        entries[i] = (i >= 9 && i < 30) ? 0 : 5;
+    uint32_t run = 0;
+    CHECK_EQUAL(9, fat32_scan_free_run(entries, 40, &run));
+    CHECK_EQUAL(21, run);
+}
+
+TEST(FatScanTests, ChainRunStopsAtEndOfChain)
+{
+    uint32_t entries[50];
+    for (int i = 0; i < 50; i++)
+        entries[i] = 100 + i + 1;
+    entries[33] = FAT32_CLUSTER_END;
+    CHECK_EQUAL(33, fat32_scan_chain_run(entries, 50, 100));
+}
+
+static void fill_dir_entry(uint8_t *entry, uint8_t first, uint8_t attr)
+{
+    memset(entry, ' ', 32);
+    entry[0] = first;
+    entry[11] = attr;
+}
+
+TEST(FatScanTests, DirEntriesClassification)
+{
+    uint8_t entries[40 * 32];
+    for (int i = 0; i < 40; i++)
+        fill_dir_entry(&entries[i * 32], 'A' + (i % 20), ATTR_ARCHIVE);
+    fill_dir_entry(&entries[1 * 32], 0x42, ATTR_LONG_NAME);         // первая LFN-запись имени из 2 частей
+    fill_dir_entry(&entries[2 * 32], 0x01, ATTR_LONG_NAME);
+    fill_dir_entry(&entries[4 * 32], ENTRY_FREE_FAT32, ATTR_ARCHIVE);
+    fill_dir_entry(&entries[5 * 32], 'X', ATTR_VOLUME_ID);
+    fill_dir_entry(&entries[31 * 32], ENTRY_FREE_FULL_FAT32, 0);
+
+    Fat32DirScanMask mask;
+    fat32_scan_dir_entries(entries, 32, 0x42, 'D', &mask);
+    CHECK_EQUAL(0x80000000u, mask.end);
+    CHECK_EQUAL(1u << 4, mask.deleted);
+    CHECK_EQUAL((1u << 1) | (1u << 2), mask.lfn);
+    CHECK_EQUAL(0u, mask.sfn & ((1u << 1) | (1u << 2) | (1u << 4) | (1u << 5) | (1u << 31)));
+    CHECK(mask.sfn & 1u);
+    // 'D' встречается в записях 3 и 23, LDIR_Ord 0x42 — в записи 1
+    CHECK_EQUAL((1u << 1) | (1u << 3) | (1u << 23), mask.candidates);
+
+    // Неполная группа: биты за пределами count не выставляются
+    fat32_scan_dir_entries(&entries[32 * 32], 8, 0, 'A' + 12, &mask);
+    CHECK_EQUAL(0u, mask.end);
+    CHECK_EQUAL(0xFFu, mask.sfn);
+    CHECK_EQUAL(1u << 0, mask.candidates);
+}
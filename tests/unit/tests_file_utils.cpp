@@ -3,6 +3,7 @@
 extern "C"
 {
 #include "file_utils.h"
+#include <string.h>
 }
 
 TEST_GROUP(FileUtilsTests){
@@ -109,3 +110,179 @@ TEST(FileUtilsTests, ValidateLFN_InvalidNames)
     }
     CHECK_EQUAL(status, 0);
 }
+
+TEST(FileUtilsTests, PathIteratorComponents)
+{
+    const char *path = "//dir1/sub_dir//file.txt/";
+    const char *expected[] = {"dir1", "sub_dir", "file.txt"};
+    Fat32PathIter iter;
+    const char *name = NULL;
+    uint32_t length = 0;
+    int count = 0;
+
+    fat32_path_iter_init(&iter, path, strlen(path));
+    while (fat32_path_iter_next(&iter, &name, &length))
+    {
+        CHECK_EQUAL(strlen(expected[count]), length);
+        CHECK(strncmp(expected[count], name, length) == 0);
+        ++count;
+    }
+    CHECK_EQUAL(3, count);
+    CHECK_EQUAL(3, fat32_path_depth(path));
+
+    // Разбор только префикса пути
+    fat32_path_iter_init(&iter, path, 7);
+    CHECK_EQUAL(1, fat32_path_iter_next(&iter, &name, &length));
+    CHECK_EQUAL(4, length);
+    CHECK_EQUAL(0, fat32_path_iter_next(&iter, &name, &length));
+}
+
+TEST(FileUtilsTests, PathSplit)
+{
+    const char *path = "/dir1/file.txt";
+    uint32_t parent_length = 0, name_length = 0;
+    const char *name = NULL;
+
+    CHECK_EQUAL(0, fat32_path_split(path, strlen(path), &parent_length, &name, &name_length));
+    CHECK_EQUAL(6, parent_length);
+    CHECK_EQUAL(8, name_length);
+    CHECK(strncmp("file.txt", name, name_length) == 0);
+
+    path = "/dir1/";
+    CHECK_EQUAL(0, fat32_path_split(path, strlen(path), &parent_length, &name, &name_length));
+    CHECK_EQUAL(1, parent_length);
+    CHECK_EQUAL(4, name_length);
+
+    path = "/";
+    CHECK(fat32_path_split(path, strlen(path), &parent_length, &name, &name_length) != 0);
+}
+
+TEST(FileUtilsTests, ValidateRelativePath)
+{
+    CHECK_EQUAL(0, validate_relative_path("file.txt"));
+    CHECK_EQUAL(0, validate_relative_path("dir1/file.txt"));
+    CHECK_EQUAL(FAT_ERR_EMPTY, validate_relative_path(""));
+    CHECK_EQUAL(FAT_ERR_PATH_EMPTY_SEG, validate_relative_path("/file.txt"));
+    CHECK_EQUAL(FAT_ERR_PATH_EMPTY_SEG, validate_relative_path("dir1//file.txt"));
+    CHECK_EQUAL(0, validate_path("/"));
+}
+
+TEST(FileUtilsTests, ShortNameNumericTail)
+{
+    uint8_t basis[11];
+    uint8_t sfn[11];
+    const char *name = "rotating log.2024.txt";
+
+    uint8_t base_len = fat32_sfn_basis(name, strlen(name), basis);
+    CHECK_EQUAL(8, base_len);
+    CHECK(memcmp("ROTATING" "TXT", basis, 11) == 0);
+
+    memcpy(sfn, basis, 11);
+    fat32_sfn_set_tail(sfn, base_len, 1);
+    CHECK(memcmp("ROTATI~1" "TXT", sfn, 11) == 0);
+    CHECK_EQUAL(1u, fat32_sfn_tail_number(sfn, basis, base_len));
+
+    memcpy(sfn, basis, 11);
+    fat32_sfn_set_tail(sfn, base_len, 4321);
+    CHECK(memcmp("ROT~4321" "TXT", sfn, 11) == 0);
+    CHECK_EQUAL(4321u, fat32_sfn_tail_number(sfn, basis, base_len));
+
+    // Имя без точки и с короткой основой
+    name = "notes";
+    base_len = fat32_sfn_basis(name, strlen(name), basis);
+    CHECK_EQUAL(5, base_len);
+    fat32_generate_sfn_from_lfn(name, strlen(name), sfn);
+    CHECK(memcmp("NOTES~1 " "   ", sfn, 11) == 0);
+
+    // Другая основа или расширение не считаются занятым хвостом
+    CHECK_EQUAL(0u, fat32_sfn_tail_number((const uint8_t *)"NOTES~1 TXT", basis, base_len));
+    CHECK_EQUAL(0u, fat32_sfn_tail_number((const uint8_t *)"NOTE~1     ", basis, base_len));
+}
+
+static void fill_lfn_fragment(LDIR_Type *entry, uint8_t ord, const char *text)
+{
+    uint8_t *fields[3] = {entry->LDIR_Name1, entry->LDIR_Name2, entry->LDIR_Name3};
+    const int counts[3] = {5, 6, 2};
+    int position = 0;
+    int ended = 0;
+    memset(entry, 0, sizeof(LDIR_Type));
+    entry->LDIR_Ord = ord;
+    entry->LDIR_Attr = ATTR_LONG_NAME;
+    for (int field = 0; field < 3; field++)
+    {
+        for (int idx = 0; idx < counts[field]; idx++, position++)
+        {
+            uint16_t unicode = ended ? 0xFFFF : (uint8_t)text[position];
+            if (!ended && text[position] == '\0')
+                ended = 1;
+            fields[field][idx * 2] = unicode & 0xFF;
+            fields[field][idx * 2 + 1] = unicode >> 8;
+        }
+    }
+}
+
+static int compare_fragment(const char *name, const LDIR_Type *entry)
+{
+    uint16_t name_utf16[MAX_NAME_SIZE];
+    int length = fat32_utf8_to_utf16le(name, strlen(name), name_utf16, MAX_NAME_SIZE);
+    return fat32_compare_lfn_fragment(name_utf16, length, entry);
+}
+
+TEST(FileUtilsTests, CompareLfnFragment)
+{
+    // "Quarterly_Report.txt" — 20 символов, две LFN-записи
+    const char *name = "quarterly_report.TXT";
+    LDIR_Type entry;
+
+    fill_lfn_fragment(&entry, 1, "Quarterly_Rep");
+    CHECK_EQUAL(0, compare_fragment(name, &entry));
+    fill_lfn_fragment(&entry, 2 | LFN_ENTRY_LAST, "ort.txt");
+    CHECK_EQUAL(0, compare_fragment(name, &entry));
+
+    // Отличие в одном символе и несовпадение длины
+    fill_lfn_fragment(&entry, 1, "Quarterly_Reb");
+    CHECK(compare_fragment(name, &entry) != 0);
+    fill_lfn_fragment(&entry, 2 | LFN_ENTRY_LAST, "ort.txt2");
+    CHECK(compare_fragment(name, &entry) != 0);
+    fill_lfn_fragment(&entry, 2 | LFN_ENTRY_LAST, "ort.tx");
+    CHECK(compare_fragment(name, &entry) != 0);
+    fill_lfn_fragment(&entry, 3 | LFN_ENTRY_LAST, "more");
+    CHECK(compare_fragment(name, &entry) != 0);
+
+    // Имя, занимающее запись целиком, без завершающего нуля
+    name = "ABCDEFGHIJKLM";
+    fill_lfn_fragment(&entry, 1 | LFN_ENTRY_LAST, "abcdefghijklm");
+    CHECK_EQUAL(0, compare_fragment(name, &entry));
+}
+
+TEST(FileUtilsTests, Utf8Utf16RoundTrip)
+{
+    // ASCII длиннее блока быстрого пути, кириллица, символ вне BMP (суррогатная пара)
+    const char *name = "long_ascii_prefix_name_\xD0\x9E\xD1\x82\xD1\x87\xD1\x91\xD1\x82_\xF0\x9F\x98\x80.txt";
+    uint16_t utf16[MAX_NAME_SIZE];
+    char utf8[MAX_NAME_SIZE + 1];
+
+    int count = fat32_utf8_to_utf16le(name, strlen(name), utf16, MAX_NAME_SIZE);
+    CHECK_EQUAL(23 + 5 + 1 + 2 + 4, count);
+    CHECK_EQUAL(count, fat32_utf8_to_utf16le(name, strlen(name), NULL, MAX_NAME_SIZE));
+    CHECK_EQUAL(0x041E, utf16[23]);
+    CHECK_EQUAL(0xD83D, utf16[29]);
+    CHECK_EQUAL(0xDE00, utf16[30]);
+
+    CHECK_EQUAL((int)strlen(name), fat32_utf16le_to_utf8(utf16, count, utf8, sizeof(utf8)));
+    STRCMP_EQUAL(name, utf8);
+
+    // Перекодирование останавливается на 0x0000; имя, не помещающееся в буфер, отвергается
+    utf16[5] = 0x0000;
+    CHECK_EQUAL(5, fat32_utf16le_to_utf8(utf16, count, utf8, sizeof(utf8)));
+    CHECK_EQUAL(FAT_ERR_TOO_LONG, fat32_utf16le_to_utf8(utf16, count, utf8, 4));
+    CHECK_EQUAL(FAT_ERR_TOO_LONG, fat32_utf8_to_utf16le(name, strlen(name), utf16, 10));
+
+    // Обрыв последовательности, избыточная форма, суррогат в UTF-8
+    CHECK_EQUAL(FAT_ERR_INVALID_CHAR, fat32_utf8_to_utf16le("a\xD0", 2, utf16, MAX_NAME_SIZE));
+    CHECK_EQUAL(FAT_ERR_INVALID_CHAR, fat32_utf8_to_utf16le("\xC0\xAF", 2, utf16, MAX_NAME_SIZE));
+    CHECK_EQUAL(FAT_ERR_INVALID_CHAR, fat32_utf8_to_utf16le("\xED\xA0\x80", 3, utf16, MAX_NAME_SIZE));
+
+    CHECK_EQUAL(0, validate_fat_lfn_file("\xD0\x9E\xD1\x82\xD1\x87\xD1\x91\xD1\x82.txt"));
+    CHECK(validate_fat_lfn_file("\xD0report.txt") != 0);
+}